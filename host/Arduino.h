@@ -0,0 +1,120 @@
+//
+// Minimal Arduino core stand-in for the host (Linux) build
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Only the pieces used by the EMV reader code and the TLV library
+// are provided: Print, Serial, String and the timing functions.
+//
+
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class String;
+
+//
+// Base class for character output, as in the Arduino core.
+//
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) { return write((const uint8_t*) str, strlen(str)); }
+  virtual void flush() {}
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& str);
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(int n, int base = DEC) { return print((long) n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <typename T> size_t println(const T& value, int base) { size_t n = print(value, base); return n + println(); }
+};
+
+//
+// Serial port stand-in. Output goes to stdout unless muted.
+// A count of bytes written is kept so benchmarks can report serial load.
+//
+class HostSerial : public Print {
+public:
+  HostSerial() : muted(false), bytes_written(0) {}
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  int available() { return 0; }    // No input on the host
+  int read() { return -1; }
+  int peek() { return -1; }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+  void flush();
+
+  // Host only: discard output (still counted)
+  void mute(bool on) { muted = on; }
+  unsigned long bytesWritten() const { return bytes_written; }
+  void resetCount() { bytes_written = 0; }
+
+private:
+  bool muted;
+  unsigned long bytes_written;
+};
+
+extern HostSerial Serial;
+
+//
+// Heap backed string, as in the Arduino core.
+//
+class String {
+public:
+  String() {}
+  String(const char* str) : s(str) {}
+  String(const std::string& str) : s(str) {}
+  String(char c) : s(1, c) {}
+  String(unsigned char n, unsigned char base = DEC) : s(toString((unsigned long) n, base)) {}
+  String(int n, unsigned char base = DEC);
+  String(unsigned int n, unsigned char base = DEC) : s(toString(n, base)) {}
+  String(long n, unsigned char base = DEC);
+  String(unsigned long n, unsigned char base = DEC) : s(toString(n, base)) {}
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+
+  String& operator+=(const String& rhs) { s += rhs.s; return *this; }
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs.s + rhs.s); }
+  friend String operator+(const String& lhs, const char* rhs) { return String(lhs.s + rhs); }
+
+private:
+  static std::string toString(unsigned long n, int base);
+  std::string s;
+};
+
+#endif /* __HOST_ARDUINO_H__ */
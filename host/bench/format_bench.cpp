@@ -0,0 +1,127 @@
+//
+// Micro-benchmark for the trace formatting
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_format_bench [iterations]
+//
+// Compares the old String based hex dump with the TextFormatter, and
+// counts heap allocations for a whole tap against the virtual card.
+// Allocations are counted by replacing the global operator new.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include <new>
+#include "emv_format.h"
+#include "card_session.h"
+#include "virtual_card.h"
+
+static unsigned long allocation_count = 0;
+
+void* operator new(size_t size)
+{
+  allocation_count++;
+  void* p = malloc(size != 0 ? size : 1);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The hex dump as printMessage used to build it
+static void printMessageString(uint8_t *buffer, uint8_t length)
+{
+  String msgBuf;
+
+  for (int i = 0; i < length; i++)
+  {
+
+    if (buffer[i] < 0x10)
+      msgBuf = msgBuf + "0"; //Adds leading zeros if hex value is smaller than 0x10
+
+    msgBuf = msgBuf + String(buffer[i], HEX) + " ";
+  }
+
+  Serial.print("TX message (");
+  Serial.print(length);
+  Serial.print(" bytes): ");
+  Serial.println(msgBuf);
+}
+
+static void printMessageFormatter(uint8_t *buffer, uint8_t length)
+{
+  trace_out.putStr("TX message (");
+  trace_out.putDec(length);
+  trace_out.putStr(" bytes): ");
+  trace_out.putHexBytes(buffer, length, true);
+  trace_out.putLine();
+  trace_out.flush();
+}
+
+static void report(const char* name, int iterations, unsigned long allocations, uint64_t ns)
+{
+  printf("%-24s %12.2f %12.3f\n", name,
+         (double) allocations / iterations, ns / 1000.0 / iterations);
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  if (iterations <= 0) {
+    iterations = 1;
+  }
+
+  uint8_t apdu[255];
+  for (unsigned int i = 0; i < sizeof(apdu); i++) {
+    apdu[i] = (uint8_t) i;
+  }
+
+  VirtualCard card;
+  card.loadDefaultCard();
+  Serial.mute(true);
+
+  printf("%-24s %12s %12s\n", "", "allocs/call", "us/call");
+
+  unsigned long allocations = allocation_count;
+  uint64_t start = cpuTimeNs();
+  for (int i = 0; i < iterations; i++) {
+    printMessageString(apdu, sizeof(apdu));
+  }
+  report("255 byte hex, String", iterations, allocation_count - allocations, cpuTimeNs() - start);
+
+  allocations = allocation_count;
+  start = cpuTimeNs();
+  for (int i = 0; i < iterations; i++) {
+    printMessageFormatter(apdu, sizeof(apdu));
+  }
+  report("255 byte hex, formatter", iterations, allocation_count - allocations, cpuTimeNs() - start);
+
+  // Warm up once, then count the steady state
+  readCard(card);
+  allocations = allocation_count;
+  start = cpuTimeNs();
+  for (int i = 0; i < iterations; i++) {
+    readCard(card);
+  }
+  report("full tap", iterations, allocation_count - allocations, cpuTimeNs() - start);
+  return 0;
+}
@@ -0,0 +1,287 @@
+//
+// Benchmark the results log against a file standing in for the flash
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_log_bench [-n records] [-k flash-kb] [-b records-per-sync]
+//                      [-q queries] [-o file]
+//
+// Makes one record for each card of a farm (host/card_farm.h) by
+// reading it, then appends n records made from them to the log in a
+// file, syncing after every b (1, as between taps, by default). Then it
+// mounts the log again, and twice more with a tap logged before each,
+// checking each boot gets a new number. It runs range queries of 10
+// records from random places, and reads the whole log back, checking
+// each record against the one it was made from.
+//
+// Reports the record and flash bytes per record, pages programmed and
+// sectors erased, the CPU time to append, sync, mount and query, and
+// an estimate of the time the flash itself would take from typical
+// SPI NOR timings. The erase counts show how evenly the sectors wear.
+//
+// Without -o the file is made new in /tmp and removed at the end. With
+// -o it is kept, and a second run appends to the same log.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "card_session.h"
+#include "results_log.h"
+#include "file_storage.h"
+#include "card_farm.h"
+
+#define BENCH_FARM_CARDS 64
+#define BENCH_QUERY_RECORDS 10
+
+// Typical SPI NOR flash: page program and 4 KB sector erase
+#define FLASH_PAGE_PROGRAM_US 700
+#define FLASH_SECTOR_ERASE_US 45000
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Read each card of the farm once, and keep the record of the tap
+static void makeSamples(ResultsLog& log, std::vector<LogRecord>& samples)
+{
+  CardFarm farm;
+  farm.build(BENCH_FARM_CARDS, 1);
+  FarmSlot slot;
+  slot.attach(farm, 0, 1);
+  CardSession session(slot);
+
+  for (int i = 0; i < farm.size(); i++) {
+    unsigned long start = millis();
+    unsigned long exchanges = 0;
+    while (!session.isActive()) {
+      session.step();
+    }
+    while (session.isActive()) {
+      session.step();
+      exchanges++;
+    }
+    LogRecord record;
+    log.makeRecord(session, i % 4, millis() - start, i * 7 % 300, exchanges, &record);
+    samples.push_back(record);
+    slot.next();
+  }
+}
+
+static bool sameRecord(const LogRecord& a, const LogRecord& b)
+{
+  return a.uid_hash == b.uid_hash && a.reader == b.reader && a.failed == b.failed &&
+         a.tap_ms == b.tap_ms && a.detect_ms == b.detect_ms && a.exchanges == b.exchanges &&
+         a.time_ms == b.time_ms && a.aid_length == b.aid_length &&
+         memcmp(a.aid, b.aid, a.aid_length) == 0 && a.tags_length == b.tags_length &&
+         memcmp(a.tags, b.tags, a.tags_length) == 0;
+}
+
+static void usage()
+{
+  fprintf(stderr, "Usage: emv_log_bench [-n records] [-k flash-kb] [-b records-per-sync]\n"
+                  "                     [-q queries] [-o file]\n");
+}
+
+int main(int argc, char** argv)
+{
+  unsigned long records = 100000;
+  unsigned long flash_kb = 1984;      // The results partition in partitions.csv
+  unsigned long batch = 1;
+  unsigned long queries = 10000;
+  const char* path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (arg[0] != '-' || value == NULL) {
+      usage();
+      return 1;
+    }
+    i++;
+    if (strcmp(arg, "-n") == 0) {
+      records = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-k") == 0) {
+      flash_kb = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-b") == 0) {
+      batch = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-q") == 0) {
+      queries = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-o") == 0) {
+      path = value;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (batch == 0) {
+    batch = 1;
+  }
+
+  char temp_path[64];
+  if (path == NULL) {
+    snprintf(temp_path, sizeof(temp_path), "/tmp/emv_log_bench.%d", (int) getpid());
+    path = temp_path;
+    remove(path);
+  }
+
+  FileStorage storage;
+  if (!storage.open(path, flash_kb * 1024)) {
+    fprintf(stderr, "Can't open %s\n", path);
+    return 1;
+  }
+  // The logs are large, keep them off the stack
+  ResultsLog* log = new ResultsLog();
+  if (!log->begin(storage)) {
+    fprintf(stderr, "Can't mount the log, the flash needs 2 sectors or more\n");
+    return 1;
+  }
+
+  // The trace of the taps and the export are counted, not written
+  Serial.mute(true);
+  std::vector<LogRecord> samples;
+  makeSamples(*log, samples);
+
+  // Append
+  uint32_t base = log->nextSeq();
+  storage.clearCounts();
+  log->clearStats();
+  uint64_t append_ns = 0;
+  uint64_t sync_ns = 0;
+  for (unsigned long i = 0; i < records; i++) {
+    LogRecord record = samples[i % samples.size()];
+    uint64_t start = cpuTimeNs();
+    log->append(record);
+    uint64_t appended = cpuTimeNs();
+    append_ns += appended - start;
+    if ((i + 1) % batch == 0) {
+      log->sync();
+      sync_ns += cpuTimeNs() - appended;
+    }
+  }
+  uint64_t start = cpuTimeNs();
+  log->sync();
+  sync_ns += cpuTimeNs() - start;
+  FlashCounts writes = storage.getCounts();
+  LogStats log_stats = log->getStats();
+
+  // Mount again, as after a reset
+  ResultsLog* mounted = new ResultsLog();
+  start = cpuTimeNs();
+  bool remounted = mounted->begin(storage);
+  uint64_t mount_ns = cpuTimeNs() - start;
+  unsigned long mount_reads = storage.getCounts().reads - writes.reads;
+  if (!remounted || mounted->nextSeq() != log->nextSeq() ||
+      mounted->firstSeq() != log->firstSeq()) {
+    fprintf(stderr, "Mounted log doesn't match: records %u to %u, expected %u to %u\n",
+            mounted->firstSeq(), mounted->nextSeq(), log->firstSeq(), log->nextSeq());
+    return 1;
+  }
+
+  // Log a tap and mount again, twice, as after resets that only added
+  // to the head sector. The boot number is then only in the records.
+  for (int i = 0; i < 2; i++) {
+    LogRecord record = samples[(mounted->nextSeq() - base) % samples.size()];
+    uint16_t boot = mounted->getBoot();
+    mounted->append(record);
+    mounted->sync();
+    ResultsLog* again = new ResultsLog();
+    if (!again->begin(storage) || again->getBoot() == boot ||
+        again->nextSeq() != mounted->nextSeq()) {
+      fprintf(stderr, "Mount after boot %u gave boot %u, records to %u, expected to %u\n",
+              boot, again->getBoot(), again->nextSeq(), mounted->nextSeq());
+      return 1;
+    }
+    delete mounted;
+    mounted = again;
+  }
+
+  // Range queries from random places
+  unsigned long mismatches = 0;
+  uint32_t first = mounted->firstSeq();
+  uint32_t count = mounted->nextSeq() - first;
+  uint32_t random = 2463534242u;
+  unsigned long queried = 0;
+  start = cpuTimeNs();
+  for (unsigned long q = 0; q < queries && count > 0; q++) {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    LogCursor cursor;
+    LogRecord record;
+    if (!mounted->seek(first + random % count, &cursor)) {
+      mismatches++;
+      continue;
+    }
+    for (int i = 0; i < BENCH_QUERY_RECORDS && mounted->next(&cursor, &record); i++) {
+      queried++;
+    }
+  }
+  uint64_t query_ns = cpuTimeNs() - start;
+
+  // Read it all back
+  unsigned long scanned = 0;
+  start = cpuTimeNs();
+  LogCursor cursor;
+  LogRecord record;
+  if (mounted->seek(first, &cursor)) {
+    while (mounted->next(&cursor, &record)) {
+      if (record.seq >= base &&
+          !sameRecord(record, samples[(record.seq - base) % samples.size()])) {
+        mismatches++;
+      }
+      scanned++;
+    }
+  }
+  uint64_t scan_ns = cpuTimeNs() - start;
+
+  Serial.resetCount();
+  start = cpuTimeNs();
+  mounted->exportRecords(first, mounted->nextSeq());
+  uint64_t export_ns = cpuTimeNs() - start;
+  unsigned long export_bytes = Serial.bytesWritten();
+
+  unsigned long appended = max(log_stats.appended, 1ul);
+  double flash_us = (double) writes.pages_programmed * FLASH_PAGE_PROGRAM_US +
+                    (double) writes.erases * FLASH_SECTOR_ERASE_US;
+  printf("flash:                %lu KB, %u sectors, %s\n", flash_kb,
+         storage.size() / LOG_SECTOR_SIZE, path);
+  printf("records appended:     %lu, %lu per sync\n", log_stats.appended, batch);
+  printf("records kept:         %u, %u to %u\n", count, first, mounted->nextSeq() - 1);
+  printf("record bytes:         %.1f, with the sector headers\n",
+         (double) log_stats.written / appended);
+  printf("flash writes:         %.3f per record, %.3f pages programmed\n",
+         (double) writes.writes / appended, (double) writes.pages_programmed / appended);
+  printf("sectors erased:       %lu, one per %.1f records\n", writes.erases,
+         writes.erases > 0 ? (double) log_stats.appended / writes.erases : 0.0);
+  printf("write errors:         %lu, %lu writes setting bits\n", log_stats.errors,
+         writes.bad_writes);
+  printf("append CPU:           %.3f us per record\n", append_ns / 1e3 / appended);
+  printf("sync CPU:             %.3f us per record (file I/O)\n", sync_ns / 1e3 / appended);
+  printf("flash time estimate:  %.1f us per record (%d us a page, %d us an erase)\n",
+         flash_us / appended, FLASH_PAGE_PROGRAM_US, FLASH_SECTOR_ERASE_US);
+  printf("mount:                %.1f us, %lu reads\n", mount_ns / 1e3, mount_reads);
+  printf("range query:          %.2f us for %d records, %lu queries, %lu records read\n",
+         queries > 0 ? query_ns / 1e3 / queries : 0.0, BENCH_QUERY_RECORDS, queries, queried);
+  printf("full read:            %lu records, %.3f us each\n", scanned,
+         scanned > 0 ? scan_ns / 1e3 / scanned : 0.0);
+  printf("export:               %.1f bytes and %.3f us per record\n",
+         scanned > 0 ? (double) export_bytes / scanned : 0.0,
+         scanned > 0 ? export_ns / 1e3 / scanned : 0.0);
+  printf("mismatches:           %lu\n", mismatches);
+  printf("\n");
+  fflush(stdout);
+  Serial.mute(false);
+  mounted->printStats();
+
+  storage.close();
+  if (path == temp_path) {
+    remove(path);
+  }
+  return mismatches > 0 ? 1 : 0;
+}
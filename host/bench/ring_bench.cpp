@@ -0,0 +1,139 @@
+//
+// Two thread test and benchmark for the output queue ring
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_ring_bench [records] [consumer-delay-us]
+//
+// A producer thread writes numbered records of varying length into an
+// OutputQueue that drops what doesn't fit, as the card session does.
+// A consumer thread drains it and checks every record arrives whole,
+// in order, with only whole records missing. The consumer delay per
+// drain simulates a slow serial port, to force drops.
+//
+// Exits with status 1 if a record is corrupt or out of order.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "output_queue.h"
+
+// Record: length byte, 32 bit sequence number, then payload bytes
+// derived from the sequence number.
+static uint8_t payloadByte(uint32_t sequence, int i)
+{
+  return (uint8_t) (sequence * 31 + i);
+}
+
+//
+// Collects the drained bytes and checks the records in them
+//
+class RecordChecker : public Print {
+public:
+  RecordChecker() : received(0), missing(0), errors(0), next_sequence(0) {}
+
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size)
+  {
+    pending.insert(pending.end(), buffer, buffer + size);
+    size_t pos = 0;
+    while (pos < pending.size() && pos + pending[pos] <= pending.size()) {
+      checkRecord(&pending[pos], pending[pos]);
+      pos += pending[pos];
+    }
+    pending.erase(pending.begin(), pending.begin() + pos);
+    return size;
+  }
+  using Print::write;
+
+  // Count the records dropped after the last one received
+  void finish(uint32_t records) { missing += records - next_sequence; }
+
+  unsigned long received;
+  unsigned long missing;
+  unsigned long errors;
+
+private:
+  void checkRecord(const uint8_t* record, int length)
+  {
+    if (length < 5) {
+      errors++;
+      return;
+    }
+    uint32_t sequence = record[1] | record[2] << 8 | record[3] << 16 | (uint32_t) record[4] << 24;
+    if (sequence < next_sequence) {
+      errors++;
+      return;
+    }
+    for (int i = 5; i < length; i++) {
+      if (record[i] != payloadByte(sequence, i)) {
+        errors++;
+        return;
+      }
+    }
+    missing += sequence - next_sequence;
+    next_sequence = sequence + 1;
+    received++;
+  }
+
+  std::vector<uint8_t> pending;
+  uint32_t next_sequence;
+};
+
+int main(int argc, char** argv)
+{
+  unsigned long records = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  unsigned long consumer_delay = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+
+  OutputQueue queue(QUEUE_DROP);
+  RecordChecker checker;
+  std::atomic<bool> done(false);
+
+  std::thread consumer([&]() {
+    while (!done.load()) {
+      if (queue.drain(checker) == 0 || consumer_delay > 0) {
+        delayMicroseconds(consumer_delay > 0 ? consumer_delay : 10);
+      }
+    }
+    queue.drain(checker);
+  });
+
+  unsigned long start = micros();
+  unsigned long bytes = 0;
+  uint8_t record[255];
+  for (uint32_t sequence = 0; sequence < records; sequence++) {
+    int length = 5 + sequence % 120;
+    record[0] = length;
+    record[1] = sequence;
+    record[2] = sequence >> 8;
+    record[3] = sequence >> 16;
+    record[4] = sequence >> 24;
+    for (int i = 5; i < length; i++) {
+      record[i] = payloadByte(sequence, i);
+    }
+    queue.write(record, length);
+    bytes += length;
+  }
+  unsigned long elapsed = micros() - start;
+  done.store(true);
+  consumer.join();
+  checker.finish(records);
+
+  printf("records written   %lu (%lu bytes) in %lu us, %.1f ns per write\n",
+         records, bytes, elapsed, elapsed * 1000.0 / records);
+  printf("records received  %lu\n", checker.received);
+  printf("records dropped   %lu (%lu bytes), missing at consumer %lu\n",
+         queue.getDroppedWrites(), queue.getDroppedBytes(), checker.missing);
+  printf("high water        %lu of %lu bytes\n",
+         (unsigned long) queue.getHighWater(), (unsigned long) OUTPUT_QUEUE_SIZE);
+  printf("corrupt records   %lu\n", checker.errors);
+
+  bool ok = checker.errors == 0 &&
+            checker.received + queue.getDroppedWrites() == records &&
+            checker.missing == queue.getDroppedWrites();
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
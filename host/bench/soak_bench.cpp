@@ -0,0 +1,487 @@
+//
+// Sustained throughput of the tap loop against a farm of simulated cards
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_soak_bench [-t seconds] [-n cards] [-s seed] [-r readers]
+//                       [-m scheduler|session] [-e exchange-us] [-w warmup-taps]
+//                       [-f text|json|csv] [-V label]
+//
+// Runs the session logic of loop() against a farm of cards with
+// different AIDs, PDOLs and AFLs (host/card_farm.h). When a tap ends,
+// the card is taken away and the next card of the farm is tapped. After
+// a warm up of one tap per card, the run goes on for the given seconds
+// and reports:
+//   - sustained taps per second, CPU time and exchanges per tap
+//   - tap time, detection to done, and the tap_stats phases, as
+//     p50/p95/p99/max
+//   - memory drift: allocations in the tap loop, heap held at the end
+//     less at the start, and the deepest stack of a step. Only with a
+//     MEM_TRACK build, which native_soak_bench is.
+//
+// -m scheduler (the default) is runSession() in the firmware: the
+//    ReaderScheduler with -r readers, waiting as it says between polls.
+// -m session steps one CardSession until its tap ends, then taps the
+//    next card, without the scheduler: the blocking flow of one reader.
+// -e makes each exchange and detection take that long, as the PN532
+//    and the card do. Without it the run is CPU bound.
+// -f json and -f csv print one record, for tracking across versions.
+//    -V labels it, with the version of the firmware for example.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include "card_session.h"
+#include "reader_scheduler.h"
+#include "tap_stats.h"
+#include "aid_cache.h"
+#include "retry_transport.h"
+#include "mem_stats.h"
+#include "trace_level.h"
+#include "card_farm.h"
+
+// As in the firmware
+#define TAP_DEBOUNCE_MS 1000
+
+enum BenchMode {
+  MODE_SCHEDULER,
+  MODE_SESSION
+};
+
+enum BenchFormat {
+  FORMAT_TEXT,
+  FORMAT_JSON,
+  FORMAT_CSV
+};
+
+struct BenchConfig {
+  double seconds;
+  int cards;
+  uint32_t seed;
+  int readers;
+  BenchMode mode;
+  unsigned long latency_us;
+  int warmup_taps;
+  BenchFormat format;
+  const char* label;
+};
+
+struct BenchResult {
+  double seconds;
+  double cpu_seconds;
+  unsigned long taps;
+  unsigned long failed;
+  unsigned long taps_per_reader[MAX_READERS];
+  unsigned long exchanges;
+  unsigned long serial_bytes;
+  LatencyHistogram tap_us;
+  unsigned long allocations;
+  long heap_drift;
+  size_t peak_step_heap;
+  size_t peak_stack;
+};
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t wallTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+//
+// The readers and their sessions, stepped as loop() does
+//
+class Bench {
+public:
+  Bench(const BenchConfig& config, CardFarm& farm);
+
+  // Step until taps have ended, or the time is up. 0 taps for no limit.
+  void run(unsigned long taps, double seconds, BenchResult* result);
+
+  // Start the statistics over, after the warm up
+  void clearStats();
+
+  unsigned long exchanges();
+
+private:
+  void step();
+
+  const BenchConfig& config;
+  CardFarm& farm;
+  ReaderScheduler scheduler;
+  FarmSlot slots[MAX_READERS];
+  CardSession* sessions[MAX_READERS];
+  unsigned long tap_start[MAX_READERS];
+};
+
+Bench::Bench(const BenchConfig& config, CardFarm& farm)
+  : config(config), farm(farm)
+{
+  for (int i = 0; i < config.readers; i++) {
+    slots[i].attach(farm, i, config.readers);
+    slots[i].setLatency(config.latency_us);
+    sessions[i] = new CardSession(slots[i]);
+    sessions[i]->useAidCache(&aid_cache);
+    sessions[i]->setDebounce(TAP_DEBOUNCE_MS);
+    scheduler.addReader(*sessions[i]);
+    tap_start[i] = 0;
+  }
+}
+
+void Bench::clearStats()
+{
+  tap_stats.clear();
+  link_stats.clear();
+  mem_stats.clear();
+  scheduler.clearStats();
+  Serial.resetCount();
+}
+
+unsigned long Bench::exchanges()
+{
+  unsigned long count = 0;
+  for (int i = 0; i < farm.size(); i++) {
+    count += farm.card(i).apdu_count;
+  }
+  return count;
+}
+
+void Bench::step()
+{
+  if (config.mode == MODE_SESSION) {
+    sessions[0]->step();
+    return;
+  }
+
+  // runSession() without the serial commands
+  scheduler.step();
+  unsigned long wait = scheduler.msUntilNextPoll();
+  if (wait > 0) {
+    delay(min(wait, (unsigned long) 10));
+  } else if (!scheduler.anyReady()) {
+    delay(1);
+  }
+}
+
+void Bench::run(unsigned long taps, double seconds, BenchResult* result)
+{
+  *result = BenchResult();
+  unsigned long exchanges_start = exchanges();
+  long heap_start = mem_stats.getHeapHeld();
+  uint64_t cpu_start = cpuTimeNs();
+  uint64_t wall_start = wallTimeNs();
+  uint64_t wall_end = wall_start + (uint64_t) (seconds * 1e9);
+  bool active[MAX_READERS] = {};
+
+  for (;;) {
+    step();
+
+    // When a tap ends, the card leaves and the next one arrives
+    for (int i = 0; i < config.readers; i++) {
+      bool now_active = sessions[i]->isActive();
+      if (now_active && !active[i]) {
+        tap_start[i] = micros();
+      } else if (!now_active && active[i]) {
+        if (sessions[i]->getState() == SESSION_DONE) {
+          result->taps++;
+          result->taps_per_reader[i]++;
+          result->tap_us.record((uint32_t) (micros() - tap_start[i]));
+        } else {
+          result->failed++;
+        }
+        slots[i].next();
+      }
+      active[i] = now_active;
+    }
+
+    if (taps > 0 && result->taps + result->failed >= taps) {
+      break;
+    }
+    if (seconds > 0 && wallTimeNs() >= wall_end) {
+      break;
+    }
+  }
+
+  result->seconds = (wallTimeNs() - wall_start) / 1e9;
+  result->cpu_seconds = (cpuTimeNs() - cpu_start) / 1e9;
+  result->exchanges = exchanges() - exchanges_start;
+  result->serial_bytes = Serial.bytesWritten();
+  result->heap_drift = mem_stats.getHeapHeld() - heap_start;
+  for (int i = 0; i <= MEM_OTHER; i++) {
+    const MemPhaseStats& phase = mem_stats.phases[i];
+    result->allocations += phase.allocations;
+    result->peak_step_heap = max(result->peak_step_heap, phase.peak_heap);
+    result->peak_stack = max(result->peak_stack, phase.peak_stack);
+  }
+}
+
+/*** Output ***/
+
+static const char* modeName(BenchMode mode)
+{
+  return mode == MODE_SESSION ? "session" : "scheduler";
+}
+
+// Phase name as a key: "read record" is read_record
+static const char* phaseKey(int phase)
+{
+  static char key[32];
+  snprintf(key, sizeof(key), "%s", TapStats::phaseName((StatPhase) phase));
+  for (char* p = key; *p != '\0'; p++) {
+    if (*p == ' ') {
+      *p = '_';
+    }
+  }
+  return key;
+}
+
+static void printJsonString(const char* str)
+{
+  putchar('"');
+  for (const char* p = str; *p != '\0'; p++) {
+    if (*p == '"' || *p == '\\') {
+      putchar('\\');
+    }
+    putchar(*p);
+  }
+  putchar('"');
+}
+
+static void printJsonPercentiles(const LatencyHistogram& h)
+{
+  printf("{\"count\": %u, \"p50_us\": %u, \"p95_us\": %u, \"p99_us\": %u, \"max_us\": %u}",
+         h.getCount(), h.percentile(50), h.percentile(95), h.percentile(99), h.getMax());
+}
+
+static void printJson(const BenchConfig& config, const CardFarm& farm, const BenchResult& r)
+{
+  unsigned long ended = max(r.taps, 1ul);
+  printf("{\n");
+  printf("  \"label\": ");
+  printJsonString(config.label);
+  printf(",\n");
+  printf("  \"trace_level\": \"%s\",\n", traceLevelName());
+  printf("  \"mode\": \"%s\",\n", modeName(config.mode));
+  printf("  \"readers\": %d,\n", config.readers);
+  printf("  \"farm\": {\"cards\": %d, \"seed\": %u, \"schemes\": %d, \"pdol_shapes\": %d, "
+         "\"afl_shapes\": %d},\n", farm.size(), config.seed, farm.schemeCount(),
+         farm.pdolShapeCount(), farm.aflShapeCount());
+  printf("  \"exchange_latency_us\": %lu,\n", config.latency_us);
+  printf("  \"seconds\": %.3f,\n", r.seconds);
+  printf("  \"taps\": %lu,\n", r.taps);
+  printf("  \"failed\": %lu,\n", r.failed);
+  printf("  \"taps_per_reader\": [");
+  for (int i = 0; i < config.readers; i++) {
+    printf("%s%lu", i > 0 ? ", " : "", r.taps_per_reader[i]);
+  }
+  printf("],\n");
+  printf("  \"taps_per_second\": %.1f,\n", r.taps / r.seconds);
+  printf("  \"cpu_us_per_tap\": %.2f,\n", r.cpu_seconds * 1e6 / ended);
+  printf("  \"exchanges_per_tap\": %.2f,\n", (double) r.exchanges / ended);
+  printf("  \"serial_bytes_per_tap\": %.1f,\n", (double) r.serial_bytes / ended);
+  printf("  \"tap\": ");
+  printJsonPercentiles(r.tap_us);
+  printf(",\n");
+  printf("  \"phases\": {\n");
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    printf("    \"%s\": ", phaseKey(i));
+    printJsonPercentiles(tap_stats.phases[i]);
+    printf("%s\n", i + 1 < NUM_STAT_PHASES ? "," : "");
+  }
+  printf("  },\n");
+  if (MemStats::enabled()) {
+    printf("  \"memory\": {\"tracked\": true, \"allocations\": %lu, \"heap_drift_bytes\": %ld, "
+           "\"peak_step_heap_bytes\": %zu, \"peak_stack_bytes\": %zu}\n",
+           r.allocations, r.heap_drift, r.peak_step_heap, r.peak_stack);
+  } else {
+    printf("  \"memory\": {\"tracked\": false}\n");
+  }
+  printf("}\n");
+}
+
+static void printCsv(const BenchConfig& config, const CardFarm& farm, const BenchResult& r)
+{
+  unsigned long ended = max(r.taps, 1ul);
+  printf("label,trace_level,mode,readers,cards,seed,exchange_latency_us,seconds,taps,failed,"
+         "taps_per_second,cpu_us_per_tap,exchanges_per_tap,serial_bytes_per_tap,"
+         "tap_p50_us,tap_p95_us,tap_p99_us,tap_max_us");
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    const char* key = phaseKey(i);
+    printf(",%s_p50_us,%s_p95_us,%s_p99_us,%s_max_us", key, key, key, key);
+  }
+  printf(",allocations,heap_drift_bytes,peak_step_heap_bytes,peak_stack_bytes\n");
+
+  // A label with a comma or quote is quoted
+  if (strpbrk(config.label, ",\"") != NULL) {
+    putchar('"');
+    for (const char* p = config.label; *p != '\0'; p++) {
+      if (*p == '"') {
+        putchar('"');
+      }
+      putchar(*p);
+    }
+    putchar('"');
+  } else {
+    printf("%s", config.label);
+  }
+  printf(",%s,%s,%d,%d,%u,%lu,%.3f,%lu,%lu,%.1f,%.2f,%.2f,%.1f,%u,%u,%u,%u",
+         traceLevelName(), modeName(config.mode), config.readers, farm.size(), config.seed,
+         config.latency_us, r.seconds, r.taps, r.failed, r.taps / r.seconds,
+         r.cpu_seconds * 1e6 / ended, (double) r.exchanges / ended,
+         (double) r.serial_bytes / ended, r.tap_us.percentile(50), r.tap_us.percentile(95),
+         r.tap_us.percentile(99), r.tap_us.getMax());
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    const LatencyHistogram& h = tap_stats.phases[i];
+    printf(",%u,%u,%u,%u", h.percentile(50), h.percentile(95), h.percentile(99), h.getMax());
+  }
+  if (MemStats::enabled()) {
+    printf(",%lu,%ld,%zu,%zu\n", r.allocations, r.heap_drift, r.peak_step_heap, r.peak_stack);
+  } else {
+    printf(",,,,\n");
+  }
+}
+
+static void printText(const BenchConfig& config, const CardFarm& farm, const BenchResult& r)
+{
+  unsigned long ended = max(r.taps, 1ul);
+  printf("trace level:          %d (%s)\n", TRACE_LEVEL, traceLevelName());
+  printf("mode:                 %s, %d reader%s\n", modeName(config.mode), config.readers,
+         config.readers > 1 ? "s" : "");
+  printf("farm:                 %d cards, seed %u: %d schemes, %d PDOL and %d AFL lengths\n",
+         farm.size(), config.seed, farm.schemeCount(), farm.pdolShapeCount(),
+         farm.aflShapeCount());
+  printf("exchange latency:     %lu us\n", config.latency_us);
+  printf("run:                  %.2f s, %lu taps, %lu failed\n", r.seconds, r.taps, r.failed);
+  printf("taps per second:      %.1f\n", r.taps / r.seconds);
+  printf("CPU per tap:          %.2f us\n", r.cpu_seconds * 1e6 / ended);
+  printf("exchanges per tap:    %.2f\n", (double) r.exchanges / ended);
+  printf("serial bytes per tap: %.1f\n", (double) r.serial_bytes / ended);
+  if (MemStats::enabled()) {
+    printf("allocations:          %lu\n", r.allocations);
+    printf("heap drift:           %ld bytes\n", r.heap_drift);
+    printf("peak step heap:       %zu bytes\n", r.peak_step_heap);
+    printf("peak stack:           %zu bytes\n", r.peak_stack);
+  } else {
+    printf("memory:               not tracked, build with MEM_TRACK (native_soak_bench)\n");
+  }
+
+  printf("\n%-12s %10s %8s %8s %8s %8s\n", "", "count", "p50 us", "p95 us", "p99 us", "max us");
+  printf("%-12s %10u %8u %8u %8u %8u\n", "tap", r.tap_us.getCount(), r.tap_us.percentile(50),
+         r.tap_us.percentile(95), r.tap_us.percentile(99), r.tap_us.getMax());
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    const LatencyHistogram& h = tap_stats.phases[i];
+    printf("%-12s %10u %8u %8u %8u %8u\n", TapStats::phaseName((StatPhase) i), h.getCount(),
+           h.percentile(50), h.percentile(95), h.percentile(99), h.getMax());
+  }
+}
+
+static void usage()
+{
+  fprintf(stderr, "Usage: emv_soak_bench [-t seconds] [-n cards] [-s seed] [-r readers]\n"
+                  "                      [-m scheduler|session] [-e exchange-us] [-w warmup-taps]\n"
+                  "                      [-f text|json|csv] [-V label]\n");
+}
+
+int main(int argc, char** argv)
+{
+  BenchConfig config;
+  config.seconds = 10;
+  config.cards = 64;
+  config.seed = 1;
+  config.readers = 1;
+  config.mode = MODE_SCHEDULER;
+  config.latency_us = 0;
+  config.warmup_taps = -1;
+  config.format = FORMAT_TEXT;
+  config.label = "";
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (arg[0] != '-' || value == NULL) {
+      usage();
+      return 1;
+    }
+    i++;
+    if (strcmp(arg, "-t") == 0) {
+      config.seconds = atof(value);
+    } else if (strcmp(arg, "-n") == 0) {
+      config.cards = atoi(value);
+    } else if (strcmp(arg, "-s") == 0) {
+      config.seed = strtoul(value, NULL, 0);
+    } else if (strcmp(arg, "-r") == 0) {
+      config.readers = atoi(value);
+    } else if (strcmp(arg, "-m") == 0 && strcmp(value, "scheduler") == 0) {
+      config.mode = MODE_SCHEDULER;
+    } else if (strcmp(arg, "-m") == 0 && strcmp(value, "session") == 0) {
+      config.mode = MODE_SESSION;
+    } else if (strcmp(arg, "-e") == 0) {
+      config.latency_us = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "-w") == 0) {
+      config.warmup_taps = atoi(value);
+    } else if (strcmp(arg, "-f") == 0 && strcmp(value, "text") == 0) {
+      config.format = FORMAT_TEXT;
+    } else if (strcmp(arg, "-f") == 0 && strcmp(value, "json") == 0) {
+      config.format = FORMAT_JSON;
+    } else if (strcmp(arg, "-f") == 0 && strcmp(value, "csv") == 0) {
+      config.format = FORMAT_CSV;
+    } else if (strcmp(arg, "-V") == 0) {
+      config.label = value;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (config.readers < 1 || config.readers > MAX_READERS) {
+    fprintf(stderr, "1 to %d readers\n", MAX_READERS);
+    return 1;
+  }
+  if (config.mode == MODE_SESSION && config.readers > 1) {
+    fprintf(stderr, "The session mode has one reader\n");
+    return 1;
+  }
+  if (config.cards < config.readers || config.seconds <= 0) {
+    fprintf(stderr, "At least a card per reader, and a time over 0\n");
+    return 1;
+  }
+  if (config.warmup_taps < 0) {
+    config.warmup_taps = config.cards;
+  }
+
+  CardFarm farm;
+  farm.build(config.cards, config.seed);
+
+  // The trace is formatted and counted, but not written
+  Serial.mute(true);
+  mem_stats.track();
+  Bench bench(config, farm);
+
+  // Fill the caches and buffers, then measure
+  BenchResult result;
+  if (config.warmup_taps > 0) {
+    bench.run(config.warmup_taps, 0, &result);
+  }
+  bench.clearStats();
+  bench.run(0, config.seconds, &result);
+
+  switch (config.format) {
+    case FORMAT_JSON:
+      printJson(config, farm, result);
+      break;
+    case FORMAT_CSV:
+      printCsv(config, farm, result);
+      break;
+    default:
+      printText(config, farm, result);
+      break;
+  }
+  return 0;
+}
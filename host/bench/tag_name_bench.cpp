@@ -0,0 +1,240 @@
+//
+// Benchmark for the tag name lookup
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_tag_name_bench [iterations]
+//
+// Compares the flash footprint and lookup time of the compressed tag
+// dictionary (src/emv_tag_dict.h) with the table of plain strings it
+// replaced. Footprints are for the ESP32, with 4 byte pointers.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include "emv_tag_names.h"
+#include "emv_tag_dict.h"
+
+// The table as it was before the dictionary
+struct TagName {
+    uint16_t tag;
+    const char* name;
+};
+
+static constexpr TagName tag_names[] = {
+    { 0x4F,   "Application Identifier (AID) - card" },
+    { 0x50,   "Application Label" },
+    { 0x56,   "Track 1 Data" },
+    { 0x57,   "Track 2 Equivalent Data" },
+    { 0x5A,   "Application Primary Account Number (PAN)" },
+    { 0x61,   "Application Template" },
+    { 0x6F,   "File Control Information (FCI) Template" },
+    { 0x70,   "READ RECORD Response Message Template" },
+    { 0x77,   "Response Message Template Format 2" },
+    { 0x82,   "Application Interchange Profile" },
+    { 0x84,   "Dedicated file (DF) Name" },
+    { 0x87,   "Application Priority Indicator" },
+    { 0x8C,   "Card Risk Management Data object List 1 (CDOL1)" },
+    { 0x8D,   "Card Risk Management Data object List 2 (CDOL2)" },
+    { 0x8E,   "Cardholder Verification Method (CVM) List" },
+    { 0x8F,   "Certification Authority Public Key Index (PKI)" },
+    { 0x90,   "Issuer Public Key Certificate" },
+    { 0x92,   "Issuer Public Key Remainder" },
+    { 0x94,   "Application File Locator (AFL)" },
+    { 0xA5,   "File Control Information (FCI) Proprietary Template" },
+    { 0x5F24, "Application Expiration Date" },
+    { 0x5F25, "Application Effective Date" },
+    { 0x5F28, "Issuer Country Code" },
+    { 0x5F2A, "Transaction Currency Code" },
+    { 0x5F2D, "Language Preference" },
+    { 0x5F30, "Service Code" },
+    { 0x5F34, "Application Primary Account Number (PAN) Sequence Number" },
+    { 0x9F01, "Acquirer Identifier" },
+    { 0x9F07, "Application Usage Control" },
+    { 0x9F08, "Application Version Number" },
+    { 0x9F0D, "Issuer Action Code - Default" },
+    { 0x9F0E, "Issuer Action Code - Denial" },
+    { 0x9F0F, "Issuer Action Code - Online" },
+    { 0x9F11, "Issuer Code Table Index" },
+    { 0x9F12, "Application Preferred Name" },
+    { 0x9F1A, "Terminal Country Code" },
+    { 0x9F1D, "Terminal Risk Management Data" },
+    { 0x9F24, "Payment Account Reference (PAR)" },
+    { 0x9F32, "Issuer Public Key Exponent" },
+    { 0x9F35, "Terminal type" },
+    { 0x9F38, "Processing Options Data Option List (PDOL)" },
+    { 0x9F42, "Currency Code, Application" },
+    { 0x9F44, "Currency Exponent, Application" },
+    { 0x9F46, "Integrated Circuit Card (ICC) Public Key Certificate" },
+    { 0x9F47, "Integrated Circuit Card (ICC) Public Key Exponent" },
+    { 0x9F48, "Integrated Circuit Card (ICC) Public Key Remainder" },
+    { 0x9F49, "Dynamic Data Authentication Data Object List (DDOL)" },
+    { 0x9F4A, "Static Data Authentication Tag List" },
+    { 0x9F4D, "Log Entry" },
+    { 0x9F4E, "Merchant Name and Location" },
+    { 0x9F5D, "Available Offline Spending Amount (AOSA)" },
+    { 0x9F62, "PCVC3 (Track1)" },
+    { 0x9F63, "PUNATC (Track1)" },
+    { 0x9F64, "NATC (Track1)" },
+    { 0x9F65, "PCVC3 (Track2)" },
+    { 0x9F66, "Terminal Transaction Qualifiers" },
+    { 0x9F67, "NATC (Track2)" },
+    { 0x9F69, "UDOL" },
+    { 0x9F6B, "Card CVM Limit" },
+    { 0x9F6C, "Card Transaction Qualifiers (CTQ)" },
+    { 0x9F6E, "Third Party Data" },
+    { 0xBF0C, "File Control Information (FCI) Issuer Discretionary Data" },
+};
+
+#define NUM_OLD_TAGS (sizeof(tag_names) / sizeof(tag_names[0]))
+#define NUM_DICT_TAGS (sizeof(tag_dict) / sizeof(tag_dict[0]))
+
+static const char* old_tag_name(uint16_t tag)
+{
+  int low = 0;
+  int high = NUM_OLD_TAGS - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    if (tag_names[mid].tag == tag) {
+      return tag_names[mid].name;
+    }
+    if (tag_names[mid].tag < tag) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return "";
+}
+
+// Tags and value lengths printed for a tap of the sample card
+struct TagUse {
+  uint16_t tag;
+  int length;
+};
+
+static const TagUse tap_tags[] = {
+  { 0x6F, 48 }, { 0x84, 14 }, { 0xA5, 30 }, { 0xBF0C, 27 }, { 0x61, 25 },
+  { 0x4F, 7 }, { 0x50, 11 }, { 0x87, 1 }, { 0x6F, 59 }, { 0x84, 7 },
+  { 0xA5, 48 }, { 0x50, 11 }, { 0x87, 1 }, { 0x9F38, 24 }, { 0x5F2D, 2 },
+  { 0x77, 40 }, { 0x82, 2 }, { 0x94, 8 }, { 0x9F36, 2 }, { 0x9F26, 8 },
+  { 0x9F10, 7 }, { 0x70, 49 }, { 0x57, 19 }, { 0x5F20, 9 }, { 0x9F1F, 13 },
+  { 0x70, 76 }, { 0x5A, 8 }, { 0x5F24, 3 }, { 0x5F25, 3 }, { 0x5F28, 2 },
+  { 0x5F34, 1 }, { 0x9F07, 2 }, { 0x8E, 14 }, { 0x9F0D, 5 }, { 0x9F0E, 5 },
+  { 0x9F0F, 5 }, { 0x70, 185 }, { 0x8F, 1 }, { 0x90, 144 }, { 0x9F32, 1 },
+  { 0x92, 29 },
+};
+
+#define NUM_TAP_TAGS (sizeof(tap_tags) / sizeof(tap_tags[0]))
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Keeps the lookups from being optimized away
+static volatile size_t sink;
+
+static void report(const char* name, unsigned long lookups, uint64_t ns)
+{
+  printf("%-28s %12lu %12.1f\n", name, lookups, (double) ns / lookups);
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  if (iterations <= 0) {
+    iterations = 1;
+  }
+
+  // Flash footprint
+  size_t old_strings = 0;
+  int old_named = 0;
+  for (unsigned int i = 0; i < NUM_OLD_TAGS; i++) {
+    old_strings += strlen(tag_names[i].name) + 1;
+  }
+  size_t old_table = NUM_OLD_TAGS * 8;
+  size_t dict_table = sizeof(tag_dict);
+  size_t dict_text = sizeof(tag_dict_pairs) + sizeof(tag_dict_text);
+
+  size_t dict_strings = 0;
+  for (unsigned int i = 0; i < NUM_DICT_TAGS; i++) {
+    if (i == 0 || tag_dict[i].name != tag_dict[i - 1].name) {
+      char name[TAG_NAME_MAX];
+      get_tag_name(tag_dict[i].tag, tag_dict[i].min_length, name, sizeof(name));
+      dict_strings += strlen(name) + 1;
+    }
+  }
+
+  for (unsigned int i = 0; i < NUM_TAP_TAGS; i++) {
+    old_named += old_tag_name(tap_tags[i].tag)[0] != '\0';
+  }
+  int dict_named = 0;
+  for (unsigned int i = 0; i < NUM_TAP_TAGS; i++) {
+    char name[TAG_NAME_MAX];
+    dict_named += get_tag_name(tap_tags[i].tag, tap_tags[i].length, name, sizeof(name))[0] != '\0';
+  }
+
+  printf("%-28s %8s %8s %8s %8s %12s\n", "", "entries", "table", "names", "total", "tap tags");
+  printf("%-28s %8u %8zu %8zu %8zu %9d/%zu\n", "old table", (unsigned int) NUM_OLD_TAGS,
+         old_table, old_strings, old_table + old_strings, old_named, NUM_TAP_TAGS);
+  printf("%-28s %8u %8zu %8zu %8zu %9d/%zu\n", "dictionary", (unsigned int) NUM_DICT_TAGS,
+         dict_table, dict_text, dict_table + dict_text, dict_named, NUM_TAP_TAGS);
+  printf("%-28s %8u %8zu %8zu %8zu\n", "dictionary as plain strings", (unsigned int) NUM_DICT_TAGS,
+         NUM_DICT_TAGS * 8, dict_strings, NUM_DICT_TAGS * 8 + dict_strings);
+  printf("\n");
+
+  printf("%-28s %12s %12s\n", "", "lookups", "ns/lookup");
+
+  // The old table hands back a pointer, and the formatter then reads the
+  // name. Count the read, so both give a name ready to print.
+  uint64_t start = cpuTimeNs();
+  size_t total = 0;
+  for (int n = 0; n < iterations; n++) {
+    for (unsigned int i = 0; i < NUM_TAP_TAGS; i++) {
+      total += strlen(old_tag_name(tap_tags[i].tag));
+    }
+  }
+  sink = total;
+  report("tap tags, old table", (unsigned long) iterations * NUM_TAP_TAGS, cpuTimeNs() - start);
+
+  start = cpuTimeNs();
+  total = 0;
+  for (int n = 0; n < iterations; n++) {
+    for (unsigned int i = 0; i < NUM_TAP_TAGS; i++) {
+      char name[TAG_NAME_MAX];
+      total += strlen(get_tag_name(tap_tags[i].tag, tap_tags[i].length, name, sizeof(name)));
+    }
+  }
+  sink = total;
+  report("tap tags, dictionary", (unsigned long) iterations * NUM_TAP_TAGS, cpuTimeNs() - start);
+
+  // Every entry, including the long names the old table didn't have
+  int rounds = iterations * NUM_TAP_TAGS / NUM_DICT_TAGS + 1;
+  start = cpuTimeNs();
+  total = 0;
+  for (int n = 0; n < rounds; n++) {
+    for (unsigned int i = 0; i < NUM_DICT_TAGS; i++) {
+      char name[TAG_NAME_MAX];
+      total += strlen(get_tag_name(tag_dict[i].tag, tag_dict[i].min_length, name, sizeof(name)));
+    }
+  }
+  sink = total;
+  report("all tags, dictionary", (unsigned long) rounds * NUM_DICT_TAGS, cpuTimeNs() - start);
+
+  // Unknown tags only search
+  start = cpuTimeNs();
+  total = 0;
+  for (int n = 0; n < iterations; n++) {
+    for (unsigned int i = 0; i < NUM_TAP_TAGS; i++) {
+      char name[TAG_NAME_MAX];
+      total += strlen(get_tag_name(0xDF00 | i, 4, name, sizeof(name)));
+    }
+  }
+  sink = total;
+  report("unknown tags, dictionary", (unsigned long) iterations * NUM_TAP_TAGS, cpuTimeNs() - start);
+  return 0;
+}
@@ -0,0 +1,170 @@
+//
+// Benchmark the card read flow on the host against a simulated card
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_bench [-b] [taps] [card-script]
+// -b uses the binary trace output instead of text.
+//
+// Reports APDUs and bytes exchanged per tap, the serial output per tap,
+// and the CPU time spent in each phase of the tap. A phase runs from the
+// command that starts it until the next command is sent, so it includes
+// decoding and printing the response.
+//
+// Build with -DTRACE_LEVEL=n to compare the trace levels (src/trace_level.h).
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <time.h>
+#include "emv_tag_names.h"
+#include "card_session.h"
+#include "trace_output.h"
+#include "trace_level.h"
+#include "virtual_card.h"
+
+enum TapPhase {
+  PHASE_DETECT,
+  PHASE_PPSE,
+  PHASE_SELECT,
+  PHASE_GPO,
+  PHASE_READ_RECORD,
+  PHASE_OTHER,
+  NUM_PHASES
+};
+
+static const char* phase_names[NUM_PHASES] = {
+  "detect", "ppse", "select", "gpo", "read record", "other"
+};
+
+static uint64_t cpuTimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Classify a command APDU by its instruction byte
+static TapPhase commandPhase(const uint8_t* tx, uint8_t tx_length)
+{
+  static const uint8_t ppse_name[] = { '2', 'P', 'A', 'Y' };
+  if (tx_length < 2) {
+    return PHASE_OTHER;
+  }
+  switch (tx[1]) {
+    case 0xA4:
+      if (tx_length >= 9 && memcmp(&tx[5], ppse_name, sizeof(ppse_name)) == 0) {
+        return PHASE_PPSE;
+      }
+      return PHASE_SELECT;
+    case 0xA8:
+      return PHASE_GPO;
+    case 0xB2:
+      return PHASE_READ_RECORD;
+  }
+  return PHASE_OTHER;
+}
+
+//
+// Transport wrapper that charges CPU time to the phase of the last command
+//
+class MeteredTransport : public CardTransport {
+public:
+  MeteredTransport(CardTransport& card) : card(card), phase(PHASE_DETECT), phase_start(0) {
+    memset(phase_ns, 0, sizeof(phase_ns));
+    memset(phase_count, 0, sizeof(phase_count));
+  }
+
+  bool detectCard() {
+    startPhase(PHASE_DETECT);
+    return card.detectCard();
+  }
+
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length) {
+    startPhase(commandPhase(tx, tx_length));
+    return card.transceive(tx, tx_length, rx, rx_length);
+  }
+
+  // Close out the current phase at the end of a tap
+  void endTap() {
+    startPhase(PHASE_DETECT);
+    phase_count[PHASE_DETECT]--;
+  }
+
+  uint64_t phase_ns[NUM_PHASES];
+  unsigned long phase_count[NUM_PHASES];
+
+private:
+  void startPhase(TapPhase next) {
+    uint64_t now = cpuTimeNs();
+    if (phase_start != 0) {
+      phase_ns[phase] += now - phase_start;
+    }
+    phase = next;
+    phase_count[phase]++;
+    phase_start = now;
+  }
+
+  CardTransport& card;
+  TapPhase phase;
+  uint64_t phase_start;
+};
+
+int main(int argc, char** argv)
+{
+  bool binary = argc > 1 && strcmp(argv[1], "-b") == 0;
+  if (binary) {
+    argc--;
+    argv++;
+  }
+
+  int taps = argc > 1 ? atoi(argv[1]) : 10000;
+  VirtualCard card;
+  if (argc > 2) {
+    if (!card.loadScriptFile(argv[2])) {
+      return 1;
+    }
+  } else {
+    card.loadDefaultCard();
+  }
+  if (taps <= 0) {
+    taps = 1;
+  }
+
+  MeteredTransport metered(card);
+
+  // The output is counted but not written
+  Serial.mute(true);
+  Serial.resetCount();
+  if (binary) {
+    setOutputMode(OUTPUT_BINARY);
+  }
+
+  uint64_t start = cpuTimeNs();
+  for (int i = 0; i < taps; i++) {
+    if (metered.detectCard()) {
+      readCard(metered);
+    }
+    metered.endTap();
+  }
+  uint64_t total_ns = cpuTimeNs() - start;
+
+  printf("trace level:          %d (%s)\n", TRACE_LEVEL, traceLevelName());
+  printf("taps:                 %d\n", taps);
+  printf("APDUs per tap:        %.2f\n", (double) card.apdu_count / taps);
+  printf("TX bytes per tap:     %.1f\n", (double) card.tx_bytes / taps);
+  printf("RX bytes per tap:     %.1f\n", (double) card.rx_bytes / taps);
+  printf("serial bytes per tap: %.1f\n", (double) Serial.bytesWritten() / taps);
+  printf("serial ms at 115200:  %.2f\n", Serial.bytesWritten() * 10 / 115.2 / taps);
+  printf("CPU per tap:          %.2f us\n", total_ns / 1000.0 / taps);
+  printf("\n%-12s %10s %14s\n", "phase", "count/tap", "CPU us/tap");
+  for (int p = 0; p < NUM_PHASES; p++) {
+    if (metered.phase_count[p] == 0) {
+      continue;
+    }
+    printf("%-12s %10.2f %14.2f\n", phase_names[p],
+           (double) metered.phase_count[p] / taps,
+           metered.phase_ns[p] / 1000.0 / taps);
+  }
+  return 0;
+}
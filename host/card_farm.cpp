@@ -0,0 +1,339 @@
+//
+// A farm of simulated cards for the host benchmarks
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include <set>
+#include "card_farm.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Scheme {
+  const char* name;
+  uint8_t aid[8];
+  uint8_t aid_length;
+  const char* label;
+};
+
+static const Scheme schemes[] = {
+  { "visa",       { 0xA0, 0x00, 0x00, 0x00, 0x03, 0x10, 0x10 }, 7, "VISA CREDIT" },
+  { "visa debit", { 0xA0, 0x00, 0x00, 0x00, 0x03, 0x20, 0x10 }, 7, "VISA DEBIT" },
+  { "mastercard", { 0xA0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10 }, 7, "MASTERCARD" },
+  { "maestro",    { 0xA0, 0x00, 0x00, 0x00, 0x04, 0x30, 0x60 }, 7, "MAESTRO" },
+  { "amex",       { 0xA0, 0x00, 0x00, 0x00, 0x25, 0x01 }, 6, "AMERICAN EXPRESS" },
+  { "discover",   { 0xA0, 0x00, 0x00, 0x01, 0x52, 0x30, 0x10 }, 7, "DISCOVER" },
+  { "jcb",        { 0xA0, 0x00, 0x00, 0x00, 0x65, 0x10, 0x10 }, 7, "JCB" },
+  { "unionpay",   { 0xA0, 0x00, 0x00, 0x03, 0x33, 0x01, 0x01, 0x01 }, 8, "UNIONPAY" },
+};
+
+#define NUM_SCHEMES ((int) (sizeof(schemes) / sizeof(schemes[0])))
+
+// PDOLs as tag and length pairs, from none to one asking for more
+// than the terminal profile has
+static const Bytes pdols[] = {
+  {},
+  { 0x9F, 0x66, 0x04, 0x9F, 0x02, 0x06, 0x9F, 0x37, 0x04, 0x5F, 0x2A, 0x02 },
+  { 0x9F, 0x66, 0x04, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05,
+    0x5F, 0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04 },
+  { 0x9F, 0x66, 0x04, 0x9F, 0x02, 0x06, 0x9F, 0x03, 0x06, 0x9F, 0x1A, 0x02, 0x95, 0x05,
+    0x5F, 0x2A, 0x02, 0x9A, 0x03, 0x9C, 0x01, 0x9F, 0x37, 0x04, 0x9F, 0x35, 0x01,
+    0x9F, 0x40, 0x05, 0x9F, 0x33, 0x03, 0x9F, 0x4E, 0x14, 0x9F, 0x7C, 0x14 },
+};
+
+#define NUM_PDOLS ((int) (sizeof(pdols) / sizeof(pdols[0])))
+
+static const uint8_t ppse_name[] = "2PAY.SYS.DDF01";
+
+// xorshift32: the same farm from the same seed, on every host
+class FarmRandom {
+public:
+  FarmRandom(uint32_t seed) : state(seed != 0 ? seed : 1) {}
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // From low to high, both included
+  int range(int low, int high) { return low + (int) (next() % (uint32_t) (high - low + 1)); }
+
+  Bytes bytes(int count) {
+    Bytes out;
+    for (int i = 0; i < count; i++) {
+      out.push_back((uint8_t) next());
+    }
+    return out;
+  }
+
+private:
+  uint32_t state;
+};
+
+static void putTLV(Bytes& out, uint16_t tag, const Bytes& value)
+{
+  if (tag > 0xFF) {
+    out.push_back(tag >> 8);
+  }
+  out.push_back(tag & 0xFF);
+  if (value.size() > 127) {
+    out.push_back(0x81);
+  }
+  out.push_back((uint8_t) value.size());
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+static Bytes text(const char* str)
+{
+  return Bytes(str, str + strlen(str));
+}
+
+static Bytes aidBytes(const Scheme& scheme)
+{
+  return Bytes(scheme.aid, scheme.aid + scheme.aid_length);
+}
+
+static void addSelect(VirtualCard& card, const Bytes& name, const Bytes& response)
+{
+  Bytes command = { 0x00, 0xA4, 0x04, 0x00, (uint8_t) name.size() };
+  command.insert(command.end(), name.begin(), name.end());
+  Bytes data = response;
+  data.push_back(0x90);
+  data.push_back(0x00);
+  card.addRule(command.data(), (uint8_t) command.size(), data.data(), (uint16_t) data.size());
+}
+
+//
+// Data for a record of about size bytes: the tags a record would hold,
+// taking the next group each time
+//
+static Bytes recordData(FarmRandom& random, int size, int& group)
+{
+  Bytes data;
+  while ((int) data.size() < size) {
+    Bytes tlvs;
+    switch (group++ % 6) {
+      case 0:
+        putTLV(tlvs, 0x57, random.bytes(19));
+        putTLV(tlvs, 0x5F20, text("CARDHOLDER/TEST"));
+        putTLV(tlvs, 0x9F1F, random.bytes(random.range(8, 20)));
+        break;
+      case 1:
+        putTLV(tlvs, 0x5A, random.bytes(8));
+        putTLV(tlvs, 0x5F24, { 0x28, 0x12, 0x31 });
+        putTLV(tlvs, 0x5F25, { 0x23, 0x01, 0x01 });
+        putTLV(tlvs, 0x5F28, { 0x08, 0x40 });
+        putTLV(tlvs, 0x5F34, { 0x01 });
+        break;
+      case 2:
+        putTLV(tlvs, 0x9F07, { 0xFF, 0x00 });
+        putTLV(tlvs, 0x8E, random.bytes(random.range(10, 18)));
+        putTLV(tlvs, 0x9F0D, random.bytes(5));
+        putTLV(tlvs, 0x9F0E, random.bytes(5));
+        putTLV(tlvs, 0x9F0F, random.bytes(5));
+        break;
+      case 3:
+        putTLV(tlvs, 0x8F, { (uint8_t) random.range(1, 9) });
+        putTLV(tlvs, 0x90, random.bytes(random.range(64, 176)));
+        putTLV(tlvs, 0x9F32, { 0x03 });
+        break;
+      case 4:
+        putTLV(tlvs, 0x8C, random.bytes(random.range(21, 33)));
+        putTLV(tlvs, 0x8D, random.bytes(random.range(4, 12)));
+        putTLV(tlvs, 0x5F30, { 0x02, 0x01 });
+        putTLV(tlvs, 0x9F4A, { 0x82 });
+        break;
+      default:
+        putTLV(tlvs, 0x9F46, random.bytes(random.range(64, 144)));
+        putTLV(tlvs, 0x9F47, { 0x03 });
+        break;
+    }
+    // 70 81 xx, and the status bytes, must fit a 255 byte response
+    if (!data.empty() && data.size() + tlvs.size() > 248) {
+      break;
+    }
+    data.insert(data.end(), tlvs.begin(), tlvs.end());
+  }
+  return data;
+}
+
+void CardFarm::build(int count, uint32_t seed)
+{
+  FarmRandom random(seed);
+  cards.assign(count, VirtualCard());
+  infos.assign(count, FarmCardInfo());
+
+  for (int i = 0; i < count; i++) {
+    VirtualCard& card = cards[i];
+    FarmCardInfo& info = infos[i];
+    const Scheme& scheme = schemes[random.range(0, NUM_SCHEMES - 1)];
+    const Bytes& pdol = pdols[random.range(0, NUM_PDOLS - 1)];
+
+    uint8_t uid[] = { 0x04, (uint8_t) (i >> 16), (uint8_t) (i >> 8), (uint8_t) i,
+                      (uint8_t) random.next(), (uint8_t) random.next(), (uint8_t) random.next() };
+    card.setUID(uid, sizeof(uid));
+
+    // Co-badged cards list a second application, with a lower priority
+    info.apps = random.range(0, 3) == 0 ? 2 : 1;
+    const Scheme& other = schemes[(&scheme - schemes + 1) % NUM_SCHEMES];
+
+    Bytes directory;
+    for (int app = 0; app < info.apps; app++) {
+      const Scheme& s = app == 0 ? scheme : other;
+      Bytes entry;
+      putTLV(entry, 0x4F, aidBytes(s));
+      putTLV(entry, 0x50, text(s.label));
+      putTLV(entry, 0x87, { (uint8_t) (app + 1) });
+      putTLV(directory, 0x61, entry);
+    }
+    Bytes fci_issuer, fci;
+    putTLV(fci_issuer, 0xBF0C, directory);
+    putTLV(fci, 0x84, Bytes(ppse_name, ppse_name + sizeof(ppse_name) - 1));
+    putTLV(fci, 0xA5, fci_issuer);
+    Bytes ppse;
+    putTLV(ppse, 0x6F, fci);
+    addSelect(card, Bytes(ppse_name, ppse_name + sizeof(ppse_name) - 1), ppse);
+
+    for (int app = 0; app < info.apps; app++) {
+      const Scheme& s = app == 0 ? scheme : other;
+      Bytes proprietary;
+      putTLV(proprietary, 0x50, text(s.label));
+      putTLV(proprietary, 0x87, { (uint8_t) (app + 1) });
+      if (!pdol.empty()) {
+        putTLV(proprietary, 0x9F38, pdol);
+      }
+      putTLV(proprietary, 0x5F2D, text("en"));
+      Bytes select_fci, select;
+      putTLV(select_fci, 0x84, aidBytes(s));
+      putTLV(select_fci, 0xA5, proprietary);
+      putTLV(select, 0x6F, select_fci);
+      addSelect(card, aidBytes(s), select);
+    }
+
+    // AFL: up to 3 files, 1 to 10 records in all
+    Bytes afl;
+    int files = random.range(1, 3);
+    int sfi = 1;
+    info.records = 0;
+    info.record_bytes = 0;
+    int group = 0;
+    for (int f = 0; f < files && info.records < 10; f++) {
+      int first = random.range(1, 2);
+      int last = first + random.range(0, min(3, 10 - info.records - 1));
+      afl.push_back((uint8_t) (sfi << 3));
+      afl.push_back((uint8_t) first);
+      afl.push_back((uint8_t) last);
+      afl.push_back((uint8_t) (f == 0 ? 1 : 0));
+      for (int record = first; record <= last; record++) {
+        static const int sizes[] = { 40, 90, 180, 240 };
+        Bytes data = recordData(random, sizes[random.range(0, 3)], group);
+        Bytes response;
+        putTLV(response, 0x70, data);
+        response.push_back(0x90);
+        response.push_back(0x00);
+        uint8_t command[] = { 0x00, 0xB2, (uint8_t) record, (uint8_t) ((sfi << 3) | 4) };
+        card.addRule(command, sizeof(command), response.data(), (uint16_t) response.size());
+        info.records++;
+        info.record_bytes += response.size();
+      }
+      sfi += random.range(1, 2);
+    }
+
+    Bytes gpo_data;
+    putTLV(gpo_data, 0x82, { 0x20, 0x00 });
+    putTLV(gpo_data, 0x94, afl);
+    putTLV(gpo_data, 0x9F36, random.bytes(2));
+    putTLV(gpo_data, 0x9F26, random.bytes(8));
+    putTLV(gpo_data, 0x9F10, random.bytes(random.range(7, 32)));
+    putTLV(gpo_data, 0x9F27, { 0x80 });
+    Bytes gpo;
+    putTLV(gpo, 0x77, gpo_data);
+    gpo.push_back(0x90);
+    gpo.push_back(0x00);
+    static const uint8_t gpo_command[] = { 0x80, 0xA8 };
+    card.addRule(gpo_command, sizeof(gpo_command), gpo.data(), (uint16_t) gpo.size());
+
+    info.scheme = scheme.name;
+    info.pdol_length = 0;
+    for (size_t k = 0; k + 1 < pdol.size(); ) {
+      k += (pdol[k] & 0x1F) == 0x1F ? 2 : 1;
+      info.pdol_length += pdol[k++];
+    }
+    info.chunk_size = random.range(0, 3) == 0 ? random.range(48, 128) : 256;
+    info.strict_le = random.range(0, 5) == 0;
+    card.setChunkSize(info.chunk_size);
+    card.setStrictLe(info.strict_le);
+  }
+}
+
+int CardFarm::schemeCount() const
+{
+  std::set<const char*> seen;
+  for (const FarmCardInfo& info : infos) {
+    seen.insert(info.scheme);
+  }
+  return (int) seen.size();
+}
+
+int CardFarm::pdolShapeCount() const
+{
+  std::set<int> seen;
+  for (const FarmCardInfo& info : infos) {
+    seen.insert(info.pdol_length);
+  }
+  return (int) seen.size();
+}
+
+int CardFarm::aflShapeCount() const
+{
+  std::set<int> seen;
+  for (const FarmCardInfo& info : infos) {
+    seen.insert(info.records);
+  }
+  return (int) seen.size();
+}
+
+FarmSlot::FarmSlot()
+  : farm(NULL), first(0), stride(1), index(0), latency_us(0)
+{
+}
+
+void FarmSlot::attach(CardFarm& farm, int first, int stride)
+{
+  this->farm = &farm;
+  this->first = first;
+  this->stride = stride;
+  index = first;
+}
+
+void FarmSlot::next()
+{
+  index += stride;
+  if (index >= farm->size()) {
+    index = first;
+  }
+}
+
+bool FarmSlot::detectCard()
+{
+  if (latency_us > 0) {
+    delayMicroseconds(latency_us);
+  }
+  return current().detectCard();
+}
+
+bool FarmSlot::getCardUID(uint8_t* uid, uint8_t* uid_length)
+{
+  return current().getCardUID(uid, uid_length);
+}
+
+bool FarmSlot::transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length)
+{
+  if (latency_us > 0) {
+    delayMicroseconds(latency_us);
+  }
+  return current().transceive(tx, tx_length, rx, rx_length);
+}
@@ -0,0 +1,81 @@
+#ifndef __CARD_FARM_H__
+#define __CARD_FARM_H__
+#include <stdint.h>
+#include <vector>
+#include "card_transport.h"
+#include "virtual_card.h"
+
+//
+// A farm of simulated cards for the host benchmarks
+//
+// build() makes cards that differ the way real ones do: the scheme and
+// AID, one or two applications in PPSE, no PDOL or PDOLs from 16 to 80
+// bytes, AFLs of 1 to 10 records in up to 3 files, and records from a
+// few bytes to near the 255 byte limit. A quarter of the cards send
+// their responses in parts, some only answer the exact Le. The cards
+// come from a seed, so the same seed gives the same farm in every build.
+//
+// A FarmSlot is the field of one reader. It holds one card of the farm
+// at a time, and next() swaps in another, as if the card was taken
+// away and the next one tapped.
+//
+
+struct FarmCardInfo {
+  const char* scheme;
+  uint8_t apps;             // Applications listed in PPSE
+  uint8_t pdol_length;      // Bytes of data the PDOL asks for
+  uint8_t records;          // Records in the AFL
+  uint16_t record_bytes;    // All the records, status bytes included
+  int chunk_size;           // Most response data per exchange
+  bool strict_le;
+};
+
+class CardFarm {
+public:
+  // Make count cards from the seed
+  void build(int count, uint32_t seed);
+
+  int size() const { return (int) cards.size(); }
+  VirtualCard& card(int i) { return cards[i]; }
+  const FarmCardInfo& info(int i) const { return infos[i]; }
+
+  // Number of different AIDs, PDOL lengths and AFL lengths in the farm
+  int schemeCount() const;
+  int pdolShapeCount() const;
+  int aflShapeCount() const;
+
+private:
+  std::vector<VirtualCard> cards;
+  std::vector<FarmCardInfo> infos;
+};
+
+class FarmSlot : public CardTransport {
+public:
+  FarmSlot();
+
+  // Take cards first, first + stride, first + 2 * stride... in turn
+  void attach(CardFarm& farm, int first, int stride);
+
+  // Take the card away and tap the next one
+  void next();
+
+  VirtualCard& current() { return farm->card(index); }
+
+  // Time each exchange and detection takes, as the RF link would
+  void setLatency(unsigned long us) { latency_us = us; }
+
+  // CardTransport
+  bool detectCard();
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length);
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length);
+  LinkError getLastError() { return current().getLastError(); }
+
+private:
+  CardFarm* farm;
+  int first;
+  int stride;
+  int index;
+  unsigned long latency_us;
+};
+
+#endif /* __CARD_FARM_H__ */
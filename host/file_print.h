@@ -0,0 +1,21 @@
+#ifndef __FILE_PRINT_H__
+#define __FILE_PRINT_H__
+#include <Arduino.h>
+#include <stdio.h>
+
+//
+// Print to a stdio file, for host tools that write traces
+//
+class FilePrint : public Print {
+public:
+  FilePrint(FILE* file) : file(file) {}
+
+  size_t write(uint8_t c) { return fputc(c, file) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, file); }
+  using Print::write;
+
+private:
+  FILE* file;
+};
+
+#endif /* __FILE_PRINT_H__ */
@@ -0,0 +1,115 @@
+//
+// Flash stand-in for the host: a file of erased sectors
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <string.h>
+#include "file_storage.h"
+
+bool FileStorage::open(const char* path, uint32_t size)
+{
+  close();
+  file = fopen(path, "r+b");
+  if (file == NULL) {
+    file = fopen(path, "w+b");
+  }
+  if (file == NULL) {
+    return false;
+  }
+  bytes = size / LOG_SECTOR_SIZE * LOG_SECTOR_SIZE;
+
+  // Extend with erased sectors
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  if (length < 0) {
+    close();
+    return false;
+  }
+  uint8_t erased[LOG_SECTOR_SIZE];
+  memset(erased, 0xff, sizeof(erased));
+  for (uint32_t offset = length / LOG_SECTOR_SIZE * LOG_SECTOR_SIZE; offset < bytes;
+       offset += LOG_SECTOR_SIZE) {
+    fseek(file, offset, SEEK_SET);
+    if (fwrite(erased, 1, sizeof(erased), file) != sizeof(erased)) {
+      close();
+      return false;
+    }
+  }
+  fflush(file);
+  clearCounts();
+  return true;
+}
+
+void FileStorage::close()
+{
+  if (file != NULL) {
+    fclose(file);
+    file = NULL;
+  }
+  bytes = 0;
+}
+
+void FileStorage::clearCounts()
+{
+  memset(&counts, 0, sizeof(counts));
+}
+
+bool FileStorage::read(uint32_t offset, void* data, uint32_t length)
+{
+  if (file == NULL || offset + length > bytes) {
+    return false;
+  }
+  counts.reads++;
+  counts.bytes_read += length;
+  return load(offset, data, length);
+}
+
+bool FileStorage::load(uint32_t offset, void* data, uint32_t length)
+{
+  return fseek(file, offset, SEEK_SET) == 0 && fread(data, 1, length, file) == length;
+}
+
+bool FileStorage::write(uint32_t offset, const void* data, uint32_t length)
+{
+  if (file == NULL || offset + length > bytes) {
+    return false;
+  }
+  uint8_t buffer[LOG_SECTOR_SIZE];
+  const uint8_t* source = (const uint8_t*) data;
+  for (uint32_t done = 0; done < length;) {
+    uint32_t part = length - done < sizeof(buffer) ? length - done : sizeof(buffer);
+    if (!load(offset + done, buffer, part)) {
+      return false;
+    }
+    // Bits can only be cleared
+    bool bad = false;
+    for (uint32_t i = 0; i < part; i++) {
+      bad |= (source[done + i] & ~buffer[i]) != 0;
+      buffer[i] &= source[done + i];
+    }
+    if (bad) {
+      counts.bad_writes++;
+    }
+    if (fseek(file, offset + done, SEEK_SET) != 0 || fwrite(buffer, 1, part, file) != part) {
+      return false;
+    }
+    done += part;
+  }
+  counts.writes++;
+  counts.bytes_written += length;
+  counts.pages_programmed += (offset + length - 1) / FLASH_PAGE_SIZE - offset / FLASH_PAGE_SIZE + 1;
+  return true;
+}
+
+bool FileStorage::eraseSector(uint32_t offset)
+{
+  if (file == NULL || offset % LOG_SECTOR_SIZE != 0 || offset + LOG_SECTOR_SIZE > bytes) {
+    return false;
+  }
+  uint8_t erased[LOG_SECTOR_SIZE];
+  memset(erased, 0xff, sizeof(erased));
+  counts.erases++;
+  return fseek(file, offset, SEEK_SET) == 0 &&
+         fwrite(erased, 1, sizeof(erased), file) == sizeof(erased);
+}
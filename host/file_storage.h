@@ -0,0 +1,54 @@
+#ifndef __FILE_STORAGE_H__
+#define __FILE_STORAGE_H__
+#include <stdint.h>
+#include <stdio.h>
+#include "log_storage.h"
+
+//
+// Flash stand-in for the host: a file of erased sectors
+//
+// Behaves as NOR flash does: a new file is all 0xFF, an erase sets a
+// sector back to 0xFF, and a write can only clear bits. Writing a 1
+// over a 0 leaves the 0, as the flash would, and is counted so a bad
+// log format shows up. The work done is counted for the benchmarks,
+// in bytes and in the 256 byte pages a flash chip programs at a time.
+//
+
+#define FLASH_PAGE_SIZE 256
+
+struct FlashCounts {
+  unsigned long reads;
+  unsigned long bytes_read;
+  unsigned long writes;
+  unsigned long bytes_written;
+  unsigned long pages_programmed;
+  unsigned long erases;
+  unsigned long bad_writes;       // Writes that needed a bit set
+};
+
+class FileStorage : public LogStorage {
+public:
+  FileStorage() : file(NULL), bytes(0) { clearCounts(); }
+  ~FileStorage() { close(); }
+
+  // Open a file of size bytes, made erased if it is new or smaller
+  bool open(const char* path, uint32_t size);
+  void close();
+
+  uint32_t size() { return bytes; }
+  bool read(uint32_t offset, void* data, uint32_t length);
+  bool write(uint32_t offset, const void* data, uint32_t length);
+  bool eraseSector(uint32_t offset);
+
+  const FlashCounts& getCounts() const { return counts; }
+  void clearCounts();
+
+private:
+  bool load(uint32_t offset, void* data, uint32_t length);
+
+  FILE* file;
+  uint32_t bytes;
+  FlashCounts counts;
+};
+
+#endif /* __FILE_STORAGE_H__ */
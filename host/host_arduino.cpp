@@ -0,0 +1,138 @@
+//
+// Minimal Arduino core stand-in for the host (Linux) build
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+
+static const std::chrono::steady_clock::time_point start_time =
+    std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+  return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long micros()
+{
+  return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+}
+
+void delay(unsigned long ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+/*** Print ***/
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t n = 0;
+  while (size-- > 0) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(const String& str)
+{
+  return write(str.c_str());
+}
+
+size_t Print::print(long n, int base)
+{
+  if (n < 0 && base == DEC) {
+    return print('-') + print((unsigned long) -n, base);
+  }
+  return print((unsigned long) n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    unsigned long digit = n % base;
+    n /= base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while (n != 0);
+  return write(p);
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+/*** HostSerial ***/
+
+size_t HostSerial::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t HostSerial::write(const uint8_t* buffer, size_t size)
+{
+  bytes_written += size;
+  if (!muted) {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+void HostSerial::flush()
+{
+  fflush(stdout);
+}
+
+/*** String ***/
+
+String::String(int n, unsigned char base)
+{
+  if (n < 0 && base == DEC) {
+    s = "-" + toString((unsigned long) -(long) n, base);
+  } else {
+    s = toString((unsigned int) n, base);
+  }
+}
+
+String::String(long n, unsigned char base)
+{
+  if (n < 0 && base == DEC) {
+    s = "-" + toString((unsigned long) -n, base);
+  } else {
+    s = toString((unsigned long) n, base);
+  }
+}
+
+// Arduino renders hex digits in lower case for String(n, HEX)
+std::string String::toString(unsigned long n, int base)
+{
+  std::string result;
+  do {
+    unsigned long digit = n % base;
+    n /= base;
+    result.insert(result.begin(), (char) (digit < 10 ? '0' + digit : 'a' + digit - 10));
+  } while (n != 0);
+  return result;
+}
@@ -0,0 +1,258 @@
+//
+// Run the card read flow on the host against a simulated card
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_sim [-m] [-b] [-q] [-r readers] [-w trace-file] [-c chunk] [-l]
+//                [-d debounce-ms] [-f every[:burst]] [-s] [card-script] [taps]
+// Use - for the card script to get the built in sample card.
+// -m is minimal read mode: stop once tags 5A, 5F24 and 57 are read.
+// -b writes the binary trace (decode with trace_decode).
+// -q sends the trace through output_queue, drained by a second thread,
+//    as the firmware's output task does. Nothing is dropped.
+// -r runs several virtual readers, each with its own copy of the card,
+//    through the ReaderScheduler. Each reader does the given taps.
+// -w records the exchanges to a trace file for apdu_replay.
+// -c has the card send responses in parts of at most chunk data bytes,
+//    each but the last ending with 61xx for GET RESPONSE.
+// -l has the card answer 6Cxx unless Le is the exact response length.
+// -d reads a card once until it has been away for debounce-ms. The
+//    virtual card never leaves, so each tap after the first is counted
+//    as suppressed. Prints the scheduler's detection statistics.
+// -f leaves burst exchanges (1 by default) unanswered after every
+//    `every` exchanges, as a weak field does, and prints the link
+//    statistics. A burst longer than the retries makes the reader
+//    activate the card again and resume the tap.
+// -s is the soak test: the trace is muted, and once every reader has
+//    done a tap, any allocation in the tap loop fails the run. Needs a
+//    MEM_TRACK build (native_sim_memcheck). Run thousands of taps.
+// A MEM_TRACK build prints the heap and stack use of each state.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "emv_tag_names.h"
+#include "card_session.h"
+#include "tap_stats.h"
+#include "gpo_cache.h"
+#include "aid_cache.h"
+#include "emv_format.h"
+#include "trace_output.h"
+#include "output_queue.h"
+#include "reader_scheduler.h"
+#include "apdu_trace.h"
+#include "retry_transport.h"
+#include "mem_stats.h"
+#include "virtual_card.h"
+#include "file_print.h"
+
+int main(int argc, char** argv)
+{
+  bool minimal_read = false;
+  bool binary = false;
+  bool queued = false;
+  int readers = 1;
+  const char* record_path = NULL;
+  int chunk_size = 256;
+  bool strict_le = false;
+  unsigned long debounce_ms = 0;
+  int fault_every = 0;
+  int fault_burst = 1;
+  bool soak = false;
+  while (argc > 1 && argv[1][0] == '-' && argv[1][1] != '\0') {
+    if (strcmp(argv[1], "-m") == 0) {
+      minimal_read = true;
+    } else if (strcmp(argv[1], "-b") == 0) {
+      binary = true;
+    } else if (strcmp(argv[1], "-q") == 0) {
+      queued = true;
+    } else if (strcmp(argv[1], "-r") == 0 && argc > 2) {
+      readers = atoi(argv[2]);
+      if (readers < 1 || readers > MAX_READERS) {
+        fprintf(stderr, "1 to %d readers\n", MAX_READERS);
+        return 1;
+      }
+      argc--;
+      argv++;
+    } else if (strcmp(argv[1], "-w") == 0 && argc > 2) {
+      record_path = argv[2];
+      argc--;
+      argv++;
+    } else if (strcmp(argv[1], "-c") == 0 && argc > 2) {
+      chunk_size = atoi(argv[2]);
+      if (chunk_size < 1) {
+        fprintf(stderr, "Chunk size must be at least 1\n");
+        return 1;
+      }
+      argc--;
+      argv++;
+    } else if (strcmp(argv[1], "-s") == 0) {
+      if (!MemStats::enabled()) {
+        fprintf(stderr, "The soak test needs a MEM_TRACK build (native_sim_memcheck)\n");
+        return 1;
+      }
+      soak = true;
+    } else if (strcmp(argv[1], "-l") == 0) {
+      strict_le = true;
+    } else if (strcmp(argv[1], "-f") == 0 && argc > 2) {
+      if (sscanf(argv[2], "%d:%d", &fault_every, &fault_burst) < 1 ||
+          fault_every < 1 || fault_burst < 1) {
+        fprintf(stderr, "Faults are every[:burst], both at least 1\n");
+        return 1;
+      }
+      argc--;
+      argv++;
+    } else if (strcmp(argv[1], "-d") == 0 && argc > 2) {
+      debounce_ms = strtoul(argv[2], NULL, 10);
+      argc--;
+      argv++;
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[1]);
+      return 1;
+    }
+    argc--;
+    argv++;
+  }
+
+  // The same card on each reader, with a different UID
+  VirtualCard cards[MAX_READERS];
+  for (int i = 0; i < readers; i++) {
+    if (argc > 1 && strcmp(argv[1], "-") != 0) {
+      if (!cards[i].loadScriptFile(argv[1])) {
+        return 1;
+      }
+    } else {
+      cards[i].loadDefaultCard();
+    }
+    uint8_t uid[] = { 0x04, 0xA1, 0xB2, (uint8_t) (0xC3 + i) };
+    cards[i].setUID(uid, sizeof(uid));
+    cards[i].setChunkSize(chunk_size);
+    cards[i].setStrictLe(strict_le);
+    cards[i].setFaults(fault_every, fault_burst);
+  }
+  int taps = argc > 2 ? atoi(argv[2]) : 1;
+
+  // Output thread, standing in for the firmware's output task
+  std::atomic<bool> done(false);
+  std::thread output_thread;
+  if (queued) {
+    output_queue.setPolicy(QUEUE_WAIT);
+    setOutputPort(output_queue);
+    output_thread = std::thread([&done]() {
+      while (!done.load()) {
+        if (output_queue.drain(Serial) == 0) {
+          delay(1);
+        }
+      }
+      output_queue.drain(Serial);
+    });
+  }
+
+  if (binary) {
+    setOutputMode(OUTPUT_BINARY);
+  }
+  trace_out.putLine("-------Read EMV via virtual card--------");
+  if (soak) {
+    trace_out.flush();
+    Serial.mute(true);
+  }
+
+  // Record what each reader exchanges with its card
+  FILE* record_file = NULL;
+  FilePrint* record_out = NULL;
+  CardTransport* transports[MAX_READERS];
+  for (int i = 0; i < readers; i++) {
+    transports[i] = &cards[i];
+  }
+  if (record_path != NULL) {
+    record_file = fopen(record_path, "wb");
+    if (record_file == NULL) {
+      fprintf(stderr, "Can't open %s\n", record_path);
+      return 1;
+    }
+    record_out = new FilePrint(record_file);
+    writeApduTraceHeader(*record_out);
+    for (int i = 0; i < readers; i++) {
+      transports[i] = new ApduRecorder(cards[i], *record_out, i);
+    }
+  }
+
+  // Same steps as loop() in the firmware, until the taps are done
+  mem_stats.track();
+  ReaderScheduler scheduler;
+  for (int i = 0; i < readers; i++) {
+    CardSession* session = new CardSession(*transports[i]);
+    session->useAidCache(&aid_cache);
+    session->setDebounce(debounce_ms);
+    if (minimal_read) {
+      static const uint16_t required_tags[] = { 0x5a, 0x5f24, 0x57 };
+      session->setRequiredTags(required_tags, sizeof(required_tags) / sizeof(required_tags[0]));
+    }
+    scheduler.addReader(*session);
+  }
+
+  if (readers == 1) {
+    for (int i = 0; i < taps; i++) {
+      while (scheduler.step()) {
+      }
+      // The first tap fills the caches and output buffers
+      mem_stats.setStrict(soak);
+    }
+  } else {
+    // Until every reader has done its taps. The card is always present,
+    // so the step limit only stops a card script that never completes.
+    long max_steps = (long) taps * readers * 1000;
+    for (long steps = 0; steps < max_steps; steps++) {
+      bool finished = true;
+      bool warm = true;
+      for (int i = 0; i < readers; i++) {
+        const ReaderStats& s = scheduler.getStats(i);
+        unsigned long ended = s.taps + s.failed + s.suppressed;
+        finished = finished && ended >= (unsigned long) taps && !scheduler.getSession(i).isActive();
+        warm = warm && ended >= 1;
+      }
+      if (finished) {
+        break;
+      }
+      mem_stats.setStrict(soak && warm);
+      scheduler.step();
+      if (!scheduler.anyReady()) {
+        // Every reader is waiting for its card, as in runSession()
+        delay(1);
+      }
+    }
+  }
+  mem_stats.setStrict(false);
+  if (soak) {
+    Serial.mute(false);
+  }
+  if (readers > 1 || debounce_ms > 0) {
+    scheduler.printStats();
+  }
+  tap_stats.print();
+  if (fault_every > 0) {
+    link_stats.print();
+  }
+  gpo_cache.printStats();
+  aid_cache.printStats();
+  if (MemStats::enabled()) {
+    mem_stats.print();
+  }
+  if (queued) {
+    output_queue.printStats();
+    done.store(true);
+    output_thread.join();
+  }
+  trace_out.flush();
+  Serial.flush();
+  if (record_file != NULL) {
+    fclose(record_file);
+  }
+  if (soak && mem_stats.getViolations() > 0) {
+    fprintf(stderr, "Soak test failed: the tap loop allocated\n");
+    return 1;
+  }
+  return 0;
+}
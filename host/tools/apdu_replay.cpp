@@ -0,0 +1,298 @@
+//
+// Replay recorded card exchanges through the card session
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: apdu_replay [-v] [-n repeat] trace-file...
+//
+// Runs every tap in the traces (src/apdu_trace.h) through CardSession
+// as fast as possible, with the recorded responses standing in for the
+// card. A trace file is either binary, as written by emv_sim -w, or a
+// capture of the serial port holding the firmware's hex dump (the r
+// command). Taps are replayed in recorded order, with the AID cache,
+// as on the firmware.
+//
+// A command the session sends is matched against the recorded ones
+// still to come in the tap, so a tap recorded before a card was cached
+// still replays after. GET PROCESSING OPTIONS is matched on its header
+// only, as its data can change with the terminal settings.
+//
+// -v prints the session trace, -n replays all the taps several times.
+// Exits with status 1 if a command had no recorded response.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+#include "card_session.h"
+#include "aid_cache.h"
+#include "tap_stats.h"
+#include "emv_format.h"
+#include "apdu_trace.h"
+
+struct Exchange {
+  std::vector<uint8_t> command;
+  std::vector<uint8_t> response;
+  bool ok;
+};
+
+struct Tap {
+  uint8_t reader;
+  std::vector<uint8_t> uid;
+  std::vector<Exchange> exchanges;
+  unsigned long recorded_us;
+};
+
+//
+// Card that answers with the responses recorded for one tap
+//
+class ReplayCard : public CardTransport {
+public:
+  ReplayCard() : unmatched(0), skipped(0), tap(NULL), pos(0), present(false) {}
+
+  void load(const Tap* tap)
+  {
+    this->tap = tap;
+    pos = 0;
+    present = true;
+  }
+
+  // Recorded exchanges the session didn't ask for
+  size_t unused() const { return tap->exchanges.size() - pos; }
+
+  bool detectCard()
+  {
+    bool found = present;
+    present = false;
+    return found;
+  }
+
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length)
+  {
+    if (tap->uid.empty() || tap->uid.size() > *uid_length) {
+      return false;
+    }
+    memcpy(uid, tap->uid.data(), tap->uid.size());
+    *uid_length = tap->uid.size();
+    return true;
+  }
+
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length)
+  {
+    for (size_t i = pos; i < tap->exchanges.size(); i++) {
+      const Exchange& e = tap->exchanges[i];
+      if (!matches(e.command, tx, tx_length)) {
+        continue;
+      }
+      skipped += i - pos;
+      pos = i + 1;
+      if (!e.ok || e.response.size() > *rx_length) {
+        return false;
+      }
+      memcpy(rx, e.response.data(), e.response.size());
+      *rx_length = e.response.size();
+      return true;
+    }
+    unmatched++;
+    return false;
+  }
+
+  unsigned long unmatched;    // Commands with no recorded response
+  unsigned long skipped;      // Recorded exchanges passed over
+
+private:
+  static bool matches(const std::vector<uint8_t>& recorded, const uint8_t* tx, uint8_t tx_length)
+  {
+    if (tx_length >= 4 && recorded.size() >= 4 && tx[1] == 0xA8) {
+      return memcmp(recorded.data(), tx, 4) == 0;
+    }
+    return recorded.size() == tx_length && memcmp(recorded.data(), tx, tx_length) == 0;
+  }
+
+  const Tap* tap;
+  size_t pos;
+  bool present;
+};
+
+//
+// Split a trace into taps. Return false if it isn't a trace.
+//
+static bool parseTrace(const uint8_t* trace, size_t length, std::vector<Tap>& taps)
+{
+  ApduTraceReader reader(trace, length);
+  if (!reader.isValid()) {
+    return false;
+  }
+
+  // Index in taps of the tap in progress on each reader
+  long current[16];
+  for (int i = 0; i < 16; i++) {
+    current[i] = -1;
+  }
+
+  ApduRecord record;
+  while (reader.next(record)) {
+    if (record.type == APDU_TAP) {
+      Tap tap;
+      tap.reader = record.reader;
+      tap.uid.assign(record.data, record.data + record.length);
+      tap.recorded_us = 0;
+      current[record.reader] = taps.size();
+      taps.push_back(tap);
+      continue;
+    }
+    if (current[record.reader] < 0) {
+      continue;
+    }
+    Tap& tap = taps[current[record.reader]];
+    tap.recorded_us += record.delta_us;
+    if (record.type == APDU_COMMAND) {
+      Exchange e;
+      e.command.assign(record.data, record.data + record.length);
+      e.ok = false;
+      tap.exchanges.push_back(e);
+    } else if (record.type == APDU_RESPONSE && !tap.exchanges.empty()) {
+      tap.exchanges.back().response.assign(record.data, record.data + record.length);
+      tap.exchanges.back().ok = true;
+    }
+  }
+  return true;
+}
+
+//
+// Find the hex dumps in a serial capture and parse each one
+//
+static bool parseCapture(const std::vector<uint8_t>& text, std::vector<Tap>& taps)
+{
+  static const char begin[] = "-----BEGIN APDU TRACE-----";
+  static const char end[] = "-----END APDU TRACE-----";
+  std::string s(text.begin(), text.end());
+  bool found = false;
+
+  size_t pos = 0;
+  while ((pos = s.find(begin, pos)) != std::string::npos) {
+    pos += sizeof(begin) - 1;
+    size_t stop = s.find(end, pos);
+    if (stop == std::string::npos) {
+      stop = s.size();
+    }
+    std::vector<uint8_t> trace;
+    int nibbles = 0;
+    uint8_t value = 0;
+    for (size_t i = pos; i < stop; i++) {
+      char c = s[i];
+      int digit = c >= '0' && c <= '9' ? c - '0' :
+                  c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+                  c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+      if (digit < 0) {
+        continue;
+      }
+      value = value << 4 | digit;
+      if (++nibbles % 2 == 0) {
+        trace.push_back(value);
+      }
+    }
+    found = parseTrace(trace.data(), trace.size(), taps) || found;
+    pos = stop;
+  }
+  return found;
+}
+
+static bool loadFile(const char* path, std::vector<Tap>& taps)
+{
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "Can't open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(f);
+
+  if (parseTrace(data.data(), data.size(), taps) || parseCapture(data, taps)) {
+    return true;
+  }
+  fprintf(stderr, "No APDU trace in %s\n", path);
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  bool verbose = false;
+  int repeat = 1;
+  while (argc > 1 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[1], "-n") == 0 && argc > 2) {
+      repeat = atoi(argv[2]);
+      argc--;
+      argv++;
+    } else {
+      fprintf(stderr, "Usage: apdu_replay [-v] [-n repeat] trace-file...\n");
+      return 1;
+    }
+    argc--;
+    argv++;
+  }
+
+  std::vector<Tap> taps;
+  for (int i = 1; i < argc; i++) {
+    if (!loadFile(argv[i], taps)) {
+      return 1;
+    }
+  }
+  if (taps.empty()) {
+    fprintf(stderr, "No taps to replay\n");
+    return 1;
+  }
+
+  unsigned long recorded_us = 0;
+  unsigned long recorded_exchanges = 0;
+  for (size_t i = 0; i < taps.size(); i++) {
+    recorded_us += taps[i].recorded_us;
+    recorded_exchanges += taps[i].exchanges.size();
+  }
+
+  Serial.mute(!verbose);
+  ReplayCard card;
+  CardSession session(card);
+  session.useAidCache(&aid_cache);
+
+  unsigned long done = 0, failed = 0, unused = 0;
+  unsigned long start = micros();
+  for (int r = 0; r < repeat; r++) {
+    for (size_t i = 0; i < taps.size(); i++) {
+      card.load(&taps[i]);
+      while (session.step()) {
+      }
+      if (session.getState() == SESSION_DONE) {
+        done++;
+      } else {
+        failed++;
+      }
+      unused += card.unused();
+    }
+  }
+  unsigned long elapsed = micros() - start;
+  trace_out.flush();
+  Serial.mute(false);
+
+  unsigned long total = taps.size() * repeat;
+  printf("taps               %lu (%lu in the traces, %lu exchanges)\n",
+         total, (unsigned long) taps.size(), recorded_exchanges);
+  printf("completed          %lu\n", done);
+  printf("failed             %lu\n", failed);
+  printf("unmatched commands %lu\n", card.unmatched);
+  printf("skipped exchanges  %lu\n", card.skipped);
+  printf("unused exchanges   %lu\n", unused);
+  printf("replay time        %lu us, %.1f us per tap, %.0f taps/s\n",
+         elapsed, (double) elapsed / total, total * 1e6 / (elapsed > 0 ? elapsed : 1));
+  printf("recorded tap time  %.1f us per tap\n", (double) recorded_us / taps.size());
+  tap_stats.print();
+  Serial.flush();
+  return card.unmatched > 0 ? 1 : 0;
+}
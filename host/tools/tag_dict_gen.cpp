@@ -0,0 +1,317 @@
+//
+// Generate the compressed tag name dictionary
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: tag_dict_gen [tag-list] > src/emv_tag_dict.h
+//
+// Reads the tag list (host/tools/emv_tags.txt) from a file or stdin and
+// writes the dictionary used by get_tag_name (src/emv_tag_names.h).
+//
+// The names are byte pair encoded. The pair of bytes seen most often
+// across all names is given a byte of its own from 0x80 up, and
+// replaced, until no pair is seen often enough to pay for its two
+// bytes in the pair table or the 128 codes run out. The names are
+// ASCII, so a byte below 0x80 is always a character. This finds
+// shared words and word endings ("Application ", "ion ", " Code")
+// without a word list, and decodes with a small stack.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#define FIRST_CODE 0x80
+#define NUM_CODES 128
+#define ANY_LENGTH_MAX 255
+
+struct TagLine {
+  unsigned int tag;
+  unsigned int min_length;
+  unsigned int max_length;
+  bool ranged;
+  std::string name;
+  int line;
+};
+
+static std::string trim(const std::string& s)
+{
+  size_t start = s.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos) {
+    return "";
+  }
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(start, end - start + 1);
+}
+
+// TAG [MIN-MAX] NAME
+static bool parseLine(const std::string& text, int line, TagLine& out)
+{
+  char* end;
+  out.tag = strtoul(text.c_str(), &end, 16);
+  size_t tag_digits = end - text.c_str();
+  if (tag_digits == 0 || tag_digits > 4 || tag_digits % 2 != 0 || (*end != ' ' && *end != '\t')) {
+    fprintf(stderr, "Line %d: expected a 1 or 2 byte hex tag\n", line);
+    return false;
+  }
+  std::string rest = trim(end);
+
+  out.ranged = false;
+  out.min_length = 0;
+  out.max_length = ANY_LENGTH_MAX;
+  unsigned int min_length, max_length;
+  int used = 0;
+  if (sscanf(rest.c_str(), "%u-%u %n", &min_length, &max_length, &used) == 2 && used > 0) {
+    if (min_length > max_length || max_length >= ANY_LENGTH_MAX) {
+      fprintf(stderr, "Line %d: bad length range\n", line);
+      return false;
+    }
+    out.ranged = true;
+    out.min_length = min_length;
+    out.max_length = max_length;
+    rest = trim(rest.substr(used));
+  }
+
+  if (rest.empty() || rest.size() > 255) {
+    fprintf(stderr, "Line %d: expected a name of 1 to 255 characters\n", line);
+    return false;
+  }
+  for (unsigned char c : rest) {
+    if (c < 0x20 || c >= FIRST_CODE) {
+      fprintf(stderr, "Line %d: names must be printable ASCII\n", line);
+      return false;
+    }
+  }
+  out.name = rest;
+  out.line = line;
+  return true;
+}
+
+// Count each pair once per place it can be replaced
+static std::map<unsigned int, int> countPairs(const std::vector<std::vector<uint8_t>>& names)
+{
+  std::map<unsigned int, int> counts;
+  for (const std::vector<uint8_t>& name : names) {
+    for (size_t i = 0; i + 1 < name.size(); i++) {
+      counts[(name[i] << 8) | name[i + 1]]++;
+      // "aaa" holds one "aa" that can be replaced, not two
+      if (i + 2 < name.size() && name[i] == name[i + 1] && name[i + 1] == name[i + 2]) {
+        i++;
+      }
+    }
+  }
+  return counts;
+}
+
+static void replacePair(std::vector<uint8_t>& name, uint8_t a, uint8_t b, uint8_t code)
+{
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i < name.size(); i++) {
+    if (i + 1 < name.size() && name[i] == a && name[i + 1] == b) {
+      out.push_back(code);
+      i++;
+    } else {
+      out.push_back(name[i]);
+    }
+  }
+  name = out;
+}
+
+static std::string expand(const std::vector<std::pair<uint8_t, uint8_t>>& pairs, uint8_t c)
+{
+  if (c < FIRST_CODE) {
+    return std::string(1, (char) c);
+  }
+  const std::pair<uint8_t, uint8_t>& p = pairs[c - FIRST_CODE];
+  return expand(pairs, p.first) + expand(pairs, p.second);
+}
+
+// Quoted, for a comment
+static std::string quote(const std::string& s)
+{
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  out += "\"";
+  return out;
+}
+
+int main(int argc, char** argv)
+{
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "r");
+    if (in == NULL) {
+      fprintf(stderr, "Can't open %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  std::vector<TagLine> lines;
+  char buffer[512];
+  int line = 0;
+  while (fgets(buffer, sizeof(buffer), in) != NULL) {
+    line++;
+    std::string text = trim(buffer);
+    if (text.empty() || text[0] == '#') {
+      continue;
+    }
+    TagLine entry;
+    if (!parseLine(text, line, entry)) {
+      return 1;
+    }
+    lines.push_back(entry);
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (lines.empty()) {
+    fprintf(stderr, "No tags\n");
+    return 1;
+  }
+
+  // By tag, keeping the order of the entries for one tag
+  std::stable_sort(lines.begin(), lines.end(), [](const TagLine& a, const TagLine& b) {
+    return a.tag < b.tag;
+  });
+  for (size_t i = 0; i < lines.size(); i++) {
+    bool last_for_tag = i + 1 == lines.size() || lines[i + 1].tag != lines[i].tag;
+    if (lines[i].ranged == last_for_tag) {
+      fprintf(stderr, "Line %d: tag %X needs exactly one entry without a length range, last\n",
+              lines[i].line, lines[i].tag);
+      return 1;
+    }
+  }
+
+  // Each name once, even when several tags share it
+  std::vector<std::string> names;
+  std::map<std::string, size_t> name_index;
+  size_t text_size = 0;
+  size_t longest = 0;
+  for (const TagLine& entry : lines) {
+    if (name_index.count(entry.name) == 0) {
+      name_index[entry.name] = names.size();
+      names.push_back(entry.name);
+      text_size += entry.name.size() + 1;
+      longest = std::max(longest, entry.name.size());
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> encoded;
+  for (const std::string& name : names) {
+    encoded.push_back(std::vector<uint8_t>(name.begin(), name.end()));
+  }
+
+  // A pair must turn up three times to save more than its table entry
+  std::vector<std::pair<uint8_t, uint8_t>> pairs;
+  std::vector<int> depth(256, 0);
+  int max_depth = 0;
+  while (pairs.size() < NUM_CODES) {
+    std::map<unsigned int, int> counts = countPairs(encoded);
+    unsigned int best = 0;
+    int best_count = 0;
+    for (const auto& count : counts) {
+      if (count.second > best_count) {
+        best = count.first;
+        best_count = count.second;
+      }
+    }
+    if (best_count < 3) {
+      break;
+    }
+    uint8_t a = best >> 8;
+    uint8_t b = best & 0xFF;
+    uint8_t code = (uint8_t) (FIRST_CODE + pairs.size());
+    pairs.push_back(std::make_pair(a, b));
+    depth[code] = 1 + std::max(depth[a], depth[b]);
+    max_depth = std::max(max_depth, depth[code]);
+    for (std::vector<uint8_t>& name : encoded) {
+      replacePair(name, a, b, code);
+    }
+  }
+
+  // Length byte, then the encoded name
+  std::vector<size_t> offsets;
+  size_t packed_size = 0;
+  for (const std::vector<uint8_t>& name : encoded) {
+    offsets.push_back(packed_size);
+    packed_size += 1 + name.size();
+  }
+  if (packed_size > 0xFFFF) {
+    fprintf(stderr, "Names don't fit 16 bit offsets\n");
+    return 1;
+  }
+
+  size_t dict_size = lines.size() * 6 + pairs.size() * 2 + packed_size;
+  printf("#ifndef __EMV_TAG_DICT_H__\n");
+  printf("#define __EMV_TAG_DICT_H__\n");
+  printf("#include <stdint.h>\n\n");
+  printf("//\n");
+  printf("// EMV tag name dictionary\n");
+  printf("//\n");
+  printf("// Generated by host/tools/tag_dict_gen from host/tools/emv_tags.txt.\n");
+  printf("// Do not edit, change the list and regenerate.\n");
+  printf("//\n");
+  printf("// %zu entries, %zu names. %zu bytes of names as strings, %zu bytes\n",
+         lines.size(), names.size(), text_size, packed_size);
+  printf("// encoded with %zu pairs; %zu bytes in all.\n", pairs.size(), dict_size);
+  printf("//\n");
+  printf("// A name byte below 0x%02X is a character. A byte from 0x%02X up stands\n",
+         FIRST_CODE, FIRST_CODE);
+  printf("// for the two bytes in tag_dict_pairs[byte - 0x%02X], either of which may\n",
+         FIRST_CODE);
+  printf("// stand for a pair again, down to TAG_DICT_DEPTH levels.\n");
+  printf("//\n\n");
+
+  printf("#define TAG_DICT_NAME_MAX %zu   // Longest name, with the terminator\n", longest + 1);
+  printf("#define TAG_DICT_FIRST_CODE 0x%02X\n", FIRST_CODE);
+  printf("#define TAG_DICT_DEPTH %d\n\n", max_depth);
+
+  printf("struct TagDictEntry {\n");
+  printf("  uint16_t tag;\n");
+  printf("  uint8_t min_length;   // Value lengths the name is for\n");
+  printf("  uint8_t max_length;\n");
+  printf("  uint16_t name;        // Offset in tag_dict_text\n");
+  printf("};\n\n");
+
+  printf("static constexpr uint8_t tag_dict_pairs[][2] = {\n");
+  for (size_t i = 0; i < pairs.size(); i++) {
+    printf("  { 0x%02X, 0x%02X },  // %02zX %s\n", pairs[i].first, pairs[i].second,
+           FIRST_CODE + i, quote(expand(pairs, (uint8_t) (FIRST_CODE + i))).c_str());
+  }
+  printf("};\n\n");
+
+  printf("// Each name is its encoded length, then the encoded bytes\n");
+  printf("static constexpr uint8_t tag_dict_text[] = {\n");
+  for (size_t i = 0; i < encoded.size(); i++) {
+    printf("  // %zu %s\n ", offsets[i], quote(names[i]).c_str());
+    printf(" %zu,", encoded[i].size());
+    for (uint8_t c : encoded[i]) {
+      printf(" 0x%02X,", c);
+    }
+    printf("\n");
+  }
+  printf("};\n\n");
+
+  printf("// Sorted by tag. Entries for one length range come before the entry\n");
+  printf("// for any length of the same tag.\n");
+  printf("static constexpr TagDictEntry tag_dict[] = {\n");
+  for (const TagLine& entry : lines) {
+    char tag[8];
+    snprintf(tag, sizeof(tag), "0x%X,", entry.tag);
+    printf("  { %-7s %3u, %3u, %4zu },  // %s\n", tag, entry.min_length,
+           entry.max_length, offsets[name_index[entry.name]], entry.name.c_str());
+  }
+  printf("};\n\n");
+
+  printf("#endif /* __EMV_TAG_DICT_H__ */\n");
+  return 0;
+}
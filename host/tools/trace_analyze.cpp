@@ -0,0 +1,600 @@
+//
+// Aggregate statistics over a corpus of recorded taps
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: emv_analyze [-j threads] [-t top] trace-file-or-directory...
+//
+// Reads binary APDU traces (src/apdu_trace.h), e.g. from emv_sim -w,
+// and reports over all the taps in them:
+//   - the AIDs selected, with their labels
+//   - AFL shapes: SFI and record ranges from the GPO response
+//   - records read per tap
+//   - PDOL variants, and what buildDataOptionsList makes of each
+//   - status words, and how often each tag appears
+//   - exchange times per phase as recorded, and decode and DOL build
+//     times measured here
+//
+// Files are memory mapped and shared out over a pool of threads. Each
+// thread has its own deque of files, and takes from the others when
+// it runs out. Responses are decoded into a per-thread arena that is
+// reset after each tap, and statistics are kept per thread and merged
+// at the end, so the threads share nothing while they work.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tlv.h"
+#include "emv_tag_names.h"
+#include "emv_reader.h"
+#include "tap_stats.h"
+#include "apdu_trace.h"
+
+#define ARENA_SIZE (64 * 1024)
+#define MAX_TRACE_READERS 16
+
+//
+// Bump allocator for the decoded responses of one tap
+//
+class ThreadArena {
+public:
+  ThreadArena() : memory(ARENA_SIZE), used(0) {}
+
+  void* alloc(size_t size)
+  {
+    size = (size + 7) & ~(size_t) 7;
+    if (size > memory.size() - used) {
+      return NULL;
+    }
+    void* p = &memory[used];
+    used += size;
+    return p;
+  }
+
+  void reset() { used = 0; }
+
+private:
+  std::vector<uint8_t> memory;
+  size_t used;
+};
+
+struct PdolVariant {
+  unsigned long count;
+  int data_length;
+  int unknown_tags;
+  int length_mismatches;
+};
+
+//
+// Statistics gathered by one thread
+//
+struct Analysis {
+  Analysis() : files(0), bad_files(0), taps(0), exchanges(0), failed(0), bytes(0) {}
+
+  void merge(const Analysis& other);
+
+  unsigned long files;
+  unsigned long bad_files;
+  unsigned long taps;
+  unsigned long exchanges;
+  unsigned long failed;
+  unsigned long long bytes;
+  std::unordered_map<std::string, unsigned long> aids;
+  std::unordered_map<std::string, unsigned long> afls;
+  std::map<int, unsigned long> record_counts;
+  std::unordered_map<std::string, PdolVariant> pdols;
+  std::map<uint16_t, unsigned long> status_words;
+  std::map<uint16_t, unsigned long> tags;
+  TapStats timing;
+};
+
+template <typename Map>
+static void mergeCounts(Map& into, const Map& from)
+{
+  for (typename Map::const_iterator i = from.begin(); i != from.end(); ++i) {
+    into[i->first] += i->second;
+  }
+}
+
+void Analysis::merge(const Analysis& other)
+{
+  files += other.files;
+  bad_files += other.bad_files;
+  taps += other.taps;
+  exchanges += other.exchanges;
+  failed += other.failed;
+  bytes += other.bytes;
+  mergeCounts(aids, other.aids);
+  mergeCounts(afls, other.afls);
+  mergeCounts(record_counts, other.record_counts);
+  mergeCounts(status_words, other.status_words);
+  mergeCounts(tags, other.tags);
+  for (auto i = other.pdols.begin(); i != other.pdols.end(); ++i) {
+    PdolVariant& v = pdols[i->first];
+    unsigned long count = v.count;
+    v = i->second;
+    v.count += count;
+  }
+  timing.merge(other.timing);
+}
+
+static std::string toHex(const uint8_t* data, int length)
+{
+  static const char digits[] = "0123456789ABCDEF";
+  std::string s;
+  s.reserve(length * 2);
+  for (int i = 0; i < length; i++) {
+    s += digits[data[i] >> 4];
+    s += digits[data[i] & 0x0f];
+  }
+  return s;
+}
+
+//
+// Work for one thread: analyse the taps in a trace
+//
+class Worker {
+public:
+  Analysis analysis;
+
+  void analyzeFile(const char* path);
+
+private:
+  struct TapState {
+    bool active;
+    const uint8_t* command;
+    uint8_t command_length;
+    int records;
+
+    // Response data so far, joining the parts of one sent with 61xx
+    std::vector<uint8_t> response;
+    const uint8_t* response_command;
+    uint8_t response_command_length;
+    uint32_t response_us;
+  };
+
+  void analyzeTrace(const uint8_t* trace, size_t length);
+  void startTap(TapState& tap);
+  void endTap(TapState& tap);
+  void addResponse(TapState& tap, const ApduRecord& record);
+  void analyzeExchange(TapState& tap, const uint8_t* command, uint8_t command_length,
+                       const uint8_t* response, size_t response_length, uint32_t delta_us);
+  TLVS* decode(const uint8_t* data, int length);
+  void countTags(TLVNode* node);
+
+  ThreadArena arena;
+};
+
+void Worker::analyzeFile(const char* path)
+{
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    analysis.bad_files++;
+    return;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    analysis.bad_files++;
+    return;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  analyzeTrace((const uint8_t*) map, st.st_size);
+  munmap(map, st.st_size);
+}
+
+void Worker::analyzeTrace(const uint8_t* trace, size_t length)
+{
+  ApduTraceReader reader(trace, length);
+  if (!reader.isValid()) {
+    analysis.bad_files++;
+    return;
+  }
+  analysis.files++;
+  analysis.bytes += length;
+
+  TapState taps[MAX_TRACE_READERS];
+  for (int i = 0; i < MAX_TRACE_READERS; i++) {
+    taps[i].active = false;
+  }
+
+  ApduRecord record;
+  while (reader.next(record)) {
+    TapState& tap = taps[record.reader];
+    switch (record.type) {
+      case APDU_TAP:
+        endTap(tap);
+        startTap(tap);
+        break;
+      case APDU_COMMAND:
+        tap.command = record.data;
+        tap.command_length = record.length;
+        break;
+      case APDU_RESPONSE:
+        if (tap.active && tap.command != NULL) {
+          addResponse(tap, record);
+        }
+        tap.command = NULL;
+        break;
+      case APDU_FAILED:
+        analysis.failed++;
+        tap.command = NULL;
+        break;
+    }
+  }
+  for (int i = 0; i < MAX_TRACE_READERS; i++) {
+    endTap(taps[i]);
+  }
+}
+
+void Worker::startTap(TapState& tap)
+{
+  tap.active = true;
+  tap.command = NULL;
+  tap.response_command = NULL;
+  tap.records = 0;
+}
+
+void Worker::endTap(TapState& tap)
+{
+  if (!tap.active) {
+    return;
+  }
+  analysis.taps++;
+  analysis.record_counts[tap.records]++;
+  tap.active = false;
+
+  // Decoded responses are only needed until the end of the tap
+  arena.reset();
+}
+
+TLVS* Worker::decode(const uint8_t* data, int length)
+{
+  void* p = arena.alloc(sizeof(TLVS));
+  if (p == NULL) {
+    // A tap with more responses than fit, start over
+    arena.reset();
+    p = arena.alloc(sizeof(TLVS));
+  }
+  TLVS* tlvs = new (p) TLVS();
+
+  unsigned long start = micros();
+  tlvs->decodeTLVs(data, length);
+  analysis.timing.phases[STAT_DECODE].record(micros() - start);
+  return tlvs;
+}
+
+void Worker::countTags(TLVNode* node)
+{
+  if (node == NULL) {
+    return;
+  }
+  analysis.tags[node->getTag()]++;
+  for (TLVNode* child = node->firstChild(); child != NULL; child = node->nextChild(child)) {
+    countTags(child);
+  }
+}
+
+void Worker::addResponse(TapState& tap, const ApduRecord& record)
+{
+  analysis.exchanges++;
+  if (record.length < 2) {
+    return;
+  }
+  uint8_t sw1 = record.data[record.length - 2];
+  uint8_t sw2 = record.data[record.length - 1];
+  analysis.status_words[sw1 << 8 | sw2]++;
+
+  // GET RESPONSE continues the response of the command before
+  bool get_response = tap.command_length == 5 && tap.command[1] == 0xC0;
+  if (get_response && tap.response_command != NULL) {
+    tap.response.insert(tap.response.end(), record.data, record.data + record.length - 2);
+    tap.response_us += record.delta_us;
+  } else {
+    tap.response.assign(record.data, record.data + record.length - 2);
+    tap.response_command = tap.command;
+    tap.response_command_length = tap.command_length;
+    tap.response_us = record.delta_us;
+  }
+  if (sw1 == 0x61) {
+    return;
+  }
+
+  tap.response.push_back(sw1);
+  tap.response.push_back(sw2);
+  analyzeExchange(tap, tap.response_command, tap.response_command_length,
+                  tap.response.data(), tap.response.size(), tap.response_us);
+  tap.response_command = NULL;
+}
+
+void Worker::analyzeExchange(TapState& tap, const uint8_t* command, uint8_t command_length,
+                             const uint8_t* response, size_t response_length, uint32_t delta_us)
+{
+  static const uint8_t ppse_name[] = "2PAY.SYS.DDF01";
+  if (command_length < 4) {
+    return;
+  }
+
+  // Phase from the instruction byte
+  int phase = -1;
+  uint8_t lc = command_length > 4 ? command[4] : 0;
+  switch (command[1]) {
+    case 0xA4:
+      phase = lc == sizeof(ppse_name) - 1 && command_length >= 5 + lc &&
+              memcmp(&command[5], ppse_name, lc) == 0 ? STAT_PPSE : STAT_SELECT;
+      break;
+    case 0xA8:
+      phase = STAT_GPO;
+      break;
+    case 0xB2:
+      phase = STAT_READ_RECORD;
+      break;
+  }
+  if (phase >= 0) {
+    analysis.timing.phases[phase].record(delta_us);
+  }
+
+  if (response[response_length - 2] != 0x90 || response[response_length - 1] != 0x00) {
+    return;
+  }
+
+  TLVS* tlvs = decode(response, response_length - 2);
+  countTags(tlvs->firstTLV());
+
+  if (phase == STAT_SELECT && command_length >= 5 + lc) {
+    // AID and label
+    std::string key = toHex(&command[5], lc);
+    TLVNode* label = tlvs->findTLV(0x50);
+    if (label != NULL) {
+      key += " ";
+      key.append((const char*) label->getValue(), label->getValueLength());
+    }
+    analysis.aids[key]++;
+
+    // What the terminal would send for this PDOL
+    TLVNode* pdol = tlvs->findTLV(0x9f38);
+    uint8_t buffer[COMMAND_BUFFER_SIZE];
+    WriteBuffer data_options(buffer, sizeof(buffer));
+    DolCheck check;
+    unsigned long start = micros();
+    buildDataOptionsList(pdol, data_options, NULL, &check);
+    analysis.timing.phases[STAT_BUILD_DOL].record(micros() - start);
+
+    std::string pdol_key = pdol != NULL ? toHex(pdol->getValue(), pdol->getValueLength()) : "none";
+    PdolVariant& variant = analysis.pdols[pdol_key];
+    variant.count++;
+    variant.data_length = data_options.pos;
+    variant.unknown_tags = check.unknown_tags;
+    variant.length_mismatches = check.length_mismatches;
+  } else if (phase == STAT_GPO) {
+    // Format 2 has the AFL in 94, format 1 after the AIP in 80
+    const uint8_t* afl = NULL;
+    int afl_length = 0;
+    TLVNode* node = tlvs->findTLV(0x94);
+    if (node != NULL) {
+      afl = node->getValue();
+      afl_length = node->getValueLength();
+    } else if ((node = tlvs->findTLV(0x80)) != NULL && node->getValueLength() > 2) {
+      afl = node->getValue() + 2;
+      afl_length = node->getValueLength() - 2;
+    }
+    std::string shape;
+    for (int i = 0; i + 4 <= afl_length; i += 4) {
+      char entry[32];
+      snprintf(entry, sizeof(entry), "%sSFI %d: %d-%d", shape.empty() ? "" : ", ",
+               afl[i] >> 3, afl[i + 1], afl[i + 2]);
+      shape += entry;
+    }
+    analysis.afls[shape.empty() ? "none" : shape]++;
+  } else if (phase == STAT_READ_RECORD) {
+    tap.records++;
+  }
+}
+
+//
+// Deque of file indexes. The owner takes from the back, others steal from the front.
+//
+class WorkQueue {
+public:
+  void push(size_t item) { items.push_back(item); }
+
+  bool take(size_t& item)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (items.empty()) {
+      return false;
+    }
+    item = items.back();
+    items.pop_back();
+    return true;
+  }
+
+  bool steal(size_t& item)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (items.empty()) {
+      return false;
+    }
+    item = items.front();
+    items.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex mutex;
+  std::deque<size_t> items;
+};
+
+static void addPath(const char* path, std::vector<std::string>& files)
+{
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "Can't read %s\n", path);
+    return;
+  }
+  if (!S_ISDIR(st.st_mode)) {
+    files.push_back(path);
+    return;
+  }
+  DIR* dir = opendir(path);
+  if (dir == NULL) {
+    fprintf(stderr, "Can't read %s\n", path);
+    return;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    std::string name = std::string(path) + "/" + entry->d_name;
+    if (stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      files.push_back(name);
+    }
+  }
+  closedir(dir);
+}
+
+//
+// Print the largest counts of a map, most frequent first
+//
+template <typename Map, typename Label>
+static void printTop(const char* title, const Map& counts, unsigned long total, int top, Label label)
+{
+  std::vector<std::pair<unsigned long, typename Map::key_type> > sorted;
+  for (typename Map::const_iterator i = counts.begin(); i != counts.end(); ++i) {
+    sorted.push_back(std::make_pair(i->second, i->first));
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<unsigned long, typename Map::key_type>& a,
+               const std::pair<unsigned long, typename Map::key_type>& b) { return a.first > b.first; });
+
+  printf("\n%s (%lu distinct)\n", title, (unsigned long) sorted.size());
+  for (size_t i = 0; i < sorted.size() && (int) i < top; i++) {
+    printf("%10lu %6.2f%%  %s\n", sorted[i].first,
+           total > 0 ? 100.0 * sorted[i].first / total : 0.0, label(sorted[i].second).c_str());
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int threads = std::thread::hardware_concurrency();
+  int top = 10;
+  while (argc > 2 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-j") == 0) {
+      threads = atoi(argv[2]);
+    } else if (strcmp(argv[1], "-t") == 0) {
+      top = atoi(argv[2]);
+    } else {
+      break;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc < 2) {
+    fprintf(stderr, "Usage: emv_analyze [-j threads] [-t top] trace-file-or-directory...\n");
+    return 1;
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    addPath(argv[i], files);
+  }
+
+  // Deal the files out, then let the threads balance the load
+  std::vector<WorkQueue> queues(threads);
+  for (size_t i = 0; i < files.size(); i++) {
+    queues[i % threads].push(i);
+  }
+  std::vector<Worker> workers(threads);
+  std::vector<std::thread> pool;
+
+  unsigned long start = micros();
+  for (int t = 0; t < threads; t++) {
+    pool.push_back(std::thread([&, t]() {
+      size_t item;
+      for (;;) {
+        bool found = queues[t].take(item);
+        for (int k = 1; !found && k < threads; k++) {
+          found = queues[(t + k) % threads].steal(item);
+        }
+        if (!found) {
+          return;
+        }
+        workers[t].analyzeFile(files[item].c_str());
+      }
+    }));
+  }
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  unsigned long elapsed = micros() - start;
+
+  Analysis total;
+  for (int t = 0; t < threads; t++) {
+    total.merge(workers[t].analysis);
+  }
+
+  printf("files %lu (%lu not traces), %llu bytes, %d threads\n",
+         total.files, total.bad_files, total.bytes, threads);
+  printf("taps %lu, exchanges %lu, failed exchanges %lu\n",
+         total.taps, total.exchanges, total.failed);
+  printf("time %.3f s, %.0f taps/s\n", elapsed / 1e6, total.taps * 1e6 / (elapsed > 0 ? elapsed : 1));
+
+  auto text = [](const std::string& s) { return s; };
+  printTop("AIDs", total.aids, total.taps, top, text);
+  printTop("AFL shapes", total.afls, total.taps, top, text);
+  printTop("Records per tap", total.record_counts, total.taps, top,
+           [](int n) { return std::to_string(n); });
+
+  std::unordered_map<std::string, unsigned long> pdol_counts;
+  for (auto i = total.pdols.begin(); i != total.pdols.end(); ++i) {
+    pdol_counts[i->first] = i->second.count;
+  }
+  printTop("PDOL variants: data bytes, unknown tags, length mismatches, PDOL", pdol_counts,
+           total.taps, top, [&total](const std::string& pdol) {
+             const PdolVariant& v = total.pdols[pdol];
+             char info[32];
+             snprintf(info, sizeof(info), "%3d %3d %3d  ", v.data_length, v.unknown_tags,
+                      v.length_mismatches);
+             return info + pdol;
+           });
+
+  printTop("Status words", total.status_words, total.exchanges, top, [](uint16_t sw) {
+    char s[8];
+    snprintf(s, sizeof(s), "%04X", sw);
+    return std::string(s);
+  });
+  printTop("Tags", total.tags, total.exchanges, top, [](uint16_t tag) {
+    char s[8];
+    char name[TAG_NAME_MAX];
+    snprintf(s, sizeof(s), "%-4X  ", tag);
+    return s + std::string(get_tag_name(tag, TAG_LENGTH_ANY, name, sizeof(name)));
+  });
+
+  printf("\nExchange times as recorded, decode and DOL build as measured here\n");
+  fflush(stdout);
+  total.timing.print();
+  Serial.flush();
+  return 0;
+}
@@ -0,0 +1,122 @@
+//
+// Decode a binary trace back into the text dump
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Usage: trace_decode [-t] [capture-file]
+//
+// Reads the frames written in binary output mode (src/trace_output.h)
+// from a file or stdin and prints the same text as text mode.
+// -t adds a line with the sequence number and timestamp before each
+// command, response and TLV frame.
+//
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "tlv.h"
+#include "emv_format.h"
+#include "trace_output.h"
+
+// Largest payload accepted. Anything bigger is treated as a bad frame.
+#define MAX_PAYLOAD 1024
+
+static bool readBytes(FILE* in, uint8_t* buffer, size_t length)
+{
+  return fread(buffer, 1, length, in) == length;
+}
+
+int main(int argc, char** argv)
+{
+  bool timestamps = argc > 1 && strcmp(argv[1], "-t") == 0;
+  if (timestamps) {
+    argc--;
+    argv++;
+  }
+
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (in == NULL) {
+      fprintf(stderr, "Can't open %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  static const char* type_names[] = { "?", "text", "command", "response", "tlv" };
+  uint8_t header[FRAME_HEADER_SIZE];
+  uint8_t payload[MAX_PAYLOAD];
+  bool first = true;
+  uint16_t expected_sequence = 0;
+  unsigned long frames = 0, skipped = 0, lost = 0;
+  TLVS tlvs;
+  int c;
+
+  while ((c = fgetc(in)) != EOF) {
+    // Skip anything before a sync byte, e.g. text printed before the switch
+    if (c != FRAME_SYNC) {
+      skipped++;
+      continue;
+    }
+    header[0] = (uint8_t) c;
+    if (!readBytes(in, &header[1], FRAME_HEADER_SIZE - 1)) {
+      break;
+    }
+    uint8_t type = header[1];
+    uint16_t sequence = header[2] | header[3] << 8;
+    uint32_t timestamp = header[4] | header[5] << 8 | header[6] << 16 | (uint32_t) header[7] << 24;
+    uint16_t length = header[8] | header[9] << 8;
+
+    if (type < FRAME_TEXT || type > FRAME_TLV || length > MAX_PAYLOAD) {
+      skipped += FRAME_HEADER_SIZE;
+      continue;
+    }
+    if (!readBytes(in, payload, length)) {
+      break;
+    }
+
+    if (!first && sequence != expected_sequence) {
+      lost += (uint16_t) (sequence - expected_sequence);
+      trace_out.flush();
+      fprintf(stderr, "*** %u frames lost before sequence %u\n",
+              (uint16_t) (sequence - expected_sequence), sequence);
+    }
+    first = false;
+    expected_sequence = sequence + 1;
+    frames++;
+
+    if (timestamps && type != FRAME_TEXT) {
+      trace_out.putStr("# ");
+      trace_out.putDec(sequence);
+      trace_out.putChar(' ');
+      trace_out.putDec(timestamp);
+      trace_out.putStr(" us ");
+      trace_out.putLine(type_names[type]);
+    }
+
+    switch (type) {
+      case FRAME_TEXT:
+        for (int i = 0; i < length; i++) {
+          trace_out.putChar((char) payload[i]);
+        }
+        break;
+      case FRAME_COMMAND:
+        trace_out.putCommand(payload, length);
+        break;
+      case FRAME_RESPONSE:
+        trace_out.putResponse(payload, length);
+        break;
+      case FRAME_TLV:
+        tlvs.decodeTLVs(payload, length);
+        trace_out.putTLV(tlvs.firstTLV());
+        break;
+    }
+  }
+  trace_out.flush();
+  Serial.flush();
+
+  fprintf(stderr, "%lu frames, %lu frames lost, %lu bytes skipped\n", frames, lost, skipped);
+  if (in != stdin) {
+    fclose(in);
+  }
+  return 0;
+}
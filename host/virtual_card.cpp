@@ -0,0 +1,291 @@
+//
+// Simulated contactless card for the host build
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include "virtual_card.h"
+
+//
+// Sample Visa credit card: one application, PDOL, AFL with two files.
+//
+static const char* default_card_script =
+  "# PPSE\n"
+  "00A404000E325041592E5359532E4444463031 : "
+  "6F30840E325041592E5359532E4444463031A51EBF0C1B61194F07A0000000031010500B5649534120"
+  "4352454449548701019000\n"
+  "# SELECT Visa credit\n"
+  "00A4040007A0000000031010 : "
+  "6F3B8407A0000000031010A530500B56495341204352454449548701019F38189F66049F02069F0306"
+  "9F1A0295055F2A029A039C019F37045F2D02656E9000\n"
+  "# GET PROCESSING OPTIONS\n"
+  "80A8 : "
+  "772882022000940808010100100102009F360200429F260811223344556677889F100706011203A000"
+  "009000\n"
+  "# READ RECORD SFI 1 record 1\n"
+  "00B2010C : "
+  "703157134761739001010010D25122011143804400000F5F2009544553542F434152449F1F0D313134"
+  "333830343430303030309000\n"
+  "# READ RECORD SFI 2 record 1\n"
+  "00B20114 : "
+  "704C5A0847617390010100105F24032512315F25032001015F280208405F3401019F0702FF008E0E00"
+  "0000000000000042031E031F039F0D05F0400088009F0E0500100000009F0F05F0400098009000\n"
+  "# READ RECORD SFI 2 record 2\n"
+  "00B20214 : "
+  "7081B98F0192908190101112131415161718191A1B1C1D1E1F202122232425262728292A2B2C2D2E2F"
+  "303132333435363738393A3B3C3D3E3F404142434445464748494A4B4C4D4E4F505152535455565758"
+  "595A5B5C5D5E5F606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F8081"
+  "82838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F9F320103921DA1A2A3A4A5"
+  "A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBD9000\n";
+
+VirtualCard::VirtualCard()
+  : apdu_count(0), tx_bytes(0), rx_bytes(0), present(true),
+    chunk_size(256), strict_le(false), selected(false),
+    fault_every(0), fault_burst(0), fault_count(0), fault_left(0)
+{
+  static const uint8_t default_uid[] = { 0x04, 0xA1, 0xB2, 0xC3 };
+  setUID(default_uid, sizeof(default_uid));
+}
+
+void VirtualCard::setUID(const uint8_t* uid, uint8_t uid_length)
+{
+  this->uid.assign(uid, uid + uid_length);
+}
+
+void VirtualCard::addRule(const uint8_t* prefix, uint8_t prefix_length,
+                          const uint8_t* response, uint16_t response_length)
+{
+  Rule rule;
+  rule.prefix.assign(prefix, prefix + prefix_length);
+  rule.response.assign(response, response + response_length);
+  rules.push_back(rule);
+}
+
+// Parse hex digits, skipping spaces. Return false on an odd digit count or bad character.
+static bool parseHex(const std::string& text, std::vector<uint8_t>& out)
+{
+  int nibble = -1;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (isspace((unsigned char) c)) {
+      continue;
+    }
+    if (!isxdigit((unsigned char) c)) {
+      return false;
+    }
+    int value = isdigit((unsigned char) c) ? c - '0' : toupper((unsigned char) c) - 'A' + 10;
+    if (nibble < 0) {
+      nibble = value;
+    } else {
+      out.push_back((uint8_t) (nibble << 4 | value));
+      nibble = -1;
+    }
+  }
+  return nibble < 0;
+}
+
+bool VirtualCard::loadScript(const char* text)
+{
+  const char* line = text;
+  while (*line != '\0') {
+    const char* eol = strchr(line, '\n');
+    std::string entry(line, eol != NULL ? eol - line : strlen(line));
+    line = eol != NULL ? eol + 1 : line + entry.size();
+
+    size_t comment = entry.find('#');
+    if (comment != std::string::npos) {
+      entry.erase(comment);
+    }
+    if (entry.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+
+    size_t sep = entry.find(':');
+    std::vector<uint8_t> prefix, response;
+    if (sep == std::string::npos ||
+        !parseHex(entry.substr(0, sep), prefix) ||
+        !parseHex(entry.substr(sep + 1), response) ||
+        prefix.size() > 255 || response.size() < 2 || response.size() > 0xffff) {
+      fprintf(stderr, "Bad card script line: %s\n", entry.c_str());
+      return false;
+    }
+    addRule(prefix.data(), (uint8_t) prefix.size(), response.data(), (uint16_t) response.size());
+  }
+  return true;
+}
+
+bool VirtualCard::loadScriptFile(const char* path)
+{
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Can't open card script %s\n", path);
+    return false;
+  }
+  std::string text;
+  char buf[512];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    text.append(buf, n);
+  }
+  fclose(f);
+  return loadScript(text.c_str());
+}
+
+void VirtualCard::loadDefaultCard()
+{
+  loadScript(default_card_script);
+}
+
+void VirtualCard::setFaults(int every, int burst)
+{
+  fault_every = every;
+  fault_burst = burst;
+  fault_count = 0;
+  fault_left = 0;
+}
+
+bool VirtualCard::detectCard()
+{
+  // Activation resets the card
+  selected = false;
+  remaining.clear();
+  return present;
+}
+
+bool VirtualCard::getCardUID(uint8_t* uid, uint8_t* uid_length)
+{
+  if (!present || this->uid.empty() || this->uid.size() > *uid_length) {
+    return false;
+  }
+  memcpy(uid, this->uid.data(), this->uid.size());
+  *uid_length = (uint8_t) this->uid.size();
+  return true;
+}
+
+bool VirtualCard::transceive(const uint8_t* tx, uint8_t tx_length,
+                             uint8_t* rx, uint8_t* rx_length)
+{
+  if (!present) {
+    return false;
+  }
+  apdu_count++;
+  tx_bytes += tx_length;
+
+  // Lost in the field
+  if (fault_every > 0) {
+    if (fault_left > 0) {
+      fault_left--;
+      return false;
+    }
+    if (++fault_count >= fault_every) {
+      fault_count = 0;
+      fault_left = fault_burst - 1;
+      return false;
+    }
+  }
+
+  // Nothing but SELECT before an application is selected
+  if (tx_length >= 2 && tx[0] == 0x00 && tx[1] == 0xA4) {
+    selected = true;
+  } else if (!selected) {
+    // Conditions of use not satisfied
+    remaining_sw[0] = 0x69;
+    remaining_sw[1] = 0x85;
+    return sendPart(NULL, 0, 0, rx, rx_length);
+  }
+
+  // GET RESPONSE continues the last response
+  if (tx_length == 5 && tx[0] == 0x00 && tx[1] == 0xC0) {
+    if (remaining.empty()) {
+      // Conditions of use not satisfied
+      remaining_sw[0] = 0x69;
+      remaining_sw[1] = 0x85;
+      return sendPart(NULL, 0, 0, rx, rx_length);
+    }
+    // Copied, not swapped: a swap trades the capacities, and the
+    // buffers would go on growing as responses of other sizes come
+    sending.assign(remaining.begin(), remaining.end());
+    remaining.clear();
+    return sendPart(sending.data(), sending.size(), tx[4], rx, rx_length);
+  }
+  remaining.clear();
+
+  static const uint8_t file_not_found[] = { 0x6A, 0x82 };
+  const uint8_t* response = file_not_found;
+  size_t response_length = sizeof(file_not_found);
+
+  for (size_t i = 0; i < rules.size(); i++) {
+    const Rule& rule = rules[i];
+    if (rule.prefix.size() <= tx_length &&
+        memcmp(rule.prefix.data(), tx, rule.prefix.size()) == 0) {
+      response = rule.response.data();
+      response_length = rule.response.size();
+      break;
+    }
+  }
+
+  // Status words of the rule are sent after the last part
+  size_t data_length = response_length - 2;
+  remaining_sw[0] = response[data_length];
+  remaining_sw[1] = response[data_length + 1];
+
+  // Le is the last byte of a command with no data, or after the data
+  uint8_t le = 0;
+  if (tx_length == 5 || (tx_length > 5 && tx_length == 6 + tx[4])) {
+    le = tx[tx_length - 1];
+  }
+  if (strict_le && data_length > 0 && data_length < 256 && le != data_length) {
+    if (*rx_length < 2) {
+      return false;
+    }
+    rx[0] = 0x6C;
+    rx[1] = (uint8_t) data_length;
+    *rx_length = 2;
+    rx_bytes += 2;
+    return true;
+  }
+  return sendPart(response, data_length, le, rx, rx_length);
+}
+
+//
+// Send as much of the data as Le, the chunk size and the receive buffer
+// allow, with 61xx if some is left for GET RESPONSE.
+//
+bool VirtualCard::sendPart(const uint8_t* data, size_t length, uint8_t le,
+                           uint8_t* rx, uint8_t* rx_length)
+{
+  size_t part = length;
+  size_t limit = le != 0 ? le : 256;
+  if ((size_t) chunk_size < limit) {
+    limit = chunk_size;
+  }
+  if (*rx_length < 2) {
+    return false;
+  }
+  if ((size_t) (*rx_length - 2) < limit) {
+    limit = *rx_length - 2;
+  }
+  if (part > limit) {
+    part = limit;
+  }
+
+  if (part > 0) {
+    memcpy(rx, data, part);
+  }
+  if (part < length) {
+    size_t left = length - part;
+    remaining.assign(data + part, data + length);
+    rx[part] = 0x61;
+    rx[part + 1] = left > 255 ? 0 : (uint8_t) left;
+  } else {
+    rx[part] = remaining_sw[0];
+    rx[part + 1] = remaining_sw[1];
+  }
+  *rx_length = (uint8_t) (part + 2);
+  rx_bytes += part + 2;
+  return true;
+}
@@ -0,0 +1,99 @@
+#ifndef __VIRTUAL_CARD_H__
+#define __VIRTUAL_CARD_H__
+#include <stdint.h>
+#include <vector>
+#include "card_transport.h"
+
+//
+// Simulated contactless card for the host build
+//
+// The card is scripted with a list of rules. Each rule is a command
+// prefix and the response APDU to send when a command starts with
+// that prefix. The first matching rule wins. Commands that match no
+// rule are answered with 6A 82 (file not found).
+//
+// Script text has one rule per line, hex bytes with optional spaces:
+//
+//   # PPSE
+//   00 A4 04 00 0E 32 50 41 59 2E 53 59 53 2E 44 44 46 30 31 : 6F 30 ... 90 00
+//
+// Response data too long for one exchange is sent in parts, as a card
+// does: the first part ends with 61xx, and GET RESPONSE (00 C0) gets
+// the next. setChunkSize() makes the parts smaller to exercise this.
+// setStrictLe() answers a command whose Le isn't the exact data length
+// with 6Cxx, as some cards do for Le 00.
+//
+// Like a real card, it answers only SELECT until an application has
+// been selected since it was detected. setFaults() makes exchanges go
+// unanswered, as at the edge of the field.
+//
+class VirtualCard : public CardTransport {
+public:
+  VirtualCard();
+
+  // Add a single rule
+  void addRule(const uint8_t* prefix, uint8_t prefix_length,
+               const uint8_t* response, uint16_t response_length);
+
+  // Load rules from script text or a script file. Return false on a parse error.
+  bool loadScript(const char* text);
+  bool loadScriptFile(const char* path);
+
+  // Load the built in sample Visa card
+  void loadDefaultCard();
+
+  // Control whether the card is in the field
+  void setPresent(bool present) { this->present = present; }
+
+  // Most response data sent in one exchange, 256 by default
+  void setChunkSize(int size) { chunk_size = size; }
+
+  // Answer 6Cxx unless Le is the length of the response data
+  void setStrictLe(bool strict) { strict_le = strict; }
+
+  // After every `every` exchanges, leave `burst` in a row unanswered.
+  // 0 (the default) answers all of them.
+  void setFaults(int every, int burst = 1);
+
+  // Set the UID reported when the card is detected
+  void setUID(const uint8_t* uid, uint8_t uid_length);
+
+  // CardTransport
+  bool detectCard();
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length);
+  bool transceive(const uint8_t* tx, uint8_t tx_length,
+                  uint8_t* rx, uint8_t* rx_length);
+
+  // Exchange counters
+  unsigned long apdu_count;
+  unsigned long tx_bytes;
+  unsigned long rx_bytes;
+
+private:
+  struct Rule {
+    std::vector<uint8_t> prefix;
+    std::vector<uint8_t> response;
+  };
+
+  bool sendPart(const uint8_t* data, size_t length, uint8_t le,
+                uint8_t* rx, uint8_t* rx_length);
+
+  std::vector<Rule> rules;
+  std::vector<uint8_t> uid;
+  bool present;
+  int chunk_size;
+  bool strict_le;
+  bool selected;            // SELECT answered since detection
+
+  int fault_every;
+  int fault_burst;
+  int fault_count;          // Exchanges answered since the last fault
+  int fault_left;           // Exchanges of the current burst still to drop
+
+  // Response data still to be sent with GET RESPONSE, and its status
+  std::vector<uint8_t> remaining;
+  uint8_t remaining_sw[2];
+  std::vector<uint8_t> sending;     // The part being sent, taken from remaining
+};
+
+#endif /* __VIRTUAL_CARD_H__ */
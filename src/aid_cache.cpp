@@ -0,0 +1,112 @@
+//
+// Cache of the application selected for a card, keyed on the card UID
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "aid_cache.h"
+#include "emv_format.h"
+
+AidCache aid_cache;
+
+AidCache::AidCache()
+{
+  clear();
+}
+
+void AidCache::clear()
+{
+  for (int i = 0; i < AID_CACHE_ENTRIES; i++) {
+    entries[i].valid = false;
+  }
+  hits = 0;
+  misses = 0;
+  fallbacks = 0;
+}
+
+AidCacheEntry* AidCache::find(const uint8_t* uid, uint8_t uid_length)
+{
+  for (int i = 0; i < AID_CACHE_ENTRIES; i++) {
+    AidCacheEntry& entry = entries[i];
+    if (entry.valid && entry.uid_length == uid_length &&
+        memcmp(entry.uid, uid, uid_length) == 0) {
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+const AidCacheEntry* AidCache::lookup(const uint8_t* uid, uint8_t uid_length)
+{
+  AidCacheEntry* entry = find(uid, uid_length);
+  if (entry != NULL && millis() - entry->stored_ms > AID_CACHE_TTL_MS) {
+    entry->valid = false;
+    entry = NULL;
+  }
+
+  if (entry == NULL) {
+    misses++;
+    return NULL;
+  }
+  hits++;
+  return entry;
+}
+
+void AidCache::store(const uint8_t* uid, uint8_t uid_length,
+                     const uint8_t* aid, uint8_t aid_length,
+                     const uint8_t* label, uint8_t label_length)
+{
+  if (uid_length == 0 || uid_length > AID_CACHE_MAX_UID ||
+      aid_length == 0 || aid_length > AID_CACHE_MAX_AID) {
+    return;
+  }
+
+  // Replace the card's old entry, a free entry, or the oldest one
+  AidCacheEntry* entry = find(uid, uid_length);
+  for (int i = 0; entry == NULL && i < AID_CACHE_ENTRIES; i++) {
+    if (!entries[i].valid) {
+      entry = &entries[i];
+    }
+  }
+  if (entry == NULL) {
+    entry = &entries[0];
+    for (int i = 1; i < AID_CACHE_ENTRIES; i++) {
+      if ((long) (entries[i].stored_ms - entry->stored_ms) < 0) {
+        entry = &entries[i];
+      }
+    }
+  }
+
+  entry->valid = true;
+  entry->stored_ms = millis();
+  entry->uid_length = uid_length;
+  memcpy(entry->uid, uid, uid_length);
+  entry->aid_length = aid_length;
+  memcpy(entry->aid, aid, aid_length);
+  entry->label_length = 0;
+  if (label != NULL) {
+    entry->label_length = min(label_length, (uint8_t) AID_CACHE_MAX_LABEL);
+    memcpy(entry->label, label, entry->label_length);
+  }
+}
+
+void AidCache::remove(const uint8_t* uid, uint8_t uid_length)
+{
+  AidCacheEntry* entry = find(uid, uid_length);
+  if (entry != NULL) {
+    entry->valid = false;
+  }
+}
+
+void AidCache::printStats()
+{
+  trace_out.putStr("AID cache: hits ");
+  trace_out.putDec(hits);
+  trace_out.putStr(", misses ");
+  trace_out.putDec(misses);
+  trace_out.putStr(", fallbacks to PPSE ");
+  trace_out.putDec(fallbacks);
+  trace_out.putLine();
+  trace_out.flush();
+}
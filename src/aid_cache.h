@@ -0,0 +1,73 @@
+#ifndef __AID_CACHE_H__
+#define __AID_CACHE_H__
+#include <stdint.h>
+
+//
+// Cache of the application selected for a card, keyed on the card UID
+//
+// When a card we have seen recently comes back, the session can select
+// its application directly and skip the PPSE exchange. If that SELECT
+// fails the entry is dropped and the session falls back to PPSE.
+//
+// Note: phones and some cards use a random UID on every tap. Those
+// will always miss.
+//
+
+#ifndef AID_CACHE_ENTRIES
+#define AID_CACHE_ENTRIES 8
+#endif
+#ifndef AID_CACHE_TTL_MS
+#define AID_CACHE_TTL_MS (10 * 60 * 1000ul)
+#endif
+
+#define AID_CACHE_MAX_UID 10
+#define AID_CACHE_MAX_AID 16
+#define AID_CACHE_MAX_LABEL 16
+
+struct AidCacheEntry {
+  bool valid;
+  unsigned long stored_ms;
+  uint8_t uid_length;
+  uint8_t uid[AID_CACHE_MAX_UID];
+  uint8_t aid_length;
+  uint8_t aid[AID_CACHE_MAX_AID];
+  uint8_t label_length;
+  uint8_t label[AID_CACHE_MAX_LABEL];
+};
+
+class AidCache {
+public:
+  AidCache();
+
+  // Return the entry for a card, or NULL if there is none or it has expired
+  const AidCacheEntry* lookup(const uint8_t* uid, uint8_t uid_length);
+
+  // Save the AID and label selected for a card. label may be NULL.
+  void store(const uint8_t* uid, uint8_t uid_length,
+             const uint8_t* aid, uint8_t aid_length,
+             const uint8_t* label, uint8_t label_length);
+
+  // Drop the entry for a card
+  void remove(const uint8_t* uid, uint8_t uid_length);
+
+  // Count a cached AID that could not be selected
+  void countFallback() { fallbacks++; }
+
+  void clear();
+
+  // Print hits, misses and fallbacks to PPSE
+  void printStats();
+
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t fallbacks;
+
+private:
+  AidCacheEntry* find(const uint8_t* uid, uint8_t uid_length);
+
+  AidCacheEntry entries[AID_CACHE_ENTRIES];
+};
+
+extern AidCache aid_cache;
+
+#endif /* __AID_CACHE_H__ */
@@ -0,0 +1,52 @@
+#ifndef __APDU_BUILDER_H__
+#define __APDU_BUILDER_H__
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Command APDUs built at compile time
+//
+// Fixed commands, and the fixed part of commands with variable fields,
+// are constexpr byte arrays. They are kept in flash and copied into the
+// command buffer as they are. Only the variable fields are written at
+// run time.
+//
+
+template <size_t N>
+struct CommandApdu {
+  uint8_t bytes[N];
+
+  static constexpr size_t size() { return N; }
+};
+
+// CLA INS P1 P2, for commands with data added at run time
+constexpr CommandApdu<4> apduHeader(uint8_t cla, uint8_t ins, uint8_t p1, uint8_t p2)
+{
+  return CommandApdu<4>{ { cla, ins, p1, p2 } };
+}
+
+// CLA INS P1 P2 Le, no command data
+constexpr CommandApdu<5> apduWithLe(uint8_t cla, uint8_t ins, uint8_t p1, uint8_t p2, uint8_t le = 0)
+{
+  return CommandApdu<5>{ { cla, ins, p1, p2, le } };
+}
+
+// SELECT by DF name, from a string literal. Le 0.
+template <size_t N>
+constexpr CommandApdu<N + 5> selectByName(const char (&name)[N])
+{
+  static_assert(N - 1 <= 255, "DF name longer than 255 bytes");
+  CommandApdu<N + 5> apdu = {};
+  apdu.bytes[0] = 0x00;   // CLA
+  apdu.bytes[1] = 0xA4;   // INS SELECT
+  apdu.bytes[2] = 0x04;   // P1 by name
+  apdu.bytes[3] = 0x00;   // P2
+  apdu.bytes[4] = N - 1;  // Lc, name without the terminator
+  for (size_t i = 0; i < N - 1; i++) {
+    apdu.bytes[5 + i] = (uint8_t) name[i];
+  }
+  apdu.bytes[N + 4] = 0x00;   // Le
+  return apdu;
+}
+
+#endif /* __APDU_BUILDER_H__ */
@@ -0,0 +1,193 @@
+//
+// Recording of card exchanges, for replay on the host
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include "apdu_trace.h"
+#include "emv_format.h"
+
+void writeApduTraceHeader(Print& out)
+{
+  uint8_t header[APDU_TRACE_HEADER_SIZE];
+  memcpy(header, APDU_TRACE_MAGIC, 4);
+  header[4] = APDU_TRACE_VERSION;
+  out.write(header, sizeof(header));
+}
+
+/*** ApduRecorder ***/
+
+ApduRecorder::ApduRecorder(CardTransport& card, Print& out, uint8_t reader)
+  : card(card), out(out), rx(NULL), detecting(false), reader(reader), enabled(true), started(false),
+    last_micros(0), records(0)
+{
+}
+
+void ApduRecorder::writeRecord(uint8_t type, const uint8_t* data, uint8_t length)
+{
+  if (!enabled) {
+    return;
+  }
+  unsigned long now = micros();
+  uint32_t delta = started ? now - last_micros : 0;
+  started = true;
+  last_micros = now;
+
+  // Assembled so the record goes out in one write
+  uint8_t record[APDU_RECORD_MAX];
+  int n = 0;
+  record[n++] = type | reader << 4;
+  do {
+    record[n] = delta & 0x7f;
+    delta >>= 7;
+    if (delta != 0) {
+      record[n] |= 0x80;
+    }
+    n++;
+  } while (delta != 0);
+  record[n++] = length;
+  memcpy(&record[n], data, length);
+  out.write(record, n + length);
+  records++;
+}
+
+bool ApduRecorder::detectCard()
+{
+  uint8_t length;
+  return submitDetect() && complete(&length);
+}
+
+bool ApduRecorder::getCardUID(uint8_t* uid, uint8_t* uid_length)
+{
+  return card.getCardUID(uid, uid_length);
+}
+
+bool ApduRecorder::transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length)
+{
+  // A command that couldn't be sent is recorded as failed too
+  submit(tx, tx_length, rx, *rx_length);
+  return complete(rx_length);
+}
+
+bool ApduRecorder::submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size)
+{
+  writeRecord(APDU_COMMAND, tx, tx_length);
+  this->rx = rx;
+  detecting = false;
+  return card.submit(tx, tx_length, rx, rx_size);
+}
+
+bool ApduRecorder::submitDetect()
+{
+  detecting = true;
+  return card.submitDetect();
+}
+
+bool ApduRecorder::complete(uint8_t* rx_length)
+{
+  bool success = card.complete(rx_length);
+  if (detecting) {
+    detecting = false;
+    if (success) {
+      uint8_t uid[10];
+      uint8_t uid_length = sizeof(uid);
+      if (!card.getCardUID(uid, &uid_length)) {
+        uid_length = 0;
+      }
+      writeRecord(APDU_TAP, uid, uid_length);
+    }
+  } else if (success) {
+    writeRecord(APDU_RESPONSE, rx, *rx_length);
+  } else {
+    writeRecord(APDU_FAILED, NULL, 0);
+  }
+  return success;
+}
+
+/*** ApduTraceReader ***/
+
+ApduTraceReader::ApduTraceReader(const uint8_t* trace, size_t length)
+  : trace(trace), length(length), pos(APDU_TRACE_HEADER_SIZE)
+{
+  valid = length >= APDU_TRACE_HEADER_SIZE &&
+          memcmp(trace, APDU_TRACE_MAGIC, 4) == 0 &&
+          trace[4] == APDU_TRACE_VERSION;
+}
+
+bool ApduTraceReader::next(ApduRecord& record)
+{
+  if (!valid || pos >= length) {
+    return false;
+  }
+  size_t p = pos;
+  record.type = trace[p] & 0x0f;
+  record.reader = trace[p] >> 4;
+  p++;
+
+  record.delta_us = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (p >= length || shift > 28) {
+      return false;
+    }
+    uint8_t b = trace[p++];
+    record.delta_us |= (uint32_t) (b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      break;
+    }
+  }
+
+  if (p >= length || p + 1 + trace[p] > length) {
+    return false;
+  }
+  record.length = trace[p++];
+  record.data = &trace[p];
+  pos = p + record.length;
+  return true;
+}
+
+/*** ApduTraceBuffer ***/
+
+ApduTraceBuffer::ApduTraceBuffer()
+{
+  clear();
+}
+
+void ApduTraceBuffer::clear()
+{
+  length = 0;
+  dropped = 0;
+  writeApduTraceHeader(*this);
+}
+
+size_t ApduTraceBuffer::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t ApduTraceBuffer::write(const uint8_t* data, size_t size)
+{
+  // Whole records only
+  if (size > sizeof(buffer) - length) {
+    dropped++;
+    return 0;
+  }
+  memcpy(&buffer[length], data, size);
+  length += size;
+  return size;
+}
+
+void ApduTraceBuffer::dump()
+{
+  trace_out.putLine("-----BEGIN APDU TRACE-----");
+  for (size_t i = 0; i < length; i += 32) {
+    trace_out.putHexBytes(&buffer[i], min(length - i, (size_t) 32), false);
+    trace_out.putLine();
+  }
+  trace_out.putLine("-----END APDU TRACE-----");
+  if (dropped > 0) {
+    trace_out.putStr("Records dropped, trace full: ");
+    trace_out.putDec(dropped);
+    trace_out.putLine();
+  }
+  trace_out.flush();
+}
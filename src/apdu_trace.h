@@ -0,0 +1,146 @@
+#ifndef __APDU_TRACE_H__
+#define __APDU_TRACE_H__
+#include <Arduino.h>
+#include <stdint.h>
+#include "card_transport.h"
+
+//
+// Recording of card exchanges, for replay on the host
+//
+// ApduRecorder sits between a card session and its transport and
+// writes a record for every card detected and every exchange.
+// host/tools/apdu_replay runs the session against a recording at full
+// speed, with no card and no RF.
+//
+// A trace starts with "APDU" and a version byte, then records:
+//
+//   0      type in the low 4 bits, reader number in the high 4 bits
+//   1..    time since the reader's previous record in us, LEB128
+//   n      data length
+//   n+1..  data
+//
+// APDU_TAP holds the UID of a card just detected, APDU_COMMAND a
+// command APDU, and APDU_RESPONSE the response APDU, with the status
+// word as its last two bytes. APDU_FAILED, with no data, is an
+// exchange that got no response. Records of several readers can be
+// interleaved; the reader number tells them apart.
+//
+
+#define APDU_TRACE_MAGIC "APDU"
+#define APDU_TRACE_VERSION 1
+#define APDU_TRACE_HEADER_SIZE 5
+#define APDU_RECORD_MAX (1 + 5 + 1 + 255)
+
+enum ApduRecordType {
+  APDU_TAP = 1,
+  APDU_COMMAND = 2,
+  APDU_RESPONSE = 3,
+  APDU_FAILED = 4
+};
+
+struct ApduRecord {
+  uint8_t type;
+  uint8_t reader;
+  uint32_t delta_us;
+  uint8_t length;
+  const uint8_t* data;
+};
+
+// Write the header that starts a trace
+void writeApduTraceHeader(Print& out);
+
+//
+// Transport that records the exchanges of the transport it wraps
+//
+class ApduRecorder : public CardTransport {
+public:
+  ApduRecorder(CardTransport& card, Print& out, uint8_t reader = 0);
+
+  bool detectCard();
+  void setDetectTimeout(uint16_t timeout_ms) { card.setDetectTimeout(timeout_ms); }
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length);
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length);
+  LinkError getLastError() { return card.getLastError(); }
+
+  bool submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size);
+  bool submitDetect();
+  bool poll() { return card.poll(); }
+  bool complete(uint8_t* rx_length);
+
+  // Turn recording on and off, on by default
+  void setEnabled(bool enabled) { this->enabled = enabled; }
+
+  // Reader number written in the records, 0 to 15
+  void setReader(uint8_t reader) { this->reader = reader & 0x0f; }
+
+  unsigned long getRecords() const { return records; }
+
+private:
+  void writeRecord(uint8_t type, const uint8_t* data, uint8_t length);
+
+  CardTransport& card;
+  Print& out;
+  uint8_t* rx;                // Of the exchange submitted
+  bool detecting;             // Detection submitted, not an exchange
+  uint8_t reader;
+  bool enabled;
+  bool started;
+  unsigned long last_micros;
+  unsigned long records;
+};
+
+//
+// Reads the records of a trace held in memory
+//
+class ApduTraceReader {
+public:
+  ApduTraceReader(const uint8_t* trace, size_t length);
+
+  // False if the trace doesn't start with the header
+  bool isValid() const { return valid; }
+
+  // Get the next record. False at the end, or at a truncated record.
+  bool next(ApduRecord& record);
+
+private:
+  const uint8_t* trace;
+  size_t length;
+  size_t pos;
+  bool valid;
+};
+
+//
+// Fixed size store for a recording, on the firmware
+//
+// Records are kept until the store is full, then dropped and counted.
+// dump() prints the trace in hex between BEGIN and END lines, which
+// apdu_replay finds in a capture of the serial port.
+//
+#ifndef APDU_TRACE_BUFFER_SIZE
+#define APDU_TRACE_BUFFER_SIZE 16384
+#endif
+
+class ApduTraceBuffer : public Print {
+public:
+  ApduTraceBuffer();
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  // Print the trace through trace_out
+  void dump();
+
+  // Start a new trace
+  void clear();
+
+  size_t getLength() const { return length; }
+  unsigned long getDropped() const { return dropped; }
+
+private:
+  uint8_t buffer[APDU_TRACE_BUFFER_SIZE];
+  size_t length;
+  unsigned long dropped;
+};
+
+#endif /* __APDU_TRACE_H__ */
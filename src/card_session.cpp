@@ -0,0 +1,563 @@
+//
+// Card read session
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "card_session.h"
+#include "emv_reader.h"
+#include "record_history.h"
+#include "emv_format.h"
+#include "trace_level.h"
+#include "mem_stats.h"
+
+// Default time limits per state, in ms
+static const unsigned long default_timeouts[NUM_SESSION_STATES] = {
+  0,      // SESSION_DETECT
+  500,    // SESSION_PPSE
+  500,    // SESSION_SELECT
+  1000,   // SESSION_GPO
+  3000,   // SESSION_READ_RECORD - all records
+  0,      // SESSION_DONE
+  0,      // SESSION_FAILED
+};
+
+CardSession::CardSession(CardTransport& card)
+  : link(card), detecting(false), aid_cache(NULL), num_required(0),
+    last_uid_length(0), last_uid_seen(0), debounce_ms(0), suppressed(0),
+    exchanges(0), waiting(false)
+{
+  memcpy(state_timeout, default_timeouts, sizeof(state_timeout));
+  reset();
+}
+
+void CardSession::reset()
+{
+  // The transport takes one command at a time
+  if (detecting) {
+    uint8_t length;
+    link.complete(&length);
+    detecting = false;
+  }
+  exchange.finish();
+
+  arena.reset();
+  uid_length = 0;
+  aid = NULL;
+  aid_length = 0;
+  label = NULL;
+  label_length = 0;
+  aid_from_cache = false;
+  pdol_node = NULL;
+  num_records = 0;
+  record_pos = 0;
+  found_tags = 0;
+  resume = RESUME_NONE;
+  resumes = 0;
+  enterState(SESSION_DETECT);
+}
+
+void CardSession::cardDetected()
+{
+  reset();
+  enterState(SESSION_PPSE);
+}
+
+bool CardSession::isActive() const
+{
+  return state != SESSION_DETECT && state != SESSION_DONE && state != SESSION_FAILED;
+}
+
+bool CardSession::poll()
+{
+  return detecting ? link.poll() : exchange.poll();
+}
+
+void CardSession::setStateTimeout(SessionState state, unsigned long timeout_ms)
+{
+  state_timeout[state] = timeout_ms;
+}
+
+const char* CardSession::stateName(SessionState state)
+{
+  static const char* names[NUM_SESSION_STATES] = {
+    "detect", "ppse", "select", "gpo", "read record", "done", "failed"
+  };
+  return state < NUM_SESSION_STATES ? names[state] : "unknown";
+}
+
+void CardSession::enterState(SessionState next)
+{
+  state = next;
+  state_start = millis();
+
+  // Remember the card, so it isn't read again while it stays
+  if (next == SESSION_DONE && uid_length > 0) {
+    memcpy(last_uid, uid, uid_length);
+    last_uid_length = uid_length;
+    last_uid_seen = state_start;
+  }
+}
+
+//
+// True if the card just detected was read last and hasn't left the field.
+// Seeing it again restarts the window.
+//
+bool CardSession::isRepeat()
+{
+  if (debounce_ms == 0 || uid_length == 0 || uid_length != last_uid_length ||
+      memcmp(uid, last_uid, uid_length) != 0) {
+    return false;
+  }
+  unsigned long now = millis();
+  if (now - last_uid_seen >= debounce_ms) {
+    return false;
+  }
+  last_uid_seen = now;
+  return true;
+}
+
+bool CardSession::step()
+{
+  mem_stats.beginStep(state);
+  bool busy = runStep();
+  mem_stats.endStep();
+  return busy;
+}
+
+bool CardSession::runStep()
+{
+  // Deal with the answer to what the last step sent
+  bool answered = isWaiting();
+  if (detecting) {
+    stepDetect();
+  } else if (exchange.isActive()) {
+    if (!exchange.advance()) {
+      // The card has more of the response to send
+      trace_out.flush();
+      return true;
+    }
+    exchanges++;
+    finishStep();
+  }
+
+  if (isActive()) {
+    // Give up on a card that is taking too long
+    unsigned long timeout = state_timeout[state];
+    if (timeout != 0 && millis() - state_start > timeout) {
+      if constexpr (TRACE_ENABLED(TRACE_LEVEL_ERROR)) {
+        trace_out.putStr("Timeout in state ");
+        trace_out.putLine(stateName(state));
+        trace_out.flush();
+      }
+      enterState(SESSION_FAILED);
+      return false;
+    }
+    startStep();
+  } else if (!answered) {
+    startDetect();
+  }
+  trace_out.flush();
+  return isActive() || isWaiting();
+}
+
+// Selecting the application again after the card was activated again
+bool CardSession::isResuming() const
+{
+  return resume != RESUME_NONE && (state == SESSION_GPO || state == SESSION_READ_RECORD);
+}
+
+void CardSession::startStep()
+{
+  if (isResuming()) {
+    startResume();
+    return;
+  }
+
+  switch (state) {
+    case SESSION_PPSE:
+      // Query to find the preferred application ID
+      beginPreferredAID(exchange, link, arena);
+      break;
+    case SESSION_SELECT:
+      beginSelectApplicationID(exchange, link, arena, aid, aid_length);
+      break;
+    case SESSION_GPO:
+      startGPO();
+      break;
+    case SESSION_READ_RECORD:
+      startReadRecord();
+      break;
+    default:
+      enterState(SESSION_FAILED);
+      break;
+  }
+}
+
+void CardSession::finishStep()
+{
+  if (isResuming()) {
+    stepResume();
+    return;
+  }
+
+  switch (state) {
+    case SESSION_PPSE:
+      stepPPSE();
+      break;
+    case SESSION_SELECT:
+      stepSelect();
+      break;
+    case SESSION_GPO:
+      stepGPO();
+      break;
+    case SESSION_READ_RECORD:
+      stepReadRecord();
+      break;
+    default:
+      enterState(SESSION_FAILED);
+      break;
+  }
+}
+
+void CardSession::startDetect()
+{
+  reset();
+  // Once per tap, not on every poll
+  if (!waiting) {
+    TRACE_PROGRESS(trace_out.putLine("Waiting for an ISO14443A card"));
+    waiting = true;
+  }
+
+  // Look for a new card
+  link.submitDetect();
+  detecting = true;
+}
+
+void CardSession::stepDetect()
+{
+  detecting = false;
+  uint8_t length;
+  if (!link.complete(&length)) {
+    return;
+  }
+  uid_length = sizeof(uid);
+  if (!link.getCardUID(uid, &uid_length)) {
+    uid_length = 0;
+  }
+
+  // A card still in the field from the last tap
+  if (isRepeat()) {
+    suppressed++;
+    return;
+  }
+  waiting = false;
+  TRACE_PROGRESS(trace_out.putLine("Found something!"); trace_out.putLine());
+
+  // Go straight to SELECT for a card we have seen
+  const AidCacheEntry* entry = NULL;
+  if (aid_cache != NULL && uid_length > 0) {
+    entry = aid_cache->lookup(uid, uid_length);
+  }
+  if (entry != NULL) {
+    // Copy, the cache entry can be replaced during the tap
+    aid = arena.copy(entry->aid, entry->aid_length);
+    label = arena.copy(entry->label, entry->label_length);
+  }
+  if (aid == NULL || label == NULL) {
+    enterState(SESSION_PPSE);
+    return;
+  }
+
+  aid_length = entry->aid_length;
+  label_length = entry->label_length;
+  aid_from_cache = true;
+
+  if constexpr (TRACE_ENABLED(TRACE_LEVEL_PROGRESS)) {
+    trace_out.putStr("Using cached AID: ");
+    trace_out.putValue(label, label_length);
+    trace_out.putLine();
+  }
+  enterState(SESSION_SELECT);
+}
+
+void CardSession::stepPPSE()
+{
+  TLVNode* label_node = NULL;
+  TLVNode* aid_node = endPreferredAID(exchange, arena, &label_node);
+  if (aid_node == NULL || aid_node->getValueLength() > AID_CACHE_MAX_AID) {
+    enterState(SESSION_FAILED);
+    return;
+  }
+  TRACE_PROGRESS(trace_out.putLine());
+
+  // The PPSE response stays in the arena for the rest of the tap
+  aid = aid_node->getValue();
+  aid_length = aid_node->getValueLength();
+  label = NULL;
+  label_length = 0;
+  if (label_node != NULL) {
+    label = label_node->getValue();
+    label_length = min(label_node->getValueLength(), 255);
+  }
+  enterState(SESSION_SELECT);
+}
+
+void CardSession::stepSelect()
+{
+  // Select the application ID
+  if (!endSelectApplicationID(exchange, arena, pdol_node)) {
+    if (aid_from_cache && link.getLastError() != LINK_CARD_REMOVED) {
+      // The card may have changed, find the AID the long way
+      TRACE_PROGRESS(trace_out.putLine("Cached AID failed, reading PPSE"));
+      aid_cache->remove(uid, uid_length);
+      aid_cache->countFallback();
+      aid_from_cache = false;
+      enterState(SESSION_PPSE);
+      return;
+    }
+    TRACE_ERROR(trace_out.putLine("Failed to select AID"));
+    enterState(SESSION_FAILED);
+    return;
+  }
+
+  if (aid_cache != NULL && !aid_from_cache && uid_length > 0) {
+    aid_cache->store(uid, uid_length, aid, aid_length, label, label_length);
+  }
+  enterState(SESSION_GPO);
+}
+
+void CardSession::startGPO()
+{
+  // Run Get Processing Options - returns Application File Locator
+  if (!beginProcessingOptions(exchange, link, arena, pdol_node)) {
+    TRACE_ERROR(trace_out.putLine("No app files found"));
+    enterState(SESSION_FAILED);
+  }
+}
+
+void CardSession::stepGPO()
+{
+  TLVNode* app_files_node = endProcessingOptions(exchange, arena);
+  if (app_files_node == NULL) {
+    if (recover()) {
+      return;
+    }
+    TRACE_ERROR(trace_out.putLine("No app files found"));
+    enterState(SESSION_FAILED);
+    return;
+  }
+  TRACE_PROGRESS(trace_out.putLine());
+
+  // Make the list of records to read from the short file identifier list
+  const uint8_t* afl = app_files_node->getValue();
+  int afl_length = app_files_node->getValueLength();
+  num_records = 0;
+  record_pos = 0;
+  for (int i = 0; i + 4 <= afl_length; i += 4) {
+    // Entry: SFI, first record, last record, number of records for auth
+    RecordRef ref;
+    ref.sfi = afl[i] >> 3;
+    for (int record = afl[i + 1]; record != 0 && record <= afl[i + 2]; record++) {
+      if (num_records == SESSION_MAX_RECORDS) {
+        TRACE_ERROR(trace_out.putLine("Too many records in AFL"));
+        break;
+      }
+      ref.record = record;
+      records[num_records++] = ref;
+    }
+  }
+
+  if (num_required > 0) {
+    // Some cards return wanted tags in the GPO response
+    checkRequiredTags();
+    preferHistoryRecords();
+  }
+
+  enterState(SESSION_READ_RECORD);
+  if (num_records == 0 || allRequiredFound()) {
+    enterState(SESSION_DONE);
+  }
+}
+
+void CardSession::setRequiredTags(const uint16_t* tags, uint8_t count)
+{
+  num_required = min(count, (uint8_t) SESSION_MAX_REQUIRED_TAGS);
+  memcpy(required_tags, tags, num_required * sizeof(uint16_t));
+}
+
+bool CardSession::allRequiredFound() const
+{
+  return num_required > 0 && found_tags == (1u << num_required) - 1;
+}
+
+//
+// Note wanted tags in the last response.
+// Return true if it had any that weren't found before.
+//
+bool CardSession::checkRequiredTags()
+{
+  // A response the arena had no room for is not indexed, search it instead
+  Response* last = arena.lastDecoded();
+  bool indexed = last == NULL || arena.isKept(last);
+
+  bool found_new = false;
+  for (int i = 0; i < num_required; i++) {
+    uint16_t tag = required_tags[i];
+    if ((found_tags & (1u << i)) == 0 &&
+        (indexed ? arena.tags().find(tag) != NULL : findResponseTLV(arena, tag) != NULL)) {
+      found_tags |= 1u << i;
+      found_new = true;
+    }
+  }
+  return found_new;
+}
+
+//
+// Move the records that held wanted tags for this AID before to the
+// front of the list, keeping the AFL order otherwise.
+//
+void CardSession::preferHistoryRecords()
+{
+  RecordRef others[SESSION_MAX_RECORDS];
+  uint8_t num_preferred = 0;
+  uint8_t num_others = 0;
+
+  for (int i = 0; i < num_records; i++) {
+    if (record_history.contains(aid, aid_length, records[i])) {
+      records[num_preferred++] = records[i];
+    } else {
+      others[num_others++] = records[i];
+    }
+  }
+  memcpy(&records[num_preferred], others, num_others * sizeof(RecordRef));
+}
+
+// True if the record at pos follows on from the one before it in the same file
+bool CardSession::continuesRun(uint8_t pos) const
+{
+  return pos > 0 && pos < num_records &&
+         records[pos].sfi == records[pos - 1].sfi &&
+         records[pos].record == records[pos - 1].record + 1;
+}
+
+void CardSession::startReadRecord()
+{
+  RecordRef ref = records[record_pos];
+
+  // Print a header for each run of records in a file
+  if constexpr (TRACE_ENABLED(TRACE_LEVEL_PROGRESS)) {
+    if (!continuesRun(record_pos)) {
+      uint8_t end_pos = record_pos;
+      while (continuesRun(end_pos + 1)) {
+        end_pos++;
+      }
+      trace_out.putLine("*** Read app records");
+      trace_out.putStr("SFI: ");
+      trace_out.putDec(ref.sfi);
+      trace_out.putStr(", start: ");
+      trace_out.putDec(ref.record);
+      trace_out.putStr(", end: ");
+      trace_out.putDec(records[end_pos].record);
+      trace_out.putLine();
+    }
+  }
+
+  beginAppRecord(exchange, link, arena, ref.sfi, ref.record);
+}
+
+void CardSession::stepReadRecord()
+{
+  RecordRef ref = records[record_pos];
+
+  // A record the card refused is skipped, the rest are still read.
+  // After a lost link the record is read again once the card is back.
+  if (endAppRecord(exchange, arena)) {
+    if (num_required > 0 && checkRequiredTags()) {
+      record_history.add(aid, aid_length, ref);
+    }
+  } else if (link.getLastError() == LINK_CARD_REMOVED) {
+    TRACE_ERROR(trace_out.putLine("Card removed"));
+    enterState(SESSION_FAILED);
+    return;
+  } else if (recover()) {
+    return;
+  }
+
+  record_pos++;
+  if constexpr (TRACE_ENABLED(TRACE_LEVEL_PROGRESS)) {
+    if (!continuesRun(record_pos)) {
+      trace_out.putLine();
+    }
+  }
+
+  if (allRequiredFound()) {
+    TRACE_PROGRESS(trace_out.putLine("Read all required tags"));
+    enterState(SESSION_DONE);
+  } else if (record_pos == num_records) {
+    enterState(SESSION_DONE);
+  }
+}
+
+//
+// After a failed exchange: if the card was activated again, arrange to
+// select the application again and retry the step. Return true if the
+// step will be retried.
+//
+bool CardSession::recover()
+{
+  if (!link.takeReactivated() || resumes == SESSION_MAX_RESUMES) {
+    return false;
+  }
+  resumes++;
+  link_stats.resumes++;
+  resume = RESUME_SELECT;
+  return true;
+}
+
+//
+// Bring a reactivated card back to where the tap was: SELECT, then GPO
+// if records are still to be read
+//
+void CardSession::startResume()
+{
+  if (resume == RESUME_SELECT) {
+    TRACE_PROGRESS(trace_out.putLine("Card activated again, selecting the AID"));
+    beginSelectApplicationID(exchange, link, arena, aid, aid_length);
+  } else if (!beginProcessingOptions(exchange, link, arena, pdol_node)) {
+    TRACE_ERROR(trace_out.putLine("Failed to resume the tap"));
+    enterState(SESSION_FAILED);
+  }
+}
+
+void CardSession::stepResume()
+{
+  if (resume == RESUME_SELECT) {
+    TLVNode* pdol = NULL;
+    if (endSelectApplicationID(exchange, arena, pdol)) {
+      resume = state == SESSION_READ_RECORD ? RESUME_GPO : RESUME_NONE;
+      return;
+    }
+  } else {
+    if (endProcessingOptions(exchange, arena) != NULL) {
+      TRACE_PROGRESS(trace_out.putLine());
+      resume = RESUME_NONE;
+      return;
+    }
+  }
+
+  if (link.getLastError() != LINK_CARD_REMOVED && recover()) {
+    return;
+  }
+  TRACE_ERROR(trace_out.putLine("Failed to resume the tap"));
+  enterState(SESSION_FAILED);
+}
+
+void readCard(CardTransport& card)
+{
+  CardSession session(card);
+  session.cardDetected();
+  while (session.step()) {
+  }
+}
@@ -0,0 +1,205 @@
+#ifndef __CARD_SESSION_H__
+#define __CARD_SESSION_H__
+#include <stdint.h>
+#include "tlv.h"
+#include "card_transport.h"
+#include "aid_cache.h"
+#include "record_history.h"
+#include "session_arena.h"
+#include "retry_transport.h"
+#include "emv_reader.h"
+
+//
+// Card read session
+//
+// Runs the EMV read steps one at a time so the caller can do other
+// work between APDU exchanges. Each call to step() takes the card's
+// answer to the command sent by the last one, deals with it and sends
+// the next command, then returns; card detection is started and
+// finished the same way. The card works on the command while the
+// caller does something else. poll() says whether it has answered, and
+// step() waits for the answer if it hasn't. The state and the position
+// in the AFL are kept in the session, so the next step() resumes where
+// the last one stopped.
+//
+// The responses of a tap are kept in the session's arena. The AID,
+// label and PDOL point into earlier responses rather than being copied.
+//
+// With an AidCache, a card seen recently goes straight to SELECT with
+// the AID it used last time, and falls back to PPSE if that fails.
+//
+// In minimal read mode the session is given the tags it needs, and
+// stops reading records once all of them have been seen. Records that
+// held those tags for the same AID before are read first.
+//
+// With a debounce window, a card that was read and stays in the field
+// is not read again: detections of the same UID are skipped until it
+// hasn't been seen for the length of the window.
+//
+// Exchanges go through a RetryTransport, which sends a failed APDU
+// again. If that meant activating the card again, the session selects
+// the application again, and runs GPO again before reading more
+// records, then carries on with the step that failed. This happens up
+// to SESSION_MAX_RESUMES times a tap. A card that has left the field
+// ends the tap at once.
+//
+// Each state can have a timeout. If a tap spends longer than that in
+// one state, the session fails instead of continuing to talk to a slow
+// card.
+//
+
+#define SESSION_MAX_RECORDS 32
+#define SESSION_MAX_REQUIRED_TAGS 16
+#define SESSION_MAX_RESUMES 2
+
+enum SessionState {
+  SESSION_DETECT,         // Waiting for a card
+  SESSION_PPSE,           // Select 2pay.sys.ddf01, pick the AID
+  SESSION_SELECT,         // Select the AID, get the PDOL
+  SESSION_GPO,            // Get Processing Options, get the AFL
+  SESSION_READ_RECORD,    // Read the records listed in the AFL
+  SESSION_DONE,           // Tap completed
+  SESSION_FAILED,         // Tap ended early
+  NUM_SESSION_STATES
+};
+
+class CardSession {
+public:
+  CardSession(CardTransport& card);
+
+  // Run one step: take the card's answer to the last command or
+  // detection and send the next. Return true while a tap or card
+  // detection is in progress.
+  bool step();
+
+  // True if step() would not wait for the card: it has answered, or
+  // nothing was sent
+  bool poll();
+
+  // A command or card detection was sent and step() hasn't taken the
+  // answer yet
+  bool isWaiting() const { return detecting || exchange.isActive(); }
+
+  // Abandon any tap in progress and look for a card on the next step.
+  // Waits for the answer to a command still on its way.
+  void reset();
+
+  // Skip detection: a card is already in the field
+  void cardDetected();
+
+  SessionState getState() const { return state; }
+  bool isActive() const;
+
+  // Max time in ms to spend in a state. 0 for no limit.
+  void setStateTimeout(SessionState state, unsigned long timeout_ms);
+
+  // Remember the AID chosen for each card, and skip PPSE when a card
+  // returns. NULL (the default) always reads PPSE.
+  void useAidCache(AidCache* cache) { aid_cache = cache; }
+
+  // Minimal read mode: stop reading records once these tags are found.
+  // A count of 0 (the default) reads every record.
+  void setRequiredTags(const uint16_t* tags, uint8_t count);
+
+  // Skip detections of the card last read until it has been out of the
+  // field for window_ms. 0 (the default) reads it every time.
+  void setDebounce(unsigned long window_ms) { debounce_ms = window_ms; }
+
+  // Detections skipped by the debounce
+  unsigned long getSuppressed() const { return suppressed; }
+
+  // Exchanges completed, for statistics
+  unsigned long getExchanges() const { return exchanges; }
+
+  // The transport this session reads cards through
+  CardTransport& getTransport() { return link; }
+
+  // Tags from every response of the current or last tap
+  const TagIndex& tags() const { return arena.tags(); }
+
+  // UID and AID of the current or last tap. The AID is NULL until one
+  // has been chosen.
+  const uint8_t* getUID(uint8_t* length) const { *length = uid_length; return uid; }
+  const uint8_t* getAID(uint8_t* length) const { *length = aid_length; return aid; }
+
+  static const char* stateName(SessionState state);
+
+private:
+  bool runStep();
+  void enterState(SessionState next);
+  bool checkRequiredTags();
+  bool allRequiredFound() const;
+  void preferHistoryRecords();
+  bool continuesRun(uint8_t pos) const;
+  bool isRepeat();
+  bool recover();
+  bool isResuming() const;
+
+  // start sends the command of the state, step deals with the answer
+  void startStep();
+  void finishStep();
+  void startDetect();
+  void stepDetect();
+  void stepPPSE();
+  void stepSelect();
+  void startGPO();
+  void stepGPO();
+  void startReadRecord();
+  void stepReadRecord();
+  void startResume();
+  void stepResume();
+
+  RetryTransport link;
+  ApduExchange exchange;
+  bool detecting;               // Card detection sent
+  SessionState state;
+  unsigned long state_start;
+  unsigned long state_timeout[NUM_SESSION_STATES];
+
+  AidCache* aid_cache;
+
+  SessionArena arena;
+
+  // Results carried between steps, pointing into the arena
+  uint8_t uid[AID_CACHE_MAX_UID];
+  uint8_t uid_length;
+  const uint8_t* aid;
+  uint8_t aid_length;
+  const uint8_t* label;
+  uint8_t label_length;
+  bool aid_from_cache;
+  TLVNode* pdol_node;
+
+  // Records listed in the AFL, and the resume point
+  RecordRef records[SESSION_MAX_RECORDS];
+  uint8_t num_records;
+  uint8_t record_pos;
+
+  // Exchanges to redo after the card was activated again
+  enum Resume {
+    RESUME_NONE,
+    RESUME_SELECT,
+    RESUME_GPO
+  };
+  Resume resume;
+  uint8_t resumes;        // This tap
+
+  // Minimal read mode
+  uint16_t required_tags[SESSION_MAX_REQUIRED_TAGS];
+  uint8_t num_required;
+  uint16_t found_tags;    // Bit per required tag
+
+  // Debounce: the card last read, and when it was last seen
+  uint8_t last_uid[AID_CACHE_MAX_UID];
+  uint8_t last_uid_length;
+  unsigned long last_uid_seen;
+  unsigned long debounce_ms;
+  unsigned long suppressed;
+  unsigned long exchanges;
+  bool waiting;                 // "Waiting" printed since the last card
+};
+
+// Run a whole tap for a card that was just detected on the transport
+void readCard(CardTransport& card);
+
+#endif /* __CARD_SESSION_H__ */
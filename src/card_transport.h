@@ -0,0 +1,95 @@
+#ifndef __CARD_TRANSPORT_H__
+#define __CARD_TRANSPORT_H__
+#include <stdint.h>
+
+//
+// Why an exchange failed
+//
+enum LinkError {
+  LINK_OK,
+  LINK_TIMEOUT,         // The card didn't answer
+  LINK_PROTOCOL,        // Garbled, short or malformed frame
+  LINK_CARD_REMOVED,    // The card left the field
+  LINK_STATUS,          // The card answered with an error status word
+  NUM_LINK_ERRORS
+};
+
+//
+// Link to a contactless card.
+//
+// The firmware implements this with the PN532, the host build
+// with a simulated card, so the EMV steps don't depend on the hardware.
+//
+// Exchanges and detection can also be run in two halves, so the
+// caller is free while the card works: submit() or submitDetect()
+// starts one, poll() says when it has finished, and complete() collects
+// the result, waiting for it if need be. A transport that can only
+// block runs the whole of it in the submit call, which is what the
+// defaults here do.
+//
+class CardTransport {
+public:
+  CardTransport() : pending(false), pending_result(false), pending_length(0) {}
+  virtual ~CardTransport() {}
+
+  // Look for a card in the field.
+  // Return true if a card was found and activated.
+  virtual bool detectCard() = 0;
+
+  // How long detectCard() looks for a card before giving up.
+  // A transport that can't change it ignores this.
+  virtual void setDetectTimeout(uint16_t /* timeout_ms */) {}
+
+  // UID of the card found by the last detectCard().
+  // On entry uid_length is the size of uid. Return false if the UID isn't known.
+  virtual bool getCardUID(uint8_t* /* uid */, uint8_t* /* uid_length */) { return false; }
+
+  // Send a command APDU and receive the response APDU.
+  // On entry rx_length is the size of rx, on return the number of bytes received.
+  virtual bool transceive(const uint8_t* tx, uint8_t tx_length,
+                          uint8_t* rx, uint8_t* rx_length) = 0;
+
+  // Why the last transceive() failed. A transport that can't tell says
+  // timeout; detecting the card again shows whether it is still there.
+  virtual LinkError getLastError() { return LINK_TIMEOUT; }
+
+  // Start an exchange. tx and rx must stay valid until complete().
+  // Return false if it could not be started.
+  virtual bool submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size) {
+    pending = true;
+    pending_length = rx_size;
+    pending_result = transceive(tx, tx_length, rx, &pending_length);
+    return true;
+  }
+
+  // Start looking for a card, as detectCard() does
+  virtual bool submitDetect() {
+    pending = true;
+    pending_length = 0;
+    pending_result = detectCard();
+    return true;
+  }
+
+  // True once the submitted exchange or detection has finished, or has
+  // run out of time, so complete() would not wait. True if none is
+  // pending.
+  virtual bool poll() { return true; }
+
+  // Wait for the submitted exchange or detection to finish, up to the
+  // transport's time limit for it. Return true with rx_length set if a
+  // response was received, or a card was found (rx_length 0).
+  virtual bool complete(uint8_t* rx_length) {
+    bool result = pending && pending_result;
+    pending = false;
+    *rx_length = result ? pending_length : 0;
+    return result;
+  }
+
+private:
+  // Result of an exchange run by the default submit()
+  bool pending;
+  bool pending_result;
+  uint8_t pending_length;
+};
+
+#endif /* __CARD_TRANSPORT_H__ */
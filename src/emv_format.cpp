@@ -0,0 +1,179 @@
+//
+// Allocation free text formatting for the trace output
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include "emv_format.h"
+#include "emv_tag_names.h"
+
+TextFormatter trace_out(Serial);
+
+static const char hex_upper[] = "0123456789ABCDEF";
+static const char hex_lower[] = "0123456789abcdef";
+
+TextFormatter::TextFormatter(Print& out)
+  : out(&out), pos(0)
+{
+}
+
+void TextFormatter::setOutput(Print& out)
+{
+  flush();
+  this->out = &out;
+}
+
+void TextFormatter::flush()
+{
+  if (pos > 0) {
+    out->write((const uint8_t*) buffer, pos);
+    pos = 0;
+  }
+}
+
+void TextFormatter::putChar(char c)
+{
+  if (pos == sizeof(buffer)) {
+    flush();
+  }
+  buffer[pos++] = c;
+}
+
+void TextFormatter::putStr(const char* str)
+{
+  while (*str != '\0') {
+    putChar(*str++);
+  }
+}
+
+void TextFormatter::putLine(const char* str)
+{
+  putStr(str);
+  putStr("\r\n");
+}
+
+void TextFormatter::putDec(unsigned long value, int width)
+{
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  putSpaces(width - n);
+  while (n > 0) {
+    putChar(digits[--n]);
+  }
+}
+
+void TextFormatter::putHex(unsigned long value)
+{
+  char digits[2 * sizeof(value)];
+  int n = 0;
+  do {
+    digits[n++] = hex_upper[value & 0xf];
+    value >>= 4;
+  } while (value != 0);
+  while (n > 0) {
+    putChar(digits[--n]);
+  }
+}
+
+void TextFormatter::putHexByte(uint8_t value, bool lower_case)
+{
+  const char* digits = lower_case ? hex_lower : hex_upper;
+  putChar(digits[value >> 4]);
+  putChar(digits[value & 0xf]);
+}
+
+void TextFormatter::putSpaces(int count)
+{
+  while (count-- > 0) {
+    putChar(' ');
+  }
+}
+
+void TextFormatter::putHexBytes(const uint8_t* buffer, int length, bool lower_case)
+{
+  for (int i = 0; i < length; i++) {
+    putHexByte(buffer[i], lower_case);
+    putChar(' ');
+  }
+}
+
+void TextFormatter::putValue(const uint8_t* buffer, int length)
+{
+  bool printable = length > 0;
+  for (int i = 0; i < length && printable; i++) {
+    printable = buffer[i] >= 0x20 && buffer[i] <= 0x7e;
+  }
+
+  if (!printable) {
+    putHexBytes(buffer, length);
+    return;
+  }
+  for (int i = 0; i < length; i++) {
+    putChar((char) buffer[i]);
+  }
+}
+
+void TextFormatter::putTLV(TLVNode* node, int indent)
+{
+  putSpaces(2 * indent);
+
+  if (node == NULL) {
+    putLine("NULL pointer for TLVNode....");
+    return;
+  }
+
+  putStr("Tag: ");
+  putHex(node->getTag());
+  char tag_name[TAG_NAME_MAX];
+  get_tag_name(node->getTag(), node->getValueLength(), tag_name, sizeof(tag_name));
+  if (tag_name[0] != '\0') {
+    putStr(" - ");
+    putStr(tag_name);
+  }
+  putStr(" (");
+  putDec(node->getValueLength());
+  putLine(" bytes)");
+
+  TLVNode *child = node->firstChild();
+  if (child == NULL) {
+    putSpaces(4 * (indent + 1));
+    putValue(node->getValue(), node->getValueLength());
+    putLine();
+  }
+
+  while (child != NULL) {
+    putTLV(child, indent + 1);
+    child = node->nextChild(child);
+  }
+}
+
+void TextFormatter::putCommand(const uint8_t* buffer, int length)
+{
+  putStr("TX message (");
+  putDec(length);
+  putStr(" bytes): ");
+  putHexBytes(buffer, length, true);
+  putLine();
+}
+
+void TextFormatter::putResponse(const uint8_t* buffer, int length)
+{
+  putStr("RX message (");
+  putDec(length);
+  putLine(" bytes): ");
+
+  for (int i = 0; i < length; i++) {
+    putChar(' ');
+    putHexByte(buffer[i]);
+  }
+  putSpaces(4);
+  for (int i = 0; i < length; i++) {
+    char c = (char) buffer[i];
+    putChar(c <= 0x1f || c > 0x7e ? '.' : c);
+  }
+  putLine();
+}
@@ -0,0 +1,60 @@
+#ifndef __EMV_FORMAT_H__
+#define __EMV_FORMAT_H__
+#include <Arduino.h>
+#include <stdint.h>
+#include "tlv.h"
+
+//
+// Allocation free text formatting for the trace output
+//
+// Text is assembled in a fixed buffer and written to the output in
+// large chunks, either when the buffer fills or on flush().
+//
+
+#ifndef FORMAT_BUFFER_SIZE
+#define FORMAT_BUFFER_SIZE 128
+#endif
+
+class TextFormatter {
+public:
+  TextFormatter(Print& out);
+
+  void putChar(char c);
+  void putStr(const char* str);
+  void putLine(const char* str = "");   // String and end of line
+  void putDec(unsigned long value, int width = 0);  // Right aligned in width
+  void putHex(unsigned long value);     // Upper case, no leading zeros
+  void putHexByte(uint8_t value, bool lower_case = false);
+  void putSpaces(int count);
+
+  // Hex bytes, each followed by a space
+  void putHexBytes(const uint8_t* buffer, int length, bool lower_case = false);
+
+  // TLV value: text if all characters are printable, otherwise hex bytes
+  void putValue(const uint8_t* buffer, int length);
+
+  // A TLV node and all of its children, one tag per line
+  void putTLV(TLVNode* node, int indent = 0);
+
+  // Command APDU: length and hex bytes on one line
+  void putCommand(const uint8_t* buffer, int length);
+
+  // Response APDU: length, then hex bytes followed by the printable characters
+  void putResponse(const uint8_t* buffer, int length);
+
+  // Write out the buffered text
+  void flush();
+
+  // Change where the text is written
+  void setOutput(Print& out);
+
+private:
+  Print* out;
+  char buffer[FORMAT_BUFFER_SIZE];
+  int pos;
+};
+
+// Formatter for the serial trace
+extern TextFormatter trace_out;
+
+#endif /* __EMV_FORMAT_H__ */
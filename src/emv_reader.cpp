@@ -0,0 +1,602 @@
+//
+// Read EMV data from a payment card
+//
+// Copyright (c) 2025 James Wanderer
+//
+// The card is reached through a CardTransport: the PN532 on the
+// firmware, or a simulated card on the host build.
+//
+
+#include <Arduino.h>
+#include <time.h>
+#include "tlv.h"
+#include "emv_tag_names.h"
+#include "emv_reader.h"
+#include "emv_format.h"
+#include "trace_output.h"
+#include "tap_stats.h"
+#include "gpo_cache.h"
+#include "terminal_profile.h"
+#include "apdu_builder.h"
+#include "trace_level.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_random.h>
+#endif
+
+//
+// Limit on GET RESPONSE commands for one response
+//
+#ifndef GET_RESPONSE_MAX
+#define GET_RESPONSE_MAX 8
+#endif
+
+void printMessage(const uint8_t *buffer, uint8_t length);
+
+ApduExchange::ApduExchange()
+  : card(NULL), arena(NULL), phase(STAT_PPSE), start_us(0), tx(NULL), tx_length(0),
+    response(NULL), received(0), total(0), parts(0), resent(false), sent(false),
+    waiting(false), success(false)
+{
+}
+
+void ApduExchange::start(CardTransport& card, SessionArena& arena, StatPhase phase,
+                         const uint8_t* tx, uint8_t tx_length)
+{
+  this->card = &card;
+  this->arena = &arena;
+  this->phase = phase;
+  this->tx = tx;
+  this->tx_length = tx_length;
+  response = arena.beginResponse();
+  received = 0;
+  total = 0;
+  parts = 0;
+  resent = false;
+  success = true;
+  start_us = micros();
+  send(tx, tx_length, RESPONSE_BUFFER_SIZE);
+}
+
+//
+// Send a command. Its answer goes after the parts received so far.
+//
+void ApduExchange::send(const uint8_t* command, uint8_t command_length, uint8_t size)
+{
+  sent = card->submit(command, command_length, response->data + received, size);
+  waiting = true;
+}
+
+bool ApduExchange::poll()
+{
+  return !waiting || card->poll();
+}
+
+bool ApduExchange::advance()
+{
+  do {
+    next();
+  } while (waiting && card->poll());
+  return !waiting;
+}
+
+//
+// Take the answer to the command sent last, and send the command the
+// status words ask for, if any
+//
+void ApduExchange::next()
+{
+  if (!waiting) {
+    return;
+  }
+  waiting = false;
+  uint8_t length = 0;
+  if (!sent || !card->complete(&length)) {
+    success = false;
+    return;
+  }
+  total = received + length;
+
+  // Wrong Le: send the command again with the length the card gave
+  if (!resent && parts == 0 && length == 2 && response->data[0] == 0x6C && tx_length >= 5) {
+    uint8_t* retry = arena->commandBuffer();
+    if (retry != tx) {
+      memcpy(retry, tx, tx_length);
+    }
+    retry[tx_length - 1] = response->data[1];
+    TRACE_APDU(printMessage(retry, tx_length));
+    resent = true;
+    send(retry, tx_length, RESPONSE_BUFFER_SIZE);
+    return;
+  }
+
+  // More data: each part replaces the status bytes of the one before
+  if (total >= 2 && response->data[total - 2] == 0x61) {
+    received = total - 2;
+    // Room for the bytes the card has left (00 is 256 or more) and the
+    // status, as far as one exchange and the largest response allow
+    uint8_t remaining = response->data[total - 1];
+    int part = min((remaining == 0 ? 256 : remaining) + 2, RESPONSE_BUFFER_SIZE);
+    uint16_t size = min(received + part, RESPONSE_MAX_SIZE);
+    if (parts == GET_RESPONSE_MAX || size <= received + 2 || !arena->growResponse(response, size)) {
+      TRACE_ERROR(trace_out.putLine("Response too long"));
+      success = false;
+      return;
+    }
+    parts++;
+    get_response[0] = 0x00;       // CLA
+    get_response[1] = 0xC0;       // INS: GET RESPONSE
+    get_response[2] = 0x00;       // P1
+    get_response[3] = 0x00;       // P2
+    get_response[4] = remaining;  // Le
+    TRACE_APDU(printMessage(get_response, sizeof(get_response)));
+    send(get_response, sizeof(get_response), size - received);
+  }
+}
+
+Response* ApduExchange::finish()
+{
+  if (card == NULL) {
+    return NULL;
+  }
+  while (waiting) {
+    next();
+  }
+  card = NULL;
+  tap_stats.record(phase, start_us);
+
+  if (!success) {
+    arena->cancelResponse(response);
+    return NULL;
+  }
+  arena->endResponse(response, total);
+  return response;
+}
+
+//
+// Decode a response message, less the status bytes
+//
+static TLVS* decodeResponse(SessionArena& arena, Response* response)
+{
+  unsigned long start = micros();
+  TLVS* tlvs = arena.decode(response, response->length - 2);
+  tap_stats.record(STAT_DECODE, start);
+  return tlvs;
+}
+
+//
+// Dump a binary message to the serial port.
+//
+void printMessage(const uint8_t *buffer, uint8_t length)
+{
+  unsigned long start = micros();
+  traceCommand(buffer, length);
+  tap_stats.record(STAT_OUTPUT, start);
+}
+
+
+//
+// Dump an APDU response to the serial port.
+//
+void printResponse(const uint8_t *buffer, uint16_t length)
+{
+  unsigned long start = micros();
+  traceResponse(buffer, length);
+  tap_stats.record(STAT_OUTPUT, start);
+}
+
+//
+// Print the value of a TLV and all sub-TLVs to the serial port.
+//
+void printTLV(TLVNode* node)
+{
+  unsigned long start = micros();
+  traceTLV(node);
+  tap_stats.record(STAT_OUTPUT, start);
+}
+
+
+//
+// Check the status bytes in a Response APDU.
+// Return True if OK
+//
+bool checkApduResponse(const uint8_t *rx_buffer, uint16_t length)
+{
+  if (length < 2) {
+    if constexpr (TRACE_ENABLED(TRACE_LEVEL_ERROR)) {
+      trace_out.putStr("Short APDU response - ");
+      trace_out.putDec(length);
+      trace_out.putLine(" bytes.");
+    }
+    return false;
+  }
+
+  // Check SW1 and SW2. 61xx and 6Cxx were dealt with by ApduExchange.
+  if (rx_buffer[length-2] != 0x90 || rx_buffer[length-1] != 0x00) {
+    if constexpr (TRACE_ENABLED(TRACE_LEVEL_ERROR)) {
+      trace_out.putStr("Error response to APDU: ");
+      trace_out.putHexByte(rx_buffer[length-2]);
+      trace_out.putHexByte(rx_buffer[length-1]);
+      trace_out.putLine();
+    }
+    return false;
+  }
+  return true;
+}
+ 
+/*** Step 1: read 2pay.sys.ddf01 and return an Application ID ***/
+
+static constexpr auto ppse_select = selectByName("2PAY.SYS.DDF01");
+
+//
+// Get the preferred App Identifier from the card
+//
+void beginPreferredAID(ApduExchange& exchange, CardTransport& card, SessionArena& arena)
+{
+  TRACE_PROGRESS(trace_out.putLine("*** GetPreferredAID"));
+
+  // Send the request
+  TRACE_APDU(printMessage(ppse_select.bytes, ppse_select.size()));
+  exchange.start(card, arena, STAT_PPSE, ppse_select.bytes, ppse_select.size());
+}
+
+TLVNode* endPreferredAID(ApduExchange& exchange, SessionArena& arena, TLVNode** label_node)
+{
+  Response* response = exchange.finish();
+
+  // Check the response
+  if (response == NULL) {
+    TRACE_ERROR(trace_out.putStr("No AID found"));
+    return NULL;
+  }
+  TRACE_APDU(printResponse(response->data, response->length));
+
+  if (!checkApduResponse(response->data, response->length)) {
+    return NULL;
+  }
+
+  // Parse the result message
+  TLVS* tlvs = decodeResponse(arena, response);
+  TRACE_RESULT(printTLV(tlvs->firstTLV()));
+
+  TLVNode *node = tlvs->findTLV(0x61);
+  TLVNode *sel_aid_node = NULL;
+  TLVNode *sel_label_node = NULL;
+  uint8_t sel_app_pref = 99;
+
+  while (node != NULL) {
+    TLVNode *pref_node = node->findChild(0x87);
+    TLVNode *label_node = node->findChild(0x50);
+    TLVNode *aid_node = node->findChild(0x4f);
+
+    if (aid_node != NULL) {
+      // Use the App Pref value if present
+      uint8_t app_pref = 98;
+      if (pref_node != NULL) {
+        app_pref = pref_node->getValue()[0];
+      }
+
+      if (app_pref < sel_app_pref) {
+        sel_app_pref = app_pref;
+        sel_aid_node = aid_node;
+        sel_label_node = label_node;
+      }
+    }
+    node = tlvs->findNextTLV(node);
+  }
+  if constexpr (TRACE_ENABLED(TRACE_LEVEL_PROGRESS)) {
+    trace_out.putStr("Returning app pref: ");
+    trace_out.putDec(sel_app_pref);
+    if (sel_label_node != NULL) {
+      trace_out.putStr(": ");
+      trace_out.putValue(sel_label_node->getValue(), sel_label_node->getValueLength());
+      trace_out.flush();
+    }
+    trace_out.putLine();
+  }
+  if (label_node != NULL) {
+    *label_node = sel_label_node;
+  }
+  return sel_aid_node;
+}
+
+
+/*** Step 2: Select the Application ID, and return the PD options list ***/
+
+static constexpr auto select_header = apduHeader(0x00, 0xA4, 0x04, 0x00);   // SELECT by name
+
+//
+// Select the given AID
+//
+void beginSelectApplicationID(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                              const uint8_t* aid, uint8_t aid_length)
+{
+  uint8_t* tx_buffer = arena.commandBuffer();
+  TRACE_PROGRESS(trace_out.putLine("*** Select Application ID"));
+
+  WriteBuffer tx(tx_buffer, COMMAND_BUFFER_SIZE);
+  tx.putBytes(select_header.bytes, select_header.size());
+  // Add command data
+  tx.putByte(aid_length);   // AID Length
+  tx.putBytes(aid, aid_length); // AID Value
+  tx.putByte(0);  // Le
+  TRACE_APDU(printMessage(tx_buffer, (uint8_t) tx.pos));
+
+  exchange.start(card, arena, STAT_SELECT, tx.buffer, tx.pos);
+}
+
+//
+// Return the list of processing data options of the selected AID, if any
+//
+bool endSelectApplicationID(ApduExchange& exchange, SessionArena& arena, TLVNode*& pdol_node)
+{
+  Response* response = exchange.finish();
+
+  if (response == NULL) {
+    TRACE_ERROR(trace_out.putLine("Failed"));
+    return false;
+  }
+  TRACE_APDU(printResponse(response->data, response->length));
+
+  if (!checkApduResponse(response->data, response->length)) {
+    return false;
+  }
+
+  TLVS* tlvs = decodeResponse(arena, response);
+  TRACE_RESULT(printTLV(tlvs->firstTLV()));
+
+  // Return the Processing Data Options List
+  pdol_node = tlvs->findTLV(0x9f38);
+  return  true;
+}
+
+/***  Default Data Options: Build Data Options List  ***/
+
+// Values that change per transaction, patched into cached GPO commands.
+// The date stays at this one until the clock has been set.
+uint8_t transaction_date[3] = { 0x23, 0x03, 0x01 };
+uint8_t unpredictable_number[4] = { 0x38, 0x39, 0x30, 0x31 };
+
+static uint8_t toBCD(int value)
+{
+  return (value / 10) << 4 | value % 10;
+}
+
+void refreshTransactionData()
+{
+#ifdef ARDUINO_ARCH_ESP32
+  uint32_t number = esp_random();
+#else
+  // The same sequence on every run, so host traces can be compared
+  static uint32_t state = 0x38393031;
+  state = state * 1664525 + 1013904223;
+  uint32_t number = state;
+#endif
+  unpredictable_number[0] = number >> 24;
+  unpredictable_number[1] = number >> 16;
+  unpredictable_number[2] = number >> 8;
+  unpredictable_number[3] = number;
+
+  time_t now = time(NULL);
+  struct tm date;
+  if (localtime_r(&now, &date) != NULL && date.tm_year + 1900 >= 2024) {
+    transaction_date[0] = toBCD(date.tm_year % 100);
+    transaction_date[1] = toBCD(date.tm_mon + 1);
+    transaction_date[2] = toBCD(date.tm_mday);
+  }
+}
+
+// Seach the terminal profile for a matching tag
+// Return NULL if not found
+static const DataOption* getDataOption(uint16_t tag)
+{
+  return ActiveTerminalProfile::options.find(tag);
+}
+
+// Build Processing Data Options
+// In: A TLV node with tag 9f38. The value lists required Data Options. NULL is OK.
+// Out: data_operations filled with expected response
+//      patches, if not NULL, gets the position of each per transaction value
+//      check, if not NULL, counts the problems instead of printing them
+//
+bool buildDataOptionsList(TLVNode* pdol_node, WriteBuffer& data_options,
+                          GpoPatchList* patches, DolCheck* check)
+{
+  ReadBuffer dol_list;
+
+  if (pdol_node != NULL) {
+      dol_list.buffer = pdol_node->getValue();
+      dol_list.buffer_size = pdol_node->getValueLength();
+  }
+
+  while (!dol_list.atEnd()) {
+    uint16_t tag;
+    uint8_t len;
+    int error_flag;
+
+    tag = TLVNode::parseTag(dol_list, &error_flag);
+    if (error_flag ||
+        !dol_list.getByte(len)) {
+          if (check == NULL) {
+            TRACE_ERROR(trace_out.putLine("Failed reading dol_list"));
+          }
+          return false;
+    }
+
+    const DataOption* option = getDataOption(tag);
+    if (option == NULL) {
+      if (check != NULL) {
+        check->unknown_tags++;
+      } else if constexpr (TRACE_ENABLED(TRACE_LEVEL_ERROR)) {
+        trace_out.putStr("Don't have a requested option tag: ");
+        trace_out.putHex(tag);
+      }
+      // Add with 0 values
+      while (len-- > 0) data_options.putByte(0);
+      continue;
+    }
+
+    // Copy value into PDOL buffer
+    // Truncate if our value is too long
+    int copy_len = min(option->value_length, len);
+    if (option->per_transaction && patches != NULL) {
+      patches->add(data_options.pos, copy_len, option->value);
+    }
+    data_options.putBytes(option->value, copy_len);
+
+    // Report any mismatch length, handle need to pad value.
+    if (option->value_length != len) {
+      if (check != NULL) {
+        check->length_mismatches++;
+      } else if constexpr (TRACE_ENABLED(TRACE_LEVEL_ERROR)) {
+        trace_out.putLine("mismatched expectation on value length");
+        trace_out.putHex(tag);
+        trace_out.putStr(" requested len: ");
+        trace_out.putDec(len);
+        trace_out.putStr(" actual len: ");
+        trace_out.putDec(option->value_length);
+        trace_out.putLine();
+      }
+
+      // Pad with zeros if it was too short
+      if (copy_len < len) {
+        len -= option->value_length;
+        while (len-- > 0) data_options.putByte(0);
+      }
+    }
+  }
+  return true;
+}
+
+
+/***  Step 3: Get Processing Options - get AFL  ***/
+
+static constexpr auto gpo_header = apduHeader(0x80, 0xA8, 0x00, 0x00);   // GET PROCESSING OPTIONS
+
+//
+// Ask for the Application Files Locator (ALF) for files used in the transaction
+//
+bool beginProcessingOptions(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                            TLVNode* pdol_node)
+{
+  uint8_t* tx_buffer = arena.commandBuffer();
+  TRACE_PROGRESS(trace_out.putLine("*** GetProcessingOptions"));
+
+  const uint8_t* pdol = NULL;
+  uint8_t pdol_length = 0;
+  if (pdol_node != NULL) {
+    pdol = pdol_node->getValue();
+    pdol_length = pdol_node->getValueLength();
+  }
+
+  // Reuse the command built for an identical PDOL if we have one. Either
+  // way it carries this transaction's values.
+  refreshTransactionData();
+  WriteBuffer tx(tx_buffer, COMMAND_BUFFER_SIZE);
+  tx.pos = gpo_cache.lookup(pdol, pdol_length, tx_buffer);
+
+  if (tx.pos == 0) {
+    // Build the data options in place, after the header, Lc and the 83 tag and length.
+    // One byte is left at the end for Le.
+    const int data_start = gpo_header.size() + 3;
+    WriteBuffer data_options(tx_buffer + data_start, COMMAND_BUFFER_SIZE - data_start - 1);
+    GpoPatchList patches;
+    unsigned long start = micros();
+    bool built = buildDataOptionsList(pdol_node, data_options, &patches);
+    tap_stats.record(STAT_BUILD_DOL, start);
+    if (!built) {
+      return false;
+    }
+
+    // Add the header around the PDOL
+    tx.putBytes(gpo_header.bytes, gpo_header.size());
+    tx.putByte(data_options.pos + 2);
+    tx.putByte(0x83);
+    tx.putByte(data_options.pos);
+    tx.pos += data_options.pos;
+    tx.putByte(0);  // Le
+
+    // Cache the command. Patch offsets become relative to the command.
+    for (int i = 0; i < patches.count; i++) {
+      patches.patches[i].offset += data_start;
+    }
+    gpo_cache.store(pdol, pdol_length, tx_buffer, (uint8_t) tx.pos, patches);
+  }
+  TRACE_APDU(printMessage(tx_buffer, (uint8_t) tx.pos));
+
+  exchange.start(card, arena, STAT_GPO, tx.buffer, tx.pos);
+  return true;
+}
+
+//
+// Returns the Application Files Locator (ALF) for files used in the transaction
+//
+TLVNode* endProcessingOptions(ApduExchange& exchange, SessionArena& arena)
+{
+  Response* response = exchange.finish();
+
+  if (response == NULL) {
+    TRACE_ERROR(trace_out.putLine("Failed"));
+    return NULL;
+  }
+
+  TRACE_APDU(printResponse(response->data, response->length));
+
+  if (!checkApduResponse(response->data, response->length)) {
+    return NULL;
+  }
+
+  TLVS* tlvs = decodeResponse(arena, response);
+  TRACE_RESULT(printTLV(tlvs->firstTLV()));
+  TLVNode *node = tlvs->findTLV(0x94);
+  return node;
+}
+
+
+/***  Step 4: Read Application Records ***/
+
+// P1 is the record number, P2 the SFI in the top 5 bits and 100 (P1 is a record number)
+static constexpr auto read_record_template = apduWithLe(0x00, 0xB2, 0x00, 0b00000100);   // READ RECORD
+
+//
+// Read one record from a short file
+//
+void beginAppRecord(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                    uint8_t sfi, uint8_t record)
+{
+  uint8_t* tx_buffer = arena.commandBuffer();
+  memcpy(tx_buffer, read_record_template.bytes, read_record_template.size());
+  tx_buffer[2] = record;
+  tx_buffer[3] |= sfi << 3;
+  TRACE_APDU(printMessage(tx_buffer, read_record_template.size()));
+  exchange.start(card, arena, STAT_READ_RECORD, tx_buffer, read_record_template.size());
+}
+
+//
+// Return true if the record was read
+//
+bool endAppRecord(ApduExchange& exchange, SessionArena& arena)
+{
+  Response* response = exchange.finish();
+  if (response == NULL) {
+    TRACE_ERROR(trace_out.putLine("Read Application Record: Failed"));
+    return false;
+  }
+
+  TRACE_APDU(printResponse(response->data, response->length));
+
+  if (!checkApduResponse(response->data, response->length)) {
+    return false;
+  }
+  TRACE_APDU(trace_out.putLine());
+
+  TLVS* tlvs = decodeResponse(arena, response);
+  TRACE_RESULT(printTLV(tlvs->firstTLV()));
+  TRACE_RESULT(trace_out.putLine());
+  return true;
+}
+
+TLVNode* findResponseTLV(SessionArena& arena, uint16_t tag)
+{
+  Response* response = arena.lastDecoded();
+  return response != NULL ? response->tlvs->findTLV(tag) : NULL;
+}
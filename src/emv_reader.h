@@ -0,0 +1,108 @@
+#ifndef __EMV_READER_H__
+#define __EMV_READER_H__
+#include <stdint.h>
+#include "tlv.h"
+#include "card_transport.h"
+#include "session_arena.h"
+#include "gpo_cache.h"
+#include "tap_stats.h"
+
+//
+// Steps to read the EMV data from a payment card
+// Each step is one APDU exchange, in two halves: begin sends the
+// command and end collects the response, so the caller is free while
+// the card works on it. CardSession runs them in order.
+// Responses are kept in the session's arena, so the TLV nodes returned
+// stay valid until the arena is reset for the next tap.
+//
+
+//
+// An APDU exchange in progress
+//
+// The status words that ask for another command are handled here:
+// 6Cxx sends the command again with Le xx, and 61xx fetches the rest
+// of the response with GET RESPONSE, joining the parts into one
+// response. poll() says whether the card has answered the command sent
+// last, advance() takes the answer and sends the next command if there
+// is one, and finish() returns the whole response, waiting if need be.
+//
+class ApduExchange {
+public:
+  ApduExchange();
+
+  // Send a command, timed as the given phase until finish().
+  // The response is received into the arena.
+  void start(CardTransport& card, SessionArena& arena, StatPhase phase,
+             const uint8_t* tx, uint8_t tx_length);
+
+  // True if advance() would not wait for the card
+  bool poll();
+
+  // Take the card's answers so far and send the next command if the
+  // response needs one. Return true once the response is complete.
+  bool advance();
+
+  // The response, or NULL if the exchange failed
+  Response* finish();
+
+  // True from start() until finish()
+  bool isActive() const { return card != NULL; }
+
+private:
+  void send(const uint8_t* command, uint8_t command_length, uint8_t size);
+  void next();
+
+  CardTransport* card;
+  SessionArena* arena;
+  StatPhase phase;
+  unsigned long start_us;
+  const uint8_t* tx;
+  uint8_t tx_length;
+  Response* response;
+  uint16_t received;        // Bytes of the parts before the one on its way
+  uint16_t total;
+  uint8_t parts;            // GET RESPONSE commands sent
+  bool resent;              // Sent again after 6Cxx
+  bool sent;                // Taken by the transport
+  bool waiting;             // For the card to answer
+  bool success;
+  uint8_t get_response[5];
+};
+
+// Step 1: read 2pay.sys.ddf01 and return an Application ID, and its label if wanted
+void beginPreferredAID(ApduExchange& exchange, CardTransport& card, SessionArena& arena);
+TLVNode* endPreferredAID(ApduExchange& exchange, SessionArena& arena, TLVNode** label_node = NULL);
+
+// Step 2: Select the Application ID, and return the PD options list
+void beginSelectApplicationID(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                              const uint8_t* aid, uint8_t aid_length);
+bool endSelectApplicationID(ApduExchange& exchange, SessionArena& arena, TLVNode*& pdol_node);
+
+// Step 3: Get Processing Options - get AFL.
+// begin returns false, sending nothing, if the command can't be built.
+bool beginProcessingOptions(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                            TLVNode* pdol_node);
+TLVNode* endProcessingOptions(ApduExchange& exchange, SessionArena& arena);
+
+// Step 4: Read Application Records, one record at a time
+void beginAppRecord(ApduExchange& exchange, CardTransport& card, SessionArena& arena,
+                    uint8_t sfi, uint8_t record);
+bool endAppRecord(ApduExchange& exchange, SessionArena& arena);
+
+// Problems found building the data for a PDOL
+struct DolCheck {
+  DolCheck() : unknown_tags(0), length_mismatches(0) {}
+  uint8_t unknown_tags;         // Requested tags with no terminal value, zero filled
+  uint8_t length_mismatches;    // Values truncated or padded to the requested length
+};
+
+// Build the data for the PDOL in pdol_node (NULL is OK) into data_options.
+// patches, if not NULL, gets the position of each per transaction value.
+// Problems are printed, or counted in check instead if it is not NULL.
+bool buildDataOptionsList(TLVNode* pdol_node, WriteBuffer& data_options,
+                          GpoPatchList* patches, DolCheck* check = NULL);
+
+// Find a tag in the last response decoded by a step. NULL if not present.
+TLVNode* findResponseTLV(SessionArena& arena, uint16_t tag);
+
+#endif /* __EMV_READER_H__ */
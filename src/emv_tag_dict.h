@@ -0,0 +1,750 @@
+#ifndef __EMV_TAG_DICT_H__
+#define __EMV_TAG_DICT_H__
+#include <stdint.h>
+
+//
+// EMV tag name dictionary
+//
+// Generated by host/tools/tag_dict_gen from host/tools/emv_tags.txt.
+// Do not edit, change the list and regenerate.
+//
+// 194 entries, 193 names. 5846 bytes of names as strings, 2701 bytes
+// encoded with 128 pairs; 4121 bytes in all.
+//
+// A name byte below 0x80 is a character. A byte from 0x80 up stands
+// for the two bytes in tag_dict_pairs[byte - 0x80], either of which may
+// stand for a pair again, down to TAG_DICT_DEPTH levels.
+//
+
+#define TAG_DICT_NAME_MAX 70   // Longest name, with the terminator
+#define TAG_DICT_FIRST_CODE 0x80
+#define TAG_DICT_DEPTH 7
+
+struct TagDictEntry {
+  uint16_t tag;
+  uint8_t min_length;   // Value lengths the name is for
+  uint8_t max_length;
+  uint16_t name;        // Offset in tag_dict_text
+};
+
+static constexpr uint8_t tag_dict_pairs[][2] = {
+  { 0x61, 0x74 },  // 80 "at"
+  { 0x65, 0x72 },  // 81 "er"
+  { 0x6F, 0x6E },  // 82 "on"
+  { 0x69, 0x82 },  // 83 "ion"
+  { 0x83, 0x20 },  // 84 "ion "
+  { 0x69, 0x63 },  // 85 "ic"
+  { 0x6E, 0x74 },  // 86 "nt"
+  { 0x65, 0x20 },  // 87 "e "
+  { 0x20, 0x28 },  // 88 " ("
+  { 0x85, 0x80 },  // 89 "icat"
+  { 0x63, 0x74 },  // 8A "ct"
+  { 0x20, 0x43 },  // 8B " C"
+  { 0x70, 0x6C },  // 8C "pl"
+  { 0x89, 0x84 },  // 8D "ication "
+  { 0x72, 0x61 },  // 8E "ra"
+  { 0x6F, 0x72 },  // 8F "or"
+  { 0x44, 0x80 },  // 90 "Dat"
+  { 0x54, 0x8E },  // 91 "Tra"
+  { 0x90, 0x61 },  // 92 "Data"
+  { 0x65, 0x86 },  // 93 "ent"
+  { 0x20, 0x49 },  // 94 " I"
+  { 0x41, 0x70 },  // 95 "Ap"
+  { 0x61, 0x6C },  // 96 "al"
+  { 0x61, 0x72 },  // 97 "ar"
+  { 0x65, 0x64 },  // 98 "ed"
+  { 0x95, 0x8C },  // 99 "Appl"
+  { 0x8A, 0x84 },  // 9A "ction "
+  { 0x99, 0x8D },  // 9B "Application "
+  { 0x69, 0x74 },  // 9C "it"
+  { 0x20, 0x92 },  // 9D " Data"
+  { 0x69, 0x6E },  // 9E "in"
+  { 0x73, 0x61 },  // 9F "sa"
+  { 0x81, 0x20 },  // A0 "er "
+  { 0x69, 0x66 },  // A1 "if"
+  { 0x73, 0x75 },  // A2 "su"
+  { 0x65, 0x6E },  // A3 "en"
+  { 0x29, 0x20 },  // A4 ") "
+  { 0x6E, 0x9F },  // A5 "nsa"
+  { 0x6F, 0x75 },  // A6 "ou"
+  { 0x91, 0xA5 },  // A7 "Transa"
+  { 0xA6, 0x86 },  // A8 "ount"
+  { 0xA7, 0x9A },  // A9 "Transaction "
+  { 0x6F, 0x64 },  // AA "od"
+  { 0x72, 0x6F },  // AB "ro"
+  { 0x73, 0xA2 },  // AC "ssu"
+  { 0x75, 0x6D },  // AD "um"
+  { 0x20, 0x45 },  // AE " E"
+  { 0x69, 0x73 },  // AF "is"
+  { 0x49, 0xAC },  // B0 "Issu"
+  { 0x52, 0x65 },  // B1 "Re"
+  { 0x4E, 0xAD },  // B2 "Num"
+  { 0x75, 0x74 },  // B3 "ut"
+  { 0x97, 0x64 },  // B4 "ard"
+  { 0xA3, 0x63 },  // B5 "enc"
+  { 0x65, 0x8A },  // B6 "ect"
+  { 0x81, 0x6D },  // B7 "erm"
+  { 0x65, 0x6D },  // B8 "em"
+  { 0x69, 0x6C },  // B9 "il"
+  { 0x81, 0x88 },  // BA "er ("
+  { 0x62, 0x6C },  // BB "bl"
+  { 0xB2, 0x62 },  // BC "Numb"
+  { 0x94, 0x6E },  // BD " In"
+  { 0x96, 0x20 },  // BE "al "
+  { 0xB0, 0xA0 },  // BF "Issuer "
+  { 0x61, 0x6E },  // C0 "an"
+  { 0x64, 0x93 },  // C1 "dent"
+  { 0x65, 0x6C },  // C2 "el"
+  { 0x69, 0x6D },  // C3 "im"
+  { 0x79, 0x8B },  // C4 "y C"
+  { 0x85, 0x20 },  // C5 "ic "
+  { 0x8F, 0x6D },  // C6 "orm"
+  { 0xAA, 0x65 },  // C7 "ode"
+  { 0xB7, 0x9E },  // C8 "ermin"
+  { 0xC1, 0xA1 },  // C9 "dentif"
+  { 0x20, 0x41 },  // CA " A"
+  { 0x63, 0x6B },  // CB "ck"
+  { 0x87, 0x43 },  // CC "e C"
+  { 0x88, 0x43 },  // CD " (C"
+  { 0x91, 0xCB },  // CE "Track"
+  { 0xAE, 0x6E },  // CF " En"
+  { 0x44, 0x53 },  // D0 "DS"
+  { 0x50, 0xAB },  // D1 "Pro"
+  { 0x54, 0xB8 },  // D2 "Tem"
+  { 0x65, 0x73 },  // D3 "es"
+  { 0x69, 0x72 },  // D4 "ir"
+  { 0x8C, 0x80 },  // D5 "plat"
+  { 0x97, 0x79 },  // D6 "ary"
+  { 0xB3, 0x68 },  // D7 "uth"
+  { 0xC6, 0x80 },  // D8 "ormat"
+  { 0xD2, 0xD5 },  // D9 "Templat"
+  { 0x20, 0x4F },  // DA " O"
+  { 0x49, 0x86 },  // DB "Int"
+  { 0x4B, 0x65 },  // DC "Ke"
+  { 0x4C, 0xC3 },  // DD "Lim"
+  { 0x50, 0x75 },  // DE "Pu"
+  { 0x54, 0xC8 },  // DF "Termin"
+  { 0x69, 0x76 },  // E0 "iv"
+  { 0x70, 0x82 },  // E1 "pon"
+  { 0x70, 0x87 },  // E2 "pe "
+  { 0x94, 0xC9 },  // E3 " Identif"
+  { 0xBB, 0xC5 },  // E4 "blic "
+  { 0xDD, 0x9C },  // E5 "Limit"
+  { 0xDE, 0xE4 },  // E6 "Public "
+  { 0xE6, 0xDC },  // E7 "Public Ke"
+  { 0x4C, 0x29 },  // E8 "L)"
+  { 0x54, 0x43 },  // E9 "TC"
+  { 0x63, 0x72 },  // EA "cr"
+  { 0x65, 0x74 },  // EB "et"
+  { 0x6F, 0xE2 },  // EC "ope "
+  { 0x72, 0x72 },  // ED "rr"
+  { 0x74, 0xB6 },  // EE "tect"
+  { 0x75, 0xED },  // EF "urr"
+  { 0x76, 0xC2 },  // F0 "vel"
+  { 0x98, 0x9D },  // F1 "ed Data"
+  { 0xA9, 0x43 },  // F2 "Transaction C"
+  { 0xCF, 0xF0 },  // F3 " Envel"
+  { 0xE0, 0x87 },  // F4 "ive "
+  { 0xEE, 0xF1 },  // F5 "tected Data"
+  { 0xEF, 0xB5 },  // F6 "urrenc"
+  { 0xF3, 0xEC },  // F7 " Envelope "
+  { 0xF5, 0xF7 },  // F8 "tected Data Envelope "
+  { 0x20, 0x44 },  // F9 " D"
+  { 0x20, 0xB1 },  // FA " Re"
+  { 0x43, 0xB4 },  // FB "Card"
+  { 0x61, 0x6D },  // FC "am"
+  { 0x65, 0x67 },  // FD "eg"
+  { 0x66, 0xD8 },  // FE "format"
+  { 0x70, 0x74 },  // FF "pt"
+};
+
+// Each name is its encoded length, then the encoded bytes
+static constexpr uint8_t tag_dict_text[] = {
+  // 0 "Issuer Identification Number (IIN)"
+  10, 0xB0, 0x81, 0xE3, 0x8D, 0xBC, 0xBA, 0x49, 0x49, 0x4E, 0x29,
+  // 11 "Application Identifier (AID) - card"
+  13, 0x9B, 0x49, 0xC9, 0x69, 0xBA, 0x41, 0x49, 0x44, 0xA4, 0x2D, 0x20, 0x63, 0xB4,
+  // 25 "Application Label"
+  5, 0x9B, 0x4C, 0x61, 0x62, 0xC2,
+  // 31 "Command to perform"
+  14, 0x43, 0x6F, 0x6D, 0x6D, 0xC0, 0x64, 0x20, 0x74, 0x6F, 0x20, 0x70, 0x81, 0x66, 0xC6,
+  // 46 "Track 1 Data"
+  4, 0xCE, 0x20, 0x31, 0x9D,
+  // 51 "Track 2 Equivalent Data"
+  10, 0xCE, 0x20, 0x32, 0xAE, 0x71, 0x75, 0xE0, 0x96, 0x93, 0x9D,
+  // 62 "Application Primary Account Number (PAN)"
+  16, 0x9B, 0x50, 0x72, 0xC3, 0xD6, 0xCA, 0x63, 0x63, 0xA8, 0x20, 0xBC, 0xBA, 0x50, 0x41, 0x4E, 0x29,
+  // 79 "Application Template"
+  3, 0x9B, 0xD9, 0x65,
+  // 83 "File Control Parameters (FCP) Template"
+  22, 0x46, 0xB9, 0xCC, 0x82, 0x74, 0xAB, 0x6C, 0x20, 0x50, 0x61, 0x8E, 0x6D, 0xEB, 0x81, 0x73, 0x88, 0x46, 0x43, 0x50, 0xA4, 0xD9, 0x65,
+  // 106 "File Management Data (FMD) Template"
+  17, 0x46, 0xB9, 0x87, 0x4D, 0xC0, 0x61, 0x67, 0xB8, 0x93, 0x9D, 0x88, 0x46, 0x4D, 0x44, 0xA4, 0xD9, 0x65,
+  // 124 "File Control Information (FCI) Template"
+  17, 0x46, 0xB9, 0xCC, 0x82, 0x74, 0xAB, 0x6C, 0xBD, 0xFE, 0x84, 0x28, 0x46, 0x43, 0x49, 0xA4, 0xD9, 0x65,
+  // 142 "READ RECORD Response Message Template"
+  23, 0x52, 0x45, 0x41, 0x44, 0x20, 0x52, 0x45, 0x43, 0x4F, 0x52, 0x44, 0xFA, 0x73, 0xE1, 0x73, 0x87, 0x4D, 0xD3, 0x9F, 0x67, 0x87, 0xD9, 0x65,
+  // 166 "Issuer Script Template 1"
+  9, 0xBF, 0x53, 0xEA, 0x69, 0xFF, 0x20, 0xD9, 0x87, 0x31,
+  // 176 "Issuer Script Template 2"
+  9, 0xBF, 0x53, 0xEA, 0x69, 0xFF, 0x20, 0xD9, 0x87, 0x32,
+  // 186 "Directory Discretionary Template"
+  14, 0x44, 0xD4, 0xB6, 0x8F, 0x79, 0xF9, 0xAF, 0xEA, 0xEB, 0x83, 0xD6, 0x20, 0xD9, 0x65,
+  // 201 "Response Message Template Format 2"
+  16, 0xB1, 0x73, 0xE1, 0x73, 0x87, 0x4D, 0xD3, 0x9F, 0x67, 0x87, 0xD9, 0x87, 0x46, 0xD8, 0x20, 0x32,
+  // 218 "Response Message Template Format 1"
+  16, 0xB1, 0x73, 0xE1, 0x73, 0x87, 0x4D, 0xD3, 0x9F, 0x67, 0x87, 0xD9, 0x87, 0x46, 0xD8, 0x20, 0x31,
+  // 235 "Amount, Authorised (Binary)"
+  14, 0x41, 0x6D, 0xA8, 0x2C, 0xCA, 0xD7, 0x8F, 0xAF, 0x98, 0x88, 0x42, 0x9E, 0xD6, 0x29,
+  // 250 "Application Interchange Profile"
+  12, 0x9B, 0xDB, 0x81, 0x63, 0x68, 0xC0, 0x67, 0x87, 0xD1, 0x66, 0xB9, 0x65,
+  // 263 "Command Template"
+  9, 0x43, 0x6F, 0x6D, 0x6D, 0xC0, 0x64, 0x20, 0xD9, 0x65,
+  // 273 "Dedicated file (DF) Name"
+  15, 0x44, 0x98, 0x89, 0x98, 0x20, 0x66, 0xB9, 0x87, 0x28, 0x44, 0x46, 0xA4, 0x4E, 0xFC, 0x65,
+  // 289 "Issuer Script Command"
+  11, 0xBF, 0x53, 0xEA, 0x69, 0xFF, 0x8B, 0x6F, 0x6D, 0x6D, 0xC0, 0x64,
+  // 301 "Application Priority Indicator"
+  11, 0x9B, 0x50, 0x72, 0x69, 0x8F, 0x9C, 0x79, 0xBD, 0x64, 0x89, 0x8F,
+  // 313 "Short File Identifier (SFI)"
+  16, 0x53, 0x68, 0x8F, 0x74, 0x20, 0x46, 0xB9, 0x87, 0x49, 0xC9, 0x69, 0xBA, 0x53, 0x46, 0x49, 0x29,
+  // 330 "Authorisation Code"
+  8, 0x41, 0xD7, 0x8F, 0xAF, 0x80, 0x84, 0x43, 0xC7,
+  // 339 "Authorisation Response Code"
+  12, 0x41, 0xD7, 0x8F, 0xAF, 0x80, 0x84, 0xB1, 0x73, 0xE1, 0x73, 0xCC, 0xC7,
+  // 352 "Card Risk Management Data object List 1 (CDOL1)"
+  30, 0xFB, 0x20, 0x52, 0xAF, 0x6B, 0x20, 0x4D, 0xC0, 0x61, 0x67, 0xB8, 0x93, 0x9D, 0x20, 0x6F, 0x62, 0x6A, 0xB6, 0x20, 0x4C, 0xAF, 0x74, 0x20, 0x31, 0xCD, 0x44, 0x4F, 0x4C, 0x31, 0x29,
+  // 383 "Card Risk Management Data object List 2 (CDOL2)"
+  30, 0xFB, 0x20, 0x52, 0xAF, 0x6B, 0x20, 0x4D, 0xC0, 0x61, 0x67, 0xB8, 0x93, 0x9D, 0x20, 0x6F, 0x62, 0x6A, 0xB6, 0x20, 0x4C, 0xAF, 0x74, 0x20, 0x32, 0xCD, 0x44, 0x4F, 0x4C, 0x32, 0x29,
+  // 414 "Cardholder Verification Method (CVM) List"
+  21, 0xFB, 0x68, 0x6F, 0x6C, 0x64, 0xA0, 0x56, 0x81, 0xA1, 0x8D, 0x4D, 0xEB, 0x68, 0xAA, 0xCD, 0x56, 0x4D, 0xA4, 0x4C, 0xAF, 0x74,
+  // 436 "Certification Authority Public Key Index (PKI)"
+  22, 0x43, 0x81, 0x74, 0xA1, 0x8D, 0x41, 0xD7, 0x8F, 0x9C, 0x79, 0x20, 0xE7, 0x79, 0xBD, 0x64, 0x65, 0x78, 0x88, 0x50, 0x4B, 0x49, 0x29,
+  // 459 "Issuer Public Key Certificate"
+  8, 0xBF, 0xE7, 0xC4, 0x81, 0x74, 0xA1, 0x89, 0x65,
+  // 468 "Issuer Authentication Data"
+  6, 0xBF, 0x41, 0xD7, 0x93, 0x8D, 0x92,
+  // 475 "Issuer Public Key Remainder"
+  9, 0xBF, 0xE7, 0x79, 0xFA, 0x6D, 0x61, 0x9E, 0x64, 0x81,
+  // 485 "Signed Static Application Data"
+  12, 0x53, 0x69, 0x67, 0x6E, 0x98, 0x20, 0x53, 0x74, 0x80, 0xC5, 0x9B, 0x92,
+  // 498 "Application File Locator (AFL)"
+  13, 0x9B, 0x46, 0xB9, 0x87, 0x4C, 0x6F, 0x63, 0x80, 0x8F, 0x88, 0x41, 0x46, 0xE8,
+  // 512 "Terminal Verification Results"
+  11, 0xDF, 0xBE, 0x56, 0x81, 0xA1, 0x8D, 0xB1, 0xA2, 0x6C, 0x74, 0x73,
+  // 524 "Transaction Certificate Data Object List (TDOL)"
+  20, 0xF2, 0x81, 0x74, 0xA1, 0x89, 0x87, 0x92, 0xDA, 0x62, 0x6A, 0xB6, 0x20, 0x4C, 0xAF, 0x74, 0x88, 0x54, 0x44, 0x4F, 0xE8,
+  // 545 "Transaction Certificate (TC) Hash Value"
+  18, 0xF2, 0x81, 0x74, 0xA1, 0x89, 0x87, 0x28, 0xE9, 0xA4, 0x48, 0x61, 0x73, 0x68, 0x20, 0x56, 0x96, 0x75, 0x65,
+  // 564 "Transaction Personal Identification Number (PIN) Data"
+  15, 0xA9, 0x50, 0x81, 0x73, 0x82, 0x96, 0xE3, 0x8D, 0xBC, 0xBA, 0x50, 0x49, 0x4E, 0x29, 0x9D,
+  // 580 "Transaction Date"
+  3, 0xA9, 0x90, 0x65,
+  // 584 "Transaction Status Information"
+  9, 0xA9, 0x53, 0x74, 0x80, 0x75, 0x73, 0xBD, 0xFE, 0x83,
+  // 594 "Transaction Type"
+  5, 0xA9, 0x54, 0x79, 0x70, 0x65,
+  // 600 "Directory Definition File (DDF) Name"
+  22, 0x44, 0xD4, 0xB6, 0x8F, 0x79, 0xF9, 0x65, 0x66, 0x9E, 0x9C, 0x84, 0x46, 0xB9, 0x87, 0x28, 0x44, 0x44, 0x46, 0xA4, 0x4E, 0xFC, 0x65,
+  // 623 "File Control Information (FCI) Proprietary Template"
+  24, 0x46, 0xB9, 0xCC, 0x82, 0x74, 0xAB, 0x6C, 0xBD, 0xFE, 0x84, 0x28, 0x46, 0x43, 0x49, 0xA4, 0xD1, 0x70, 0x72, 0x69, 0xEB, 0xD6, 0x20, 0xD9, 0x65,
+  // 648 "Cardholder Name"
+  9, 0xFB, 0x68, 0x6F, 0x6C, 0x64, 0xA0, 0x4E, 0xFC, 0x65,
+  // 658 "Application Expiration Date"
+  9, 0x9B, 0x45, 0x78, 0x70, 0xD4, 0x80, 0x84, 0x90, 0x65,
+  // 668 "Application Effective Date"
+  8, 0x9B, 0x45, 0x66, 0x66, 0xB6, 0xF4, 0x90, 0x65,
+  // 677 "Issuer Country Code"
+  7, 0xB0, 0x81, 0x8B, 0xA8, 0x72, 0xC4, 0xC7,
+  // 685 "Transaction Currency Code"
+  4, 0xF2, 0xF6, 0xC4, 0xC7,
+  // 690 "Language Preference"
+  14, 0x4C, 0xC0, 0x67, 0x75, 0x61, 0x67, 0x87, 0x50, 0x72, 0x65, 0x66, 0x81, 0xB5, 0x65,
+  // 705 "Service Code"
+  6, 0x53, 0x81, 0x76, 0x85, 0xCC, 0xC7,
+  // 712 "Application Primary Account Number (PAN) Sequence Number"
+  24, 0x9B, 0x50, 0x72, 0xC3, 0xD6, 0xCA, 0x63, 0x63, 0xA8, 0x20, 0xBC, 0xBA, 0x50, 0x41, 0x4E, 0xA4, 0x53, 0x65, 0x71, 0x75, 0xB5, 0x87, 0xBC, 0x81,
+  // 737 "Transaction Currency Exponent"
+  7, 0xF2, 0xF6, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 745 "Issuer URL"
+  4, 0xBF, 0x55, 0x52, 0x4C,
+  // 750 "International Bank Account Number (IBAN)"
+  21, 0xDB, 0x81, 0x6E, 0x80, 0x83, 0xBE, 0x42, 0xC0, 0x6B, 0xCA, 0x63, 0x63, 0xA8, 0x20, 0xBC, 0xBA, 0x49, 0x42, 0x41, 0x4E, 0x29,
+  // 772 "Bank Identifier Code (BIC)"
+  14, 0x42, 0xC0, 0x6B, 0xE3, 0x69, 0x81, 0x8B, 0xAA, 0x87, 0x28, 0x42, 0x49, 0x43, 0x29,
+  // 787 "Issuer Country Code (alpha2 format)"
+  17, 0xB0, 0x81, 0x8B, 0xA8, 0x72, 0xC4, 0xAA, 0x87, 0x28, 0x96, 0x70, 0x68, 0x61, 0x32, 0x20, 0xFE, 0x29,
+  // 805 "Issuer Country Code (alpha3 format)"
+  17, 0xB0, 0x81, 0x8B, 0xA8, 0x72, 0xC4, 0xAA, 0x87, 0x28, 0x96, 0x70, 0x68, 0x61, 0x33, 0x20, 0xFE, 0x29,
+  // 823 "Account Type"
+  9, 0x41, 0x63, 0x63, 0xA8, 0x20, 0x54, 0x79, 0x70, 0x65,
+  // 833 "Acquirer Identifier"
+  9, 0x41, 0x63, 0x71, 0x75, 0xD4, 0x81, 0xE3, 0x69, 0x81,
+  // 843 "Amount, Authorised (Numeric)"
+  14, 0x41, 0x6D, 0xA8, 0x2C, 0xCA, 0xD7, 0x8F, 0xAF, 0x98, 0x88, 0xB2, 0x81, 0x85, 0x29,
+  // 858 "Amount, Other (Numeric)"
+  12, 0x41, 0x6D, 0xA8, 0x2C, 0xDA, 0x74, 0x68, 0xBA, 0xB2, 0x81, 0x85, 0x29,
+  // 871 "Amount, Other (Binary)"
+  12, 0x41, 0x6D, 0xA8, 0x2C, 0xDA, 0x74, 0x68, 0xBA, 0x42, 0x9E, 0xD6, 0x29,
+  // 884 "Application Discretionary Data"
+  8, 0x9B, 0x44, 0xAF, 0xEA, 0xEB, 0x83, 0xD6, 0x9D,
+  // 893 "Application Identifier (AID) - terminal"
+  14, 0x9B, 0x49, 0xC9, 0x69, 0xBA, 0x41, 0x49, 0x44, 0xA4, 0x2D, 0x20, 0x74, 0xC8, 0x96,
+  // 908 "Application Usage Control"
+  9, 0x9B, 0x55, 0x9F, 0x67, 0xCC, 0x82, 0x74, 0xAB, 0x6C,
+  // 918 "Application Version Number"
+  7, 0x9B, 0x56, 0x81, 0x73, 0x84, 0xBC, 0x81,
+  // 926 "Application Version Number (terminal)"
+  11, 0x9B, 0x56, 0x81, 0x73, 0x84, 0xBC, 0xBA, 0x74, 0xC8, 0x96, 0x29,
+  // 938 "Application Selection Registered Proprietary Data (ASRPD)"
+  26, 0x9B, 0x53, 0xC2, 0x65, 0x9A, 0xB1, 0x67, 0xAF, 0x74, 0x81, 0x98, 0x20, 0xD1, 0x70, 0x72, 0x69, 0xEB, 0xD6, 0x9D, 0x88, 0x41, 0x53, 0x52, 0x50, 0x44, 0x29,
+  // 965 "Cardholder Name Extended"
+  15, 0xFB, 0x68, 0x6F, 0x6C, 0x64, 0xA0, 0x4E, 0xFC, 0x87, 0x45, 0x78, 0x74, 0xA3, 0x64, 0x98,
+  // 981 "Issuer Identification Number Extended (IINE)"
+  18, 0xB0, 0x81, 0xE3, 0x8D, 0xBC, 0xA0, 0x45, 0x78, 0x74, 0xA3, 0x64, 0x98, 0x88, 0x49, 0x49, 0x4E, 0x45, 0x29,
+  // 1000 "Issuer Action Code - Default"
+  14, 0xBF, 0x41, 0x9A, 0x43, 0xAA, 0x87, 0x2D, 0xF9, 0x65, 0x66, 0x61, 0x75, 0x6C, 0x74,
+  // 1015 "Issuer Action Code - Denial"
+  11, 0xBF, 0x41, 0x9A, 0x43, 0xAA, 0x87, 0x2D, 0xF9, 0xA3, 0x69, 0x96,
+  // 1027 "Issuer Action Code - Online"
+  12, 0xBF, 0x41, 0x9A, 0x43, 0xAA, 0x87, 0x2D, 0xDA, 0x6E, 0x6C, 0x9E, 0x65,
+  // 1040 "Issuer Application Data"
+  3, 0xBF, 0x9B, 0x92,
+  // 1044 "Issuer Code Table Index"
+  14, 0xB0, 0x81, 0x8B, 0xAA, 0x87, 0x54, 0x61, 0xBB, 0x87, 0x49, 0x6E, 0x64, 0x65, 0x78,
+  // 1059 "Application Preferred Name"
+  12, 0x9B, 0x50, 0x72, 0x65, 0x66, 0x81, 0x72, 0x98, 0x20, 0x4E, 0xFC, 0x65,
+  // 1072 "Last Online Application Transaction Counter (ATC) Register"
+  21, 0x4C, 0x61, 0x73, 0x74, 0xDA, 0x6E, 0x6C, 0x9E, 0x87, 0x9B, 0xF2, 0xA8, 0xBA, 0x41, 0xE9, 0xA4, 0xB1, 0x67, 0xAF, 0x74, 0x81,
+  // 1094 "Lower Consecutive Offline Limit"
+  18, 0x4C, 0x6F, 0x77, 0x81, 0x8B, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0x4F, 0x66, 0x66, 0x6C, 0x9E, 0x87, 0xE5,
+  // 1113 "Merchant Category Code"
+  12, 0x4D, 0x81, 0x63, 0x68, 0x61, 0x86, 0x8B, 0x80, 0xFD, 0x8F, 0xC4, 0xC7,
+  // 1126 "Merchant Identifier"
+  9, 0x4D, 0x81, 0x63, 0x68, 0x61, 0x86, 0xE3, 0x69, 0x81,
+  // 1136 "Personal Identification Number (PIN) Try Counter"
+  18, 0x50, 0x81, 0x73, 0x82, 0x96, 0xE3, 0x8D, 0xBC, 0xBA, 0x50, 0x49, 0x4E, 0xA4, 0x54, 0x72, 0xC4, 0xA8, 0x81,
+  // 1155 "Issuer Script Identifier"
+  8, 0xBF, 0x53, 0xEA, 0x69, 0xFF, 0xE3, 0x69, 0x81,
+  // 1164 "Token Requestor ID"
+  12, 0x54, 0x6F, 0x6B, 0xA3, 0xFA, 0x71, 0x75, 0xD3, 0x74, 0x8F, 0x94, 0x44,
+  // 1177 "Terminal Country Code"
+  7, 0xDF, 0x96, 0x8B, 0xA8, 0x72, 0xC4, 0xC7,
+  // 1185 "Terminal Floor Limit"
+  8, 0xDF, 0xBE, 0x46, 0x6C, 0x6F, 0x8F, 0x20, 0xE5,
+  // 1194 "Terminal Identification"
+  5, 0xDF, 0x96, 0xE3, 0x89, 0x83,
+  // 1200 "Terminal Risk Management Data"
+  13, 0xDF, 0xBE, 0x52, 0xAF, 0x6B, 0x20, 0x4D, 0xC0, 0x61, 0x67, 0xB8, 0x93, 0x9D,
+  // 1214 "Interface Device (IFD) Serial Number"
+  22, 0xDB, 0x81, 0x66, 0x61, 0x63, 0x87, 0x44, 0x65, 0x76, 0x85, 0x87, 0x28, 0x49, 0x46, 0x44, 0xA4, 0x53, 0x81, 0x69, 0xBE, 0xBC, 0x81,
+  // 1237 "Track 1 Discretionary Data"
+  10, 0xCE, 0x20, 0x31, 0xF9, 0xAF, 0xEA, 0xEB, 0x83, 0xD6, 0x9D,
+  // 1248 "Track 2 Discretionary Data"
+  10, 0xCE, 0x20, 0x32, 0xF9, 0xAF, 0xEA, 0xEB, 0x83, 0xD6, 0x9D,
+  // 1259 "Transaction Time"
+  4, 0xA9, 0x54, 0xC3, 0x65,
+  // 1264 "Certification Authority Public Key Index (PKI) - terminal"
+  27, 0x43, 0x81, 0x74, 0xA1, 0x8D, 0x41, 0xD7, 0x8F, 0x9C, 0x79, 0x20, 0xE7, 0x79, 0xBD, 0x64, 0x65, 0x78, 0x88, 0x50, 0x4B, 0x49, 0xA4, 0x2D, 0x20, 0x74, 0xC8, 0x96,
+  // 1292 "Upper Consecutive Offline Limit"
+  18, 0x55, 0x70, 0x70, 0x81, 0x8B, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0x4F, 0x66, 0x66, 0x6C, 0x9E, 0x87, 0xE5,
+  // 1311 "Payment Account Reference (PAR)"
+  19, 0x50, 0x61, 0x79, 0x6D, 0x93, 0xCA, 0x63, 0x63, 0xA8, 0xFA, 0x66, 0x81, 0xB5, 0x87, 0x28, 0x50, 0x41, 0x52, 0x29,
+  // 1331 "Last 4 Digits of PAN"
+  18, 0x4C, 0x61, 0x73, 0x74, 0x20, 0x34, 0xF9, 0x69, 0x67, 0x9C, 0x73, 0x20, 0x6F, 0x66, 0x20, 0x50, 0x41, 0x4E,
+  // 1350 "Application Cryptogram"
+  9, 0x9B, 0x43, 0x72, 0x79, 0xFF, 0x6F, 0x67, 0x8E, 0x6D,
+  // 1360 "Cryptogram Information Data"
+  12, 0x43, 0x72, 0x79, 0xFF, 0x6F, 0x67, 0x8E, 0x6D, 0xBD, 0xFE, 0x84, 0x92,
+  // 1373 "Extended Selection"
+  11, 0x45, 0x78, 0x74, 0xA3, 0x64, 0x98, 0x20, 0x53, 0xC2, 0xB6, 0x83,
+  // 1385 "Kernel Identifier"
+  7, 0x4B, 0x81, 0x6E, 0xC2, 0xE3, 0x69, 0x81,
+  // 1393 "Integrated Circuit Card (ICC) PIN Encipherment Public Key Certificate"
+  35, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0x50, 0x49, 0x4E, 0xCF, 0x63, 0x69, 0x70, 0x68, 0xB7, 0x93, 0x20, 0xE7, 0xC4, 0x81, 0x74, 0xA1, 0x89, 0x65,
+  // 1429 "Integrated Circuit Card (ICC) PIN Encipherment Public Key Exponent"
+  34, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0x50, 0x49, 0x4E, 0xCF, 0x63, 0x69, 0x70, 0x68, 0xB7, 0x93, 0x20, 0xE7, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 1464 "Integrated Circuit Card (ICC) PIN Encipherment Public Key Remainder"
+  36, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0x50, 0x49, 0x4E, 0xCF, 0x63, 0x69, 0x70, 0x68, 0xB7, 0x93, 0x20, 0xE7, 0x79, 0xFA, 0x6D, 0x61, 0x9E, 0x64, 0x81,
+  // 1501 "Issuer Public Key Exponent"
+  7, 0xBF, 0xE7, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 1509 "Terminal Capabilities"
+  11, 0xDF, 0x96, 0x8B, 0x61, 0x70, 0x61, 0x62, 0xB9, 0x9C, 0x69, 0xD3,
+  // 1521 "Cardholder Verification Method (CVM) Results"
+  23, 0xFB, 0x68, 0x6F, 0x6C, 0x64, 0xA0, 0x56, 0x81, 0xA1, 0x8D, 0x4D, 0xEB, 0x68, 0xAA, 0xCD, 0x56, 0x4D, 0xA4, 0xB1, 0xA2, 0x6C, 0x74, 0x73,
+  // 1545 "Terminal type"
+  6, 0xDF, 0xBE, 0x74, 0x79, 0x70, 0x65,
+  // 1552 "Application Transaction Counter (ATC)"
+  7, 0x9B, 0xF2, 0xA8, 0xBA, 0x41, 0xE9, 0x29,
+  // 1560 "Unpredictable Number"
+  12, 0x55, 0x6E, 0x70, 0x72, 0x98, 0x85, 0x74, 0x61, 0xBB, 0x87, 0xBC, 0x81,
+  // 1573 "Processing Options Data Option List (PDOL)"
+  22, 0xD1, 0x63, 0xD3, 0x73, 0x9E, 0x67, 0xDA, 0xFF, 0x83, 0x73, 0x9D, 0xDA, 0xFF, 0x84, 0x4C, 0xAF, 0x74, 0x88, 0x50, 0x44, 0x4F, 0xE8,
+  // 1596 "Point-of-Service (POS) Entry Mode"
+  25, 0x50, 0x6F, 0x69, 0x86, 0x2D, 0x6F, 0x66, 0x2D, 0x53, 0x81, 0x76, 0x85, 0x87, 0x28, 0x50, 0x4F, 0x53, 0xA4, 0x45, 0x86, 0x72, 0x79, 0x20, 0x4D, 0xC7,
+  // 1622 "Amount, Reference Currency"
+  11, 0x41, 0x6D, 0xA8, 0x2C, 0xFA, 0x66, 0x81, 0xB5, 0xCC, 0xF6, 0x79,
+  // 1634 "Application Reference Currency"
+  8, 0x9B, 0xB1, 0x66, 0x81, 0xB5, 0xCC, 0xF6, 0x79,
+  // 1643 "Transaction Reference Currency Code"
+  9, 0xA9, 0xB1, 0x66, 0x81, 0xB5, 0xCC, 0xF6, 0xC4, 0xC7,
+  // 1653 "Transaction Reference Currency Exponent"
+  12, 0xA9, 0xB1, 0x66, 0x81, 0xB5, 0xCC, 0xF6, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 1666 "Additional Terminal Capabilities"
+  17, 0x41, 0x64, 0x64, 0x9C, 0x83, 0xBE, 0xDF, 0x96, 0x8B, 0x61, 0x70, 0x61, 0x62, 0xB9, 0x9C, 0x69, 0xD3,
+  // 1684 "Transaction Sequence Counter"
+  9, 0xA9, 0x53, 0x65, 0x71, 0x75, 0xB5, 0xCC, 0xA8, 0x81,
+  // 1694 "Currency Code, Application"
+  9, 0x43, 0xF6, 0xC4, 0xC7, 0x2C, 0x20, 0x99, 0x89, 0x83,
+  // 1704 "Application Reference Currency Exponent"
+  12, 0x9B, 0xB1, 0x66, 0x81, 0xB5, 0xCC, 0xF6, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 1717 "Currency Exponent, Application"
+  12, 0x43, 0xF6, 0x79, 0xAE, 0x78, 0xE1, 0x93, 0x2C, 0x20, 0x99, 0x89, 0x83,
+  // 1730 "Data Authentication Code"
+  7, 0x92, 0xCA, 0xD7, 0x93, 0x8D, 0x43, 0xC7,
+  // 1738 "Integrated Circuit Card (ICC) Public Key Certificate"
+  24, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0xE7, 0xC4, 0x81, 0x74, 0xA1, 0x89, 0x65,
+  // 1763 "Integrated Circuit Card (ICC) Public Key Exponent"
+  23, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0xE7, 0x79, 0xAE, 0x78, 0xE1, 0x93,
+  // 1787 "Integrated Circuit Card (ICC) Public Key Remainder"
+  25, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0xE7, 0x79, 0xFA, 0x6D, 0x61, 0x9E, 0x64, 0x81,
+  // 1813 "Dynamic Data Authentication Data Object List (DDOL)"
+  24, 0x44, 0x79, 0x6E, 0xFC, 0x85, 0x9D, 0xCA, 0xD7, 0x93, 0x8D, 0x92, 0xDA, 0x62, 0x6A, 0xB6, 0x20, 0x4C, 0xAF, 0x74, 0x88, 0x44, 0x44, 0x4F, 0xE8,
+  // 1838 "Static Data Authentication Tag List"
+  16, 0x53, 0x74, 0x80, 0x85, 0x9D, 0xCA, 0xD7, 0x93, 0x8D, 0x54, 0x61, 0x67, 0x20, 0x4C, 0xAF, 0x74,
+  // 1855 "Signed Dynamic Application Data"
+  12, 0x53, 0x69, 0x67, 0x6E, 0x98, 0xF9, 0x79, 0x6E, 0xFC, 0xC5, 0x9B, 0x92,
+  // 1868 "Integrated Circuit Card (ICC) Dynamic Number"
+  24, 0xDB, 0xFD, 0x72, 0x80, 0x98, 0x8B, 0xD4, 0x63, 0x75, 0x9C, 0x8B, 0xB4, 0x88, 0x49, 0x43, 0x43, 0xA4, 0x44, 0x79, 0x6E, 0xFC, 0xC5, 0xBC, 0x81,
+  // 1893 "Log Entry"
+  7, 0x4C, 0x6F, 0x67, 0xAE, 0x86, 0x72, 0x79,
+  // 1901 "Merchant Name and Location"
+  18, 0x4D, 0x81, 0x63, 0x68, 0x61, 0x86, 0x20, 0x4E, 0xFC, 0x87, 0xC0, 0x64, 0x20, 0x4C, 0x6F, 0x63, 0x80, 0x83,
+  // 1920 "Log Format"
+  6, 0x4C, 0x6F, 0x67, 0x20, 0x46, 0xD8,
+  // 1927 "Offline Accumulator Balance"
+  20, 0x4F, 0x66, 0x66, 0x6C, 0x9E, 0x87, 0x41, 0x63, 0x63, 0xAD, 0x75, 0x6C, 0x80, 0x8F, 0x20, 0x42, 0x96, 0xC0, 0x63, 0x65,
+  // 1948 "Application Currency Code"
+  5, 0x9B, 0x43, 0xF6, 0xC4, 0xC7,
+  // 1954 "Application Default Action (ADA)"
+  15, 0x9B, 0x44, 0x65, 0x66, 0x61, 0x75, 0x6C, 0x74, 0xCA, 0x9A, 0x28, 0x41, 0x44, 0x41, 0x29,
+  // 1970 "Transaction Category Code"
+  6, 0xF2, 0x80, 0xFD, 0x8F, 0xC4, 0xC7,
+  // 1977 "Consecutive Transaction Counter International Limit (CTCIL)"
+  22, 0x43, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0xF2, 0xA8, 0x81, 0x94, 0x86, 0x81, 0x6E, 0x80, 0x83, 0xBE, 0xE5, 0xCD, 0xE9, 0x49, 0xE8,
+  // 2000 "Cumulative Total Transaction Amount Limit (CTTAL)"
+  21, 0x43, 0xAD, 0x75, 0x6C, 0x80, 0xF4, 0x54, 0x6F, 0x74, 0xBE, 0xA9, 0x41, 0x6D, 0xA8, 0x20, 0xE5, 0xCD, 0x54, 0x54, 0x41, 0xE8,
+  // 2022 "Geographic Indicator"
+  12, 0x47, 0x65, 0x6F, 0x67, 0x8E, 0x70, 0x68, 0x85, 0xBD, 0x64, 0x89, 0x8F,
+  // 2035 "Issuer Authentication Indicator"
+  10, 0xBF, 0x41, 0xD7, 0x93, 0x8D, 0x49, 0x6E, 0x64, 0x89, 0x8F,
+  // 2046 "Consecutive Transaction Counter Limit (CTCL)"
+  14, 0x43, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0xF2, 0xA8, 0xA0, 0xE5, 0xCD, 0xE9, 0xE8,
+  // 2061 "Consecutive Transaction Counter Upper Limit (CTCUL)"
+  19, 0x43, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0xF2, 0xA8, 0xA0, 0x55, 0x70, 0x70, 0xA0, 0xE5, 0xCD, 0xE9, 0x55, 0xE8,
+  // 2081 "Application Program Identifier (Program ID)"
+  15, 0x9B, 0xD1, 0x67, 0x8E, 0x6D, 0xE3, 0x69, 0xBA, 0xD1, 0x67, 0x8E, 0x6D, 0x94, 0x44, 0x29,
+  // 2097 "Issuer Script Results"
+  10, 0xBF, 0x53, 0xEA, 0x69, 0xFF, 0xFA, 0xA2, 0x6C, 0x74, 0x73,
+  // 2108 "DS Requested Operator ID"
+  14, 0xD0, 0xFA, 0x71, 0x75, 0xD3, 0x74, 0x98, 0xDA, 0x70, 0x81, 0x80, 0x8F, 0x94, 0x44,
+  // 2123 "Cumulative Total Transaction Amount Upper Limit (CTTAUL)"
+  26, 0x43, 0xAD, 0x75, 0x6C, 0x80, 0xF4, 0x54, 0x6F, 0x74, 0xBE, 0xA9, 0x41, 0x6D, 0xA8, 0x20, 0x55, 0x70, 0x70, 0xA0, 0xE5, 0xCD, 0x54, 0x54, 0x41, 0x55, 0xE8,
+  // 2150 "Application Capabilities Information"
+  13, 0x9B, 0x43, 0x61, 0x70, 0x61, 0x62, 0xB9, 0x9C, 0x69, 0xD3, 0xBD, 0xFE, 0x83,
+  // 2164 "Available Offline Spending Amount (AOSA)"
+  28, 0x41, 0x76, 0x61, 0xB9, 0x61, 0xBB, 0x87, 0x4F, 0x66, 0x66, 0x6C, 0x9E, 0x87, 0x53, 0x70, 0xA3, 0x64, 0x9E, 0x67, 0xCA, 0x6D, 0xA8, 0x88, 0x41, 0x4F, 0x53, 0x41, 0x29,
+  // 2193 "DS ID"
+  3, 0xD0, 0x94, 0x44,
+  // 2197 "Consecutive Transaction International Upper Limit (CTIUL)"
+  24, 0x43, 0x82, 0x73, 0x65, 0x63, 0xB3, 0xF4, 0xA9, 0xDB, 0x81, 0x6E, 0x80, 0x83, 0xBE, 0x55, 0x70, 0x70, 0xA0, 0xE5, 0xCD, 0x54, 0x49, 0x55, 0xE8,
+  // 2222 "DS Slot Availability"
+  15, 0xD0, 0x20, 0x53, 0x6C, 0x6F, 0x74, 0xCA, 0x76, 0x61, 0xB9, 0x61, 0x62, 0xB9, 0x9C, 0x79,
+  // 2238 "CVC3 (Track1)"
+  8, 0x43, 0x56, 0x43, 0x33, 0x88, 0xCE, 0x31, 0x29,
+  // 2247 "CVC3 (Track2)"
+  8, 0x43, 0x56, 0x43, 0x33, 0x88, 0xCE, 0x32, 0x29,
+  // 2256 "PCVC3 (Track1)"
+  9, 0x50, 0x43, 0x56, 0x43, 0x33, 0x88, 0xCE, 0x31, 0x29,
+  // 2266 "PUNATC (Track1)"
+  9, 0x50, 0x55, 0x4E, 0x41, 0xE9, 0x88, 0xCE, 0x31, 0x29,
+  // 2276 "NATC (Track1)"
+  7, 0x4E, 0x41, 0xE9, 0x88, 0xCE, 0x31, 0x29,
+  // 2284 "PCVC3 (Track2)"
+  9, 0x50, 0x43, 0x56, 0x43, 0x33, 0x88, 0xCE, 0x32, 0x29,
+  // 2294 "PUNATC (Track2)"
+  9, 0x50, 0x55, 0x4E, 0x41, 0xE9, 0x88, 0xCE, 0x32, 0x29,
+  // 2304 "Terminal Transaction Qualifiers"
+  10, 0xDF, 0xBE, 0xA9, 0x51, 0x75, 0x96, 0xA1, 0x69, 0x81, 0x73,
+  // 2315 "NATC (Track2)"
+  7, 0x4E, 0x41, 0xE9, 0x88, 0xCE, 0x32, 0x29,
+  // 2323 "Card Additional Processes"
+  12, 0xFB, 0xCA, 0x64, 0x64, 0x9C, 0x83, 0xBE, 0xD1, 0x63, 0xD3, 0x73, 0xD3,
+  // 2336 "UDOL"
+  4, 0x55, 0x44, 0x4F, 0x4C,
+  // 2341 "Unpredictable Number (Numeric)"
+  16, 0x55, 0x6E, 0x70, 0x72, 0x98, 0x85, 0x74, 0x61, 0xBB, 0x87, 0xBC, 0xBA, 0xB2, 0x81, 0x85, 0x29,
+  // 2358 "Track 2 Data"
+  4, 0xCE, 0x20, 0x32, 0x9D,
+  // 2363 "Card CVM Limit"
+  6, 0xFB, 0x8B, 0x56, 0x4D, 0x20, 0xE5,
+  // 2370 "Card Transaction Qualifiers (CTQ)"
+  14, 0xFB, 0x20, 0xA9, 0x51, 0x75, 0x96, 0xA1, 0x69, 0x81, 0x73, 0xCD, 0x54, 0x51, 0x29,
+  // 2385 "Mag-stripe Application Version Number (Reader)"
+  21, 0x4D, 0x61, 0x67, 0x2D, 0x73, 0x74, 0x72, 0x69, 0xE2, 0x9B, 0x56, 0x81, 0x73, 0x84, 0xBC, 0xBA, 0xB1, 0x61, 0x64, 0x81, 0x29,
+  // 2407 "Form Factor Indicator (FFI)"
+  16, 0x46, 0xC6, 0x20, 0x46, 0x61, 0x8A, 0x8F, 0xBD, 0x64, 0x89, 0x8F, 0x88, 0x46, 0x46, 0x49, 0x29,
+  // 2424 "Third Party Data"
+  10, 0x54, 0x68, 0xD4, 0x64, 0x20, 0x50, 0x97, 0x74, 0x79, 0x9D,
+  // 2435 "DS Slot Management Control"
+  18, 0xD0, 0x20, 0x53, 0x6C, 0x6F, 0x74, 0x20, 0x4D, 0xC0, 0x61, 0x67, 0xB8, 0x93, 0x8B, 0x82, 0x74, 0xAB, 0x6C,
+  // 2454 "Protected Data Envelope 1"
+  3, 0xD1, 0xF8, 0x31,
+  // 2458 "Protected Data Envelope 2"
+  3, 0xD1, 0xF8, 0x32,
+  // 2462 "Protected Data Envelope 3"
+  3, 0xD1, 0xF8, 0x33,
+  // 2466 "Protected Data Envelope 4"
+  3, 0xD1, 0xF8, 0x34,
+  // 2470 "VLP Issuer Authorisation Code"
+  14, 0x56, 0x4C, 0x50, 0x94, 0xAC, 0xA0, 0x41, 0xD7, 0x8F, 0xAF, 0x80, 0x84, 0x43, 0xC7,
+  // 2485 "Protected Data Envelope 5"
+  3, 0xD1, 0xF8, 0x35,
+  // 2489 "Unprotected Data Envelope 1"
+  6, 0x55, 0x6E, 0x70, 0xAB, 0xF8, 0x31,
+  // 2496 "Unprotected Data Envelope 2"
+  6, 0x55, 0x6E, 0x70, 0xAB, 0xF8, 0x32,
+  // 2503 "Unprotected Data Envelope 3"
+  6, 0x55, 0x6E, 0x70, 0xAB, 0xF8, 0x33,
+  // 2510 "Unprotected Data Envelope 4"
+  6, 0x55, 0x6E, 0x70, 0xAB, 0xF8, 0x34,
+  // 2517 "Unprotected Data Envelope 5"
+  6, 0x55, 0x6E, 0x70, 0xAB, 0xF8, 0x35,
+  // 2524 "VLP Terminal Support Indicator"
+  16, 0x56, 0x4C, 0x50, 0x20, 0xDF, 0xBE, 0x53, 0x75, 0x70, 0x70, 0x8F, 0x74, 0xBD, 0x64, 0x89, 0x8F,
+  // 2541 "VLP Terminal Transaction Limit"
+  8, 0x56, 0x4C, 0x50, 0x20, 0xDF, 0xBE, 0xA9, 0xE5,
+  // 2550 "Merchant Custom Data"
+  13, 0x4D, 0x81, 0x63, 0x68, 0x61, 0x86, 0x8B, 0x75, 0x73, 0x74, 0x6F, 0x6D, 0x9D,
+  // 2564 "Customer Exclusive Data (CED)"
+  19, 0x43, 0x75, 0x73, 0x74, 0x6F, 0x6D, 0xA0, 0x45, 0x78, 0x63, 0x6C, 0x75, 0x73, 0xF4, 0x92, 0xCD, 0x45, 0x44, 0x29,
+  // 2584 "DS Summary 1"
+  8, 0xD0, 0x20, 0x53, 0xAD, 0x6D, 0xD6, 0x20, 0x31,
+  // 2593 "Mobile Support Indicator"
+  15, 0x4D, 0x6F, 0x62, 0xB9, 0x87, 0x53, 0x75, 0x70, 0x70, 0x8F, 0x74, 0xBD, 0x64, 0x89, 0x8F,
+  // 2609 "DS Unpredictable Number"
+  14, 0xD0, 0x20, 0x55, 0x6E, 0x70, 0x72, 0x98, 0x85, 0x74, 0x61, 0xBB, 0x87, 0xBC, 0x81,
+  // 2624 "File Control Information (FCI) Issuer Discretionary Data"
+  25, 0x46, 0xB9, 0xCC, 0x82, 0x74, 0xAB, 0x6C, 0xBD, 0xFE, 0x84, 0x28, 0x46, 0x43, 0x49, 0x29, 0x94, 0xAC, 0xA0, 0x44, 0xAF, 0xEA, 0xEB, 0x83, 0xD6, 0x9D,
+  // 2650 "POS Cardholder Interaction Information"
+  19, 0x50, 0x4F, 0x53, 0x8B, 0xB4, 0x68, 0x6F, 0x6C, 0x64, 0x81, 0x94, 0x86, 0x81, 0x61, 0x9A, 0x49, 0x6E, 0xFE, 0x83,
+  // 2670 "DS Input (Card)"
+  7, 0xD0, 0xBD, 0x70, 0xB3, 0xCD, 0xB4, 0x29,
+  // 2678 "DS Digest H"
+  8, 0xD0, 0xF9, 0x69, 0x67, 0xD3, 0x74, 0x20, 0x48,
+  // 2687 "DS ODS Info"
+  6, 0xD0, 0xDA, 0xD0, 0xBD, 0x66, 0x6F,
+  // 2694 "DS ODS Term"
+  6, 0xD0, 0xDA, 0xD0, 0x20, 0x54, 0xB7,
+};
+
+// Sorted by tag. Entries for one length range come before the entry
+// for any length of the same tag.
+static constexpr TagDictEntry tag_dict[] = {
+  { 0x42,     0, 255,    0 },  // Issuer Identification Number (IIN)
+  { 0x4F,     0, 255,   11 },  // Application Identifier (AID) - card
+  { 0x50,     0, 255,   25 },  // Application Label
+  { 0x52,     0, 255,   31 },  // Command to perform
+  { 0x56,     0, 255,   46 },  // Track 1 Data
+  { 0x57,     0, 255,   51 },  // Track 2 Equivalent Data
+  { 0x5A,     0, 255,   62 },  // Application Primary Account Number (PAN)
+  { 0x61,     0, 255,   79 },  // Application Template
+  { 0x62,     0, 255,   83 },  // File Control Parameters (FCP) Template
+  { 0x64,     0, 255,  106 },  // File Management Data (FMD) Template
+  { 0x6F,     0, 255,  124 },  // File Control Information (FCI) Template
+  { 0x70,     0, 255,  142 },  // READ RECORD Response Message Template
+  { 0x71,     0, 255,  166 },  // Issuer Script Template 1
+  { 0x72,     0, 255,  176 },  // Issuer Script Template 2
+  { 0x73,     0, 255,  186 },  // Directory Discretionary Template
+  { 0x77,     0, 255,  201 },  // Response Message Template Format 2
+  { 0x80,     0, 255,  218 },  // Response Message Template Format 1
+  { 0x81,     0, 255,  235 },  // Amount, Authorised (Binary)
+  { 0x82,     0, 255,  250 },  // Application Interchange Profile
+  { 0x83,     0, 255,  263 },  // Command Template
+  { 0x84,     0, 255,  273 },  // Dedicated file (DF) Name
+  { 0x86,     0, 255,  289 },  // Issuer Script Command
+  { 0x87,     0, 255,  301 },  // Application Priority Indicator
+  { 0x88,     0, 255,  313 },  // Short File Identifier (SFI)
+  { 0x89,     0, 255,  330 },  // Authorisation Code
+  { 0x8A,     0, 255,  339 },  // Authorisation Response Code
+  { 0x8C,     0, 255,  352 },  // Card Risk Management Data object List 1 (CDOL1)
+  { 0x8D,     0, 255,  383 },  // Card Risk Management Data object List 2 (CDOL2)
+  { 0x8E,     0, 255,  414 },  // Cardholder Verification Method (CVM) List
+  { 0x8F,     0, 255,  436 },  // Certification Authority Public Key Index (PKI)
+  { 0x90,     0, 255,  459 },  // Issuer Public Key Certificate
+  { 0x91,     0, 255,  468 },  // Issuer Authentication Data
+  { 0x92,     0, 255,  475 },  // Issuer Public Key Remainder
+  { 0x93,     0, 255,  485 },  // Signed Static Application Data
+  { 0x94,     0, 255,  498 },  // Application File Locator (AFL)
+  { 0x95,     0, 255,  512 },  // Terminal Verification Results
+  { 0x97,     0, 255,  524 },  // Transaction Certificate Data Object List (TDOL)
+  { 0x98,     0, 255,  545 },  // Transaction Certificate (TC) Hash Value
+  { 0x99,     0, 255,  564 },  // Transaction Personal Identification Number (PIN) Data
+  { 0x9A,     0, 255,  580 },  // Transaction Date
+  { 0x9B,     0, 255,  584 },  // Transaction Status Information
+  { 0x9C,     0, 255,  594 },  // Transaction Type
+  { 0x9D,     0, 255,  600 },  // Directory Definition File (DDF) Name
+  { 0xA5,     0, 255,  623 },  // File Control Information (FCI) Proprietary Template
+  { 0x5F20,   0, 255,  648 },  // Cardholder Name
+  { 0x5F24,   0, 255,  658 },  // Application Expiration Date
+  { 0x5F25,   0, 255,  668 },  // Application Effective Date
+  { 0x5F28,   0, 255,  677 },  // Issuer Country Code
+  { 0x5F2A,   0, 255,  685 },  // Transaction Currency Code
+  { 0x5F2D,   0, 255,  690 },  // Language Preference
+  { 0x5F30,   0, 255,  705 },  // Service Code
+  { 0x5F34,   0, 255,  712 },  // Application Primary Account Number (PAN) Sequence Number
+  { 0x5F36,   0, 255,  737 },  // Transaction Currency Exponent
+  { 0x5F50,   0, 255,  745 },  // Issuer URL
+  { 0x5F53,   0, 255,  750 },  // International Bank Account Number (IBAN)
+  { 0x5F54,   0, 255,  772 },  // Bank Identifier Code (BIC)
+  { 0x5F55,   0, 255,  787 },  // Issuer Country Code (alpha2 format)
+  { 0x5F56,   0, 255,  805 },  // Issuer Country Code (alpha3 format)
+  { 0x5F57,   0, 255,  823 },  // Account Type
+  { 0x9F01,   0, 255,  833 },  // Acquirer Identifier
+  { 0x9F02,   0, 255,  843 },  // Amount, Authorised (Numeric)
+  { 0x9F03,   0, 255,  858 },  // Amount, Other (Numeric)
+  { 0x9F04,   0, 255,  871 },  // Amount, Other (Binary)
+  { 0x9F05,   0, 255,  884 },  // Application Discretionary Data
+  { 0x9F06,   0, 255,  893 },  // Application Identifier (AID) - terminal
+  { 0x9F07,   0, 255,  908 },  // Application Usage Control
+  { 0x9F08,   0, 255,  918 },  // Application Version Number
+  { 0x9F09,   0, 255,  926 },  // Application Version Number (terminal)
+  { 0x9F0A,   0, 255,  938 },  // Application Selection Registered Proprietary Data (ASRPD)
+  { 0x9F0B,   0, 255,  965 },  // Cardholder Name Extended
+  { 0x9F0C,   0, 255,  981 },  // Issuer Identification Number Extended (IINE)
+  { 0x9F0D,   0, 255, 1000 },  // Issuer Action Code - Default
+  { 0x9F0E,   0, 255, 1015 },  // Issuer Action Code - Denial
+  { 0x9F0F,   0, 255, 1027 },  // Issuer Action Code - Online
+  { 0x9F10,   0, 255, 1040 },  // Issuer Application Data
+  { 0x9F11,   0, 255, 1044 },  // Issuer Code Table Index
+  { 0x9F12,   0, 255, 1059 },  // Application Preferred Name
+  { 0x9F13,   0, 255, 1072 },  // Last Online Application Transaction Counter (ATC) Register
+  { 0x9F14,   0, 255, 1094 },  // Lower Consecutive Offline Limit
+  { 0x9F15,   0, 255, 1113 },  // Merchant Category Code
+  { 0x9F16,   0, 255, 1126 },  // Merchant Identifier
+  { 0x9F17,   0, 255, 1136 },  // Personal Identification Number (PIN) Try Counter
+  { 0x9F18,   0, 255, 1155 },  // Issuer Script Identifier
+  { 0x9F19,   0, 255, 1164 },  // Token Requestor ID
+  { 0x9F1A,   0, 255, 1177 },  // Terminal Country Code
+  { 0x9F1B,   0, 255, 1185 },  // Terminal Floor Limit
+  { 0x9F1C,   0, 255, 1194 },  // Terminal Identification
+  { 0x9F1D,   0, 255, 1200 },  // Terminal Risk Management Data
+  { 0x9F1E,   0, 255, 1214 },  // Interface Device (IFD) Serial Number
+  { 0x9F1F,   0, 255, 1237 },  // Track 1 Discretionary Data
+  { 0x9F20,   0, 255, 1248 },  // Track 2 Discretionary Data
+  { 0x9F21,   0, 255, 1259 },  // Transaction Time
+  { 0x9F22,   0, 255, 1264 },  // Certification Authority Public Key Index (PKI) - terminal
+  { 0x9F23,   0, 255, 1292 },  // Upper Consecutive Offline Limit
+  { 0x9F24,   0, 255, 1311 },  // Payment Account Reference (PAR)
+  { 0x9F25,   0, 255, 1331 },  // Last 4 Digits of PAN
+  { 0x9F26,   0, 255, 1350 },  // Application Cryptogram
+  { 0x9F27,   0, 255, 1360 },  // Cryptogram Information Data
+  { 0x9F29,   0, 255, 1373 },  // Extended Selection
+  { 0x9F2A,   0, 255, 1385 },  // Kernel Identifier
+  { 0x9F2D,   0, 255, 1393 },  // Integrated Circuit Card (ICC) PIN Encipherment Public Key Certificate
+  { 0x9F2E,   0, 255, 1429 },  // Integrated Circuit Card (ICC) PIN Encipherment Public Key Exponent
+  { 0x9F2F,   0, 255, 1464 },  // Integrated Circuit Card (ICC) PIN Encipherment Public Key Remainder
+  { 0x9F32,   0, 255, 1501 },  // Issuer Public Key Exponent
+  { 0x9F33,   0, 255, 1509 },  // Terminal Capabilities
+  { 0x9F34,   0, 255, 1521 },  // Cardholder Verification Method (CVM) Results
+  { 0x9F35,   0, 255, 1545 },  // Terminal type
+  { 0x9F36,   0, 255, 1552 },  // Application Transaction Counter (ATC)
+  { 0x9F37,   0, 255, 1560 },  // Unpredictable Number
+  { 0x9F38,   0, 255, 1573 },  // Processing Options Data Option List (PDOL)
+  { 0x9F39,   0, 255, 1596 },  // Point-of-Service (POS) Entry Mode
+  { 0x9F3A,   0, 255, 1622 },  // Amount, Reference Currency
+  { 0x9F3B,   0, 255, 1634 },  // Application Reference Currency
+  { 0x9F3C,   0, 255, 1643 },  // Transaction Reference Currency Code
+  { 0x9F3D,   0, 255, 1653 },  // Transaction Reference Currency Exponent
+  { 0x9F40,   0, 255, 1666 },  // Additional Terminal Capabilities
+  { 0x9F41,   0, 255, 1684 },  // Transaction Sequence Counter
+  { 0x9F42,   0, 255, 1694 },  // Currency Code, Application
+  { 0x9F43,   0, 255, 1704 },  // Application Reference Currency Exponent
+  { 0x9F44,   0, 255, 1717 },  // Currency Exponent, Application
+  { 0x9F45,   0, 255, 1730 },  // Data Authentication Code
+  { 0x9F46,   0, 255, 1738 },  // Integrated Circuit Card (ICC) Public Key Certificate
+  { 0x9F47,   0, 255, 1763 },  // Integrated Circuit Card (ICC) Public Key Exponent
+  { 0x9F48,   0, 255, 1787 },  // Integrated Circuit Card (ICC) Public Key Remainder
+  { 0x9F49,   0, 255, 1813 },  // Dynamic Data Authentication Data Object List (DDOL)
+  { 0x9F4A,   0, 255, 1838 },  // Static Data Authentication Tag List
+  { 0x9F4B,   0, 255, 1855 },  // Signed Dynamic Application Data
+  { 0x9F4C,   0, 255, 1868 },  // Integrated Circuit Card (ICC) Dynamic Number
+  { 0x9F4D,   0, 255, 1893 },  // Log Entry
+  { 0x9F4E,   0, 255, 1901 },  // Merchant Name and Location
+  { 0x9F4F,   0, 255, 1920 },  // Log Format
+  { 0x9F50,   0, 255, 1927 },  // Offline Accumulator Balance
+  { 0x9F51,   0, 255, 1948 },  // Application Currency Code
+  { 0x9F52,   0, 255, 1954 },  // Application Default Action (ADA)
+  { 0x9F53,   1,   1, 1970 },  // Transaction Category Code
+  { 0x9F53,   0, 255, 1977 },  // Consecutive Transaction Counter International Limit (CTCIL)
+  { 0x9F54,   0, 255, 2000 },  // Cumulative Total Transaction Amount Limit (CTTAL)
+  { 0x9F55,   0, 255, 2022 },  // Geographic Indicator
+  { 0x9F56,   0, 255, 2035 },  // Issuer Authentication Indicator
+  { 0x9F57,   0, 255,  677 },  // Issuer Country Code
+  { 0x9F58,   0, 255, 2046 },  // Consecutive Transaction Counter Limit (CTCL)
+  { 0x9F59,   0, 255, 2061 },  // Consecutive Transaction Counter Upper Limit (CTCUL)
+  { 0x9F5A,   0, 255, 2081 },  // Application Program Identifier (Program ID)
+  { 0x9F5B,   0, 255, 2097 },  // Issuer Script Results
+  { 0x9F5C,   8,   8, 2108 },  // DS Requested Operator ID
+  { 0x9F5C,   0, 255, 2123 },  // Cumulative Total Transaction Amount Upper Limit (CTTAUL)
+  { 0x9F5D,   3,   3, 2150 },  // Application Capabilities Information
+  { 0x9F5D,   0, 255, 2164 },  // Available Offline Spending Amount (AOSA)
+  { 0x9F5E,   8,  11, 2193 },  // DS ID
+  { 0x9F5E,   0, 255, 2197 },  // Consecutive Transaction International Upper Limit (CTIUL)
+  { 0x9F5F,   0, 255, 2222 },  // DS Slot Availability
+  { 0x9F60,   0, 255, 2238 },  // CVC3 (Track1)
+  { 0x9F61,   0, 255, 2247 },  // CVC3 (Track2)
+  { 0x9F62,   0, 255, 2256 },  // PCVC3 (Track1)
+  { 0x9F63,   0, 255, 2266 },  // PUNATC (Track1)
+  { 0x9F64,   0, 255, 2276 },  // NATC (Track1)
+  { 0x9F65,   0, 255, 2284 },  // PCVC3 (Track2)
+  { 0x9F66,   2,   2, 2294 },  // PUNATC (Track2)
+  { 0x9F66,   0, 255, 2304 },  // Terminal Transaction Qualifiers
+  { 0x9F67,   0, 255, 2315 },  // NATC (Track2)
+  { 0x9F68,   0, 255, 2323 },  // Card Additional Processes
+  { 0x9F69,   0, 255, 2336 },  // UDOL
+  { 0x9F6A,   0, 255, 2341 },  // Unpredictable Number (Numeric)
+  { 0x9F6B,   7,  19, 2358 },  // Track 2 Data
+  { 0x9F6B,   0, 255, 2363 },  // Card CVM Limit
+  { 0x9F6C,   0, 255, 2370 },  // Card Transaction Qualifiers (CTQ)
+  { 0x9F6D,   0, 255, 2385 },  // Mag-stripe Application Version Number (Reader)
+  { 0x9F6E,   4,   4, 2407 },  // Form Factor Indicator (FFI)
+  { 0x9F6E,   0, 255, 2424 },  // Third Party Data
+  { 0x9F6F,   0, 255, 2435 },  // DS Slot Management Control
+  { 0x9F70,   0, 255, 2454 },  // Protected Data Envelope 1
+  { 0x9F71,   0, 255, 2458 },  // Protected Data Envelope 2
+  { 0x9F72,   0, 255, 2462 },  // Protected Data Envelope 3
+  { 0x9F73,   0, 255, 2466 },  // Protected Data Envelope 4
+  { 0x9F74,   6,   6, 2470 },  // VLP Issuer Authorisation Code
+  { 0x9F74,   0, 255, 2485 },  // Protected Data Envelope 5
+  { 0x9F75,   0, 255, 2489 },  // Unprotected Data Envelope 1
+  { 0x9F76,   0, 255, 2496 },  // Unprotected Data Envelope 2
+  { 0x9F77,   0, 255, 2503 },  // Unprotected Data Envelope 3
+  { 0x9F78,   0, 255, 2510 },  // Unprotected Data Envelope 4
+  { 0x9F79,   0, 255, 2517 },  // Unprotected Data Envelope 5
+  { 0x9F7A,   0, 255, 2524 },  // VLP Terminal Support Indicator
+  { 0x9F7B,   0, 255, 2541 },  // VLP Terminal Transaction Limit
+  { 0x9F7C,  20,  20, 2550 },  // Merchant Custom Data
+  { 0x9F7C,   0, 255, 2564 },  // Customer Exclusive Data (CED)
+  { 0x9F7D,   0, 255, 2584 },  // DS Summary 1
+  { 0x9F7E,   0, 255, 2593 },  // Mobile Support Indicator
+  { 0x9F7F,   0, 255, 2609 },  // DS Unpredictable Number
+  { 0xBF0C,   0, 255, 2624 },  // File Control Information (FCI) Issuer Discretionary Data
+  { 0xDF4B,   0, 255, 2650 },  // POS Cardholder Interaction Information
+  { 0xDF60,   0, 255, 2670 },  // DS Input (Card)
+  { 0xDF61,   0, 255, 2678 },  // DS Digest H
+  { 0xDF62,   0, 255, 2687 },  // DS ODS Info
+  { 0xDF63,   0, 255, 2694 },  // DS ODS Term
+};
+
+#endif /* __EMV_TAG_DICT_H__ */
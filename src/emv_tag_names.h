@@ -1,17 +1,26 @@
 #ifndef __EMV_TAG_NAMES_H__
 #define __EMV_TAG_NAMES_H_
 #include <stdint.h>
+#include <stddef.h>
 
 
 // 
 // Support for looking up tag name for tag value
 //
+// The names are kept compressed in flash (src/emv_tag_dict.h) and
+// decoded into the caller's buffer.
+//
+
+// Buffer size that holds any tag name
+#define TAG_NAME_MAX 80
 
-// Call once to setup the table
-void init_tag_names();
+// Value length to pass when it isn't known
+#define TAG_LENGTH_ANY -1
 
-// Return a null terminated string that is the name for the tag
-const char* get_tag_name(uint16_t tag);
+// Write the null terminated name for the tag into name, cut to fit size.
+// Some tags name different data depending on the value length.
+// Return name, a zero length string for an unknown tag.
+const char* get_tag_name(uint16_t tag, int length, char* name, size_t size);
  
 
-#endif /* __EMV_TAG_NAMES_H__*/
\ No newline at end of file
+#endif /* __EMV_TAG_NAMES_H__*/
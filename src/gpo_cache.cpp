@@ -0,0 +1,118 @@
+//
+// Cache of built GET PROCESSING OPTIONS commands
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "gpo_cache.h"
+#include "emv_format.h"
+
+GpoCache gpo_cache;
+
+void GpoPatchList::add(int offset, int length, const uint8_t* value)
+{
+  if (count == GPO_MAX_PATCHES || offset + length > 255) {
+    overflow = true;
+    return;
+  }
+  patches[count].offset = (uint8_t) offset;
+  patches[count].length = (uint8_t) length;
+  patches[count].value = value;
+  count++;
+}
+
+GpoCache::GpoCache()
+{
+  clear();
+}
+
+void GpoCache::clear()
+{
+  for (int i = 0; i < GPO_CACHE_ENTRIES; i++) {
+    entries[i].valid = false;
+  }
+  use_counter = 0;
+  hits = 0;
+  misses = 0;
+}
+
+// FNV-1a
+uint32_t GpoCache::hashPDOL(const uint8_t* pdol, uint8_t pdol_length)
+{
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < pdol_length; i++) {
+    hash ^= pdol[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint8_t GpoCache::lookup(const uint8_t* pdol, uint8_t pdol_length, uint8_t* apdu)
+{
+  uint32_t hash = hashPDOL(pdol, pdol_length);
+
+  for (int i = 0; i < GPO_CACHE_ENTRIES; i++) {
+    Entry& entry = entries[i];
+    // pdol is NULL when the card has no PDOL
+    if (!entry.valid || entry.hash != hash || entry.pdol_length != pdol_length ||
+        (pdol_length > 0 && memcmp(entry.pdol, pdol, pdol_length) != 0)) {
+      continue;
+    }
+
+    memcpy(apdu, entry.apdu, entry.apdu_length);
+    for (int p = 0; p < entry.patches.count; p++) {
+      const GpoPatch& patch = entry.patches.patches[p];
+      memcpy(&apdu[patch.offset], patch.value, patch.length);
+    }
+    entry.last_used = ++use_counter;
+    hits++;
+    return entry.apdu_length;
+  }
+  misses++;
+  return 0;
+}
+
+void GpoCache::store(const uint8_t* pdol, uint8_t pdol_length,
+                     const uint8_t* apdu, uint8_t apdu_length, const GpoPatchList& patches)
+{
+  if (pdol_length > GPO_CACHE_MAX_PDOL || patches.overflow) {
+    return;
+  }
+
+  // Use a free entry, or the least recently used one
+  Entry* entry = &entries[0];
+  for (int i = 0; i < GPO_CACHE_ENTRIES; i++) {
+    if (!entries[i].valid) {
+      entry = &entries[i];
+      break;
+    }
+    if (entries[i].last_used < entry->last_used) {
+      entry = &entries[i];
+    }
+  }
+
+  entry->valid = true;
+  entry->hash = hashPDOL(pdol, pdol_length);
+  entry->last_used = ++use_counter;
+  entry->pdol_length = pdol_length;
+  if (pdol_length > 0) {
+    memcpy(entry->pdol, pdol, pdol_length);
+  }
+  entry->apdu_length = apdu_length;
+  memcpy(entry->apdu, apdu, apdu_length);
+  entry->patches = patches;
+}
+
+void GpoCache::printStats()
+{
+  uint32_t lookups = hits + misses;
+  trace_out.putStr("GPO cache: hits ");
+  trace_out.putDec(hits);
+  trace_out.putStr(", misses ");
+  trace_out.putDec(misses);
+  trace_out.putStr(", hit rate ");
+  trace_out.putDec(lookups > 0 ? (uint32_t) ((uint64_t) hits * 100 / lookups) : 0);
+  trace_out.putLine("%");
+  trace_out.flush();
+}
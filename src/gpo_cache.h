@@ -0,0 +1,83 @@
+#ifndef __GPO_CACHE_H__
+#define __GPO_CACHE_H__
+#include <stdint.h>
+
+//
+// Cache of built GET PROCESSING OPTIONS commands
+//
+// Cards from the same issuer profile send byte identical PDOLs, so the
+// GPO command built for one can be reused for the next. Entries are
+// keyed on a hash of the PDOL value (the full PDOL is compared too) and
+// replaced least recently used first.
+//
+// Values that change per transaction, like the unpredictable number and
+// the date, are recorded as patches: an offset in the command and where
+// to copy the current value from. They are copied in on every hit.
+//
+// If other terminal data changes, call clear().
+//
+
+#ifndef GPO_CACHE_ENTRIES
+#define GPO_CACHE_ENTRIES 4
+#endif
+#define GPO_CACHE_MAX_PDOL 64
+#define GPO_MAX_PATCHES 4
+
+struct GpoPatch {
+  uint8_t offset;         // Position in the command
+  uint8_t length;         // Bytes to copy
+  const uint8_t* value;   // Current value
+};
+
+// Patches recorded while building a command
+struct GpoPatchList {
+  GpoPatchList() : count(0), overflow(false) {}
+  void add(int offset, int length, const uint8_t* value);
+
+  GpoPatch patches[GPO_MAX_PATCHES];
+  uint8_t count;
+  bool overflow;          // Too many patches, can't be cached
+};
+
+class GpoCache {
+public:
+  GpoCache();
+
+  // Look for a command built for this PDOL. On a hit it is copied to
+  // apdu with the per transaction values refreshed and the length is
+  // returned. Return 0 on a miss.
+  uint8_t lookup(const uint8_t* pdol, uint8_t pdol_length, uint8_t* apdu);
+
+  // Save a command built for this PDOL
+  void store(const uint8_t* pdol, uint8_t pdol_length,
+             const uint8_t* apdu, uint8_t apdu_length, const GpoPatchList& patches);
+
+  void clear();
+
+  // Print hits, misses and the hit rate
+  void printStats();
+
+  uint32_t hits;
+  uint32_t misses;
+
+private:
+  struct Entry {
+    bool valid;
+    uint32_t hash;
+    uint32_t last_used;
+    uint8_t pdol_length;
+    uint8_t pdol[GPO_CACHE_MAX_PDOL];
+    uint8_t apdu_length;
+    uint8_t apdu[255];
+    GpoPatchList patches;
+  };
+
+  static uint32_t hashPDOL(const uint8_t* pdol, uint8_t pdol_length);
+
+  Entry entries[GPO_CACHE_ENTRIES];
+  uint32_t use_counter;
+};
+
+extern GpoCache gpo_cache;
+
+#endif /* __GPO_CACHE_H__ */
@@ -0,0 +1,41 @@
+//
+// Flash the results log is kept in
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include "log_storage.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+
+bool PartitionStorage::begin(const char* label)
+{
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  return partition != NULL;
+}
+
+uint32_t PartitionStorage::size()
+{
+  if (partition == NULL) {
+    return 0;
+  }
+  return partition->size / LOG_SECTOR_SIZE * LOG_SECTOR_SIZE;
+}
+
+bool PartitionStorage::read(uint32_t offset, void* data, uint32_t length)
+{
+  return partition != NULL && esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+
+bool PartitionStorage::write(uint32_t offset, const void* data, uint32_t length)
+{
+  return partition != NULL && esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool PartitionStorage::eraseSector(uint32_t offset)
+{
+  return partition != NULL &&
+         esp_partition_erase_range(partition, offset, LOG_SECTOR_SIZE) == ESP_OK;
+}
+
+#endif /* ARDUINO_ARCH_ESP32 */
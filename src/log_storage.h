@@ -0,0 +1,53 @@
+#ifndef __LOG_STORAGE_H__
+#define __LOG_STORAGE_H__
+#include <stdint.h>
+
+//
+// Flash the results log is kept in
+//
+// The operations are those of NOR flash: erase sets a whole sector to
+// 0xFF, and a write can only clear bits, so bytes are written once
+// between erases. The firmware uses a raw data partition; the host
+// build uses a file that behaves the same way (host/file_storage.h).
+//
+
+#define LOG_SECTOR_SIZE 4096
+
+class LogStorage {
+public:
+  virtual ~LogStorage() {}
+
+  // Bytes available, a multiple of LOG_SECTOR_SIZE
+  virtual uint32_t size() = 0;
+
+  virtual bool read(uint32_t offset, void* data, uint32_t length) = 0;
+  virtual bool write(uint32_t offset, const void* data, uint32_t length) = 0;
+
+  // Erase the sector that starts at offset
+  virtual bool eraseSector(uint32_t offset) = 0;
+};
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_partition.h>
+
+//
+// A data partition of the ESP32 flash, found by its label
+//
+class PartitionStorage : public LogStorage {
+public:
+  PartitionStorage() : partition(NULL) {}
+
+  // Find the partition. Return false if there is none with that label.
+  bool begin(const char* label);
+
+  uint32_t size();
+  bool read(uint32_t offset, void* data, uint32_t length);
+  bool write(uint32_t offset, const void* data, uint32_t length);
+  bool eraseSector(uint32_t offset);
+
+private:
+  const esp_partition_t* partition;
+};
+#endif /* ARDUINO_ARCH_ESP32 */
+
+#endif /* __LOG_STORAGE_H__ */
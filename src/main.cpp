@@ -15,609 +15,419 @@
 #include "PN532.h"
 #include "tlv.h"
 #include "emv_tag_names.h"
-
-// Drivers for the PN532
-PN532_SPI pn532_spi(SPI, 3);
-PN532 nfc(pn532_spi);
-
-// Global buffers for sending and recieving
-uint8_t rx_buffer[255];     // Buffer for received messages
-uint8_t tx_buffer[255];     // Buffer for transmitted messages
-uint8_t data_buffer[255];   // Buffer to save or assemble data
-
-// Utility to decode BER TLV messages
-TLVS rx_tlvs;               // Decode received TLVs
-
-// Pre-declarations of later functions
-TLVNode* getPreferredAID();
-bool selectApplicationID(TLVNode* aid_node, TLVNode*& pdol_node);
-TLVNode* getProcessingOptions(TLVNode* pdol_node);
-void readAppRecords(uint8_t sfi, uint8_t start, uint8_t end);
-
-// Elements of the data table for PDO default values
-struct DataOption {
-  DataOption(uint16_t tag, uint8_t* val, uint8_t val_length);
-  uint16_t tag;
-  uint8_t* value;
-  uint8_t value_length;
-};
-
-DataOption::DataOption(uint16_t tag, uint8_t* val, uint8_t val_length) {
-  this->tag = tag;
-  this->value = val;
-  this->value_length = val_length;
-  
-}
-//
-// Setup function
-// Mostly borrowed from PN352 example code.
-void setup()
-{
-  Serial.begin(115200);
-  while (!Serial) {}
-  delay(2000);
-  Serial.println("-------Read EMV via PN53x--------");
-
-  // Setup Tag value to Name lookup table.
-  init_tag_names();
-
-  SPI.begin(SCK, MISO, MOSI, 3);
-  nfc.begin();
-
-  uint32_t versiondata = nfc.getFirmwareVersion();
-  if (!versiondata)
-  {
-    Serial.println("Didn't find PN53x board");
-    while (1)
-      ; // halt
+#include "card_session.h"
+#include "reader_scheduler.h"
+#include "tap_stats.h"
+#include "gpo_cache.h"
+#include "aid_cache.h"
+#include "emv_format.h"
+#include "trace_output.h"
+#include "trace_level.h"
+#include "output_queue.h"
+#include "pn532_async.h"
+#include "apdu_trace.h"
+#include "retry_transport.h"
+#include "mem_stats.h"
+#include "log_storage.h"
+#include "results_log.h"
+
+// Wait on the PN532 IRQ line and move frames with SPI DMA, instead of
+// polling the PN532 through the blocking driver. Needs the PN532 IRQ
+// pin of each head wired. Comment out to use the blocking driver.
+// #define ASYNC_TRANSPORT
+
+// Uncomment to record every exchange for host/tools/apdu_replay.
+// The r command dumps the recording.
+// #define APDU_RECORD
+
+#ifdef APDU_RECORD
+ApduTraceBuffer apdu_trace;
+#endif
+
+// Keep a record of each tap in this data partition (partitions.csv).
+// Comment out to not log the taps.
+#define RESULTS_PARTITION "results"
+
+#ifdef RESULTS_PARTITION
+PartitionStorage results_storage;
+#endif
+
+// Time one PN532 passive activation attempt takes when no card answers,
+// to fit the attempts to a detect timeout
+#define PN532_ACTIVATION_RETRY_MS 4
+
+// Card transport over the PN532
+class PN532Transport : public CardTransport {
+public:
+  PN532Transport(PN532& nfc)
+    : nfc(nfc), detect_timeout_ms(1000), activation_retries(0xFF), uid_length(0) {}
+
+  void setDetectTimeout(uint16_t timeout_ms) {
+    // readPassiveTargetID() only stops waiting at the timeout. The PN532
+    // stops searching after its activation retries, so bound those by
+    // the timeout too. Only sent when it changes, it is a command.
+    unsigned long retries = timeout_ms / PN532_ACTIVATION_RETRY_MS;
+    if (retries < 1) {
+      retries = 1;
+    } else if (retries > 0xFE) {
+      retries = 0xFE;       // 0xFF is unlimited
+    }
+    if (retries != activation_retries && nfc.setPassiveActivationRetries(retries)) {
+      activation_retries = retries;
+    }
+    detect_timeout_ms = timeout_ms;
   }
 
-  // Got ok data, print it out!
-  Serial.print("Found chip PN5");
-  Serial.println((versiondata >> 24) & 0xFF, HEX);
-  Serial.print("Firmware ver. ");
-  Serial.print((versiondata >> 16) & 0xFF, DEC);
-  Serial.print('.');
-  Serial.println((versiondata >> 8) & 0xFF, DEC);
-
-  // Set the max number of retry attempts to read from a card
-  // This prevents us from waiting forever for a card, which is
-  // the default behaviour of the PN532.
-  nfc.setPassiveActivationRetries(0xFF);
-
-  // configure board to read RFID tags
-  nfc.SAMConfig();
-}
-
-void loop()
-{
-  // Loop to detect and process a card touch
-  // Note: this may take awhile. It may be better to break the steps up, one per loop,
-  // but this is just experimental code, and is easier to read this way. 
+  bool detectCard() {
+    // List the target for data exchange, and keep the UID
+    uid_length = sizeof(uid);
+    if (!nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uid_length, detect_timeout_ms, true)) {
+      uid_length = 0;
+      return false;
+    }
+    return true;
+  }
 
-  bool success;
-  Serial.println("Waiting for an ISO14443A card");
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length) {
+    if (this->uid_length == 0 || this->uid_length > *uid_length) {
+      return false;
+    }
+    memcpy(uid, this->uid, this->uid_length);
+    *uid_length = this->uid_length;
+    return true;
+  }
 
-  // Look for a new card
-  success = nfc.inListPassiveTarget();
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length) {
+    return nfc.inDataExchange((uint8_t*) tx, tx_length, rx, rx_length);
+  }
 
-  if (success)
-  {
-    Serial.println("Found something!");
-    Serial.println("");
+private:
+  PN532& nfc;
+  uint16_t detect_timeout_ms;
+  uint8_t activation_retries;
+  uint8_t uid[10];
+  uint8_t uid_length;
+};
 
-    // Query to find the preferred application ID
-    TLVNode* aid_node = getPreferredAID();
-    if (aid_node == NULL) {
-      return;
-    }
-    Serial.println();
+// One PN532 head: its driver, transport and card session
+struct ReaderHead {
+  ReaderHead(uint8_t ss_pin, uint8_t irq_pin)
+    : ss_pin(ss_pin), pn532_spi(SPI, ss_pin), nfc(pn532_spi),
+#ifdef ASYNC_TRANSPORT
+      card(SPI2_HOST, SCK, MISO, MOSI, ss_pin, irq_pin),
+#else
+      card(nfc),
+#endif
+#ifdef APDU_RECORD
+      recorder(card, apdu_trace),
+      session(recorder) {}
+#else
+      session(card) {}
+#endif
+
+  uint8_t ss_pin;
+  PN532_SPI pn532_spi;
+  PN532 nfc;
+#ifdef ASYNC_TRANSPORT
+  PN532AsyncTransport card;
+#else
+  PN532Transport card;
+#endif
+#ifdef APDU_RECORD
+  ApduRecorder recorder;
+#endif
+  CardSession session;
+};
 
-    // Select the application ID 
-    TLVNode* pdol_node;
-    if (!selectApplicationID(aid_node, pdol_node)) {
-      Serial.println("Failed to select AID");
-      return;
-    }
+// PN532 heads on the SPI bus, each with its own chip select.
+// Add a line per head, up to MAX_READERS: { SS pin, IRQ pin }
+ReaderHead readers[] = {
+  { 3, 5 },
+};
+#define NUM_READERS ((int) (sizeof(readers) / sizeof(readers[0])))
 
-    // Run Get Processing Options - returns Application File Locator
-    TLVNode* app_files_node = getProcessingOptions(pdol_node);
-    if (app_files_node == NULL) {
-      Serial.println("No app files found");
-      return;
-    }
-    Serial.println();
-
-    // Save the short file identifier list
-    // The TX/RX of further will overwrite the app_files_node
-    memcpy(data_buffer, app_files_node->getValue(), app_files_node->getValueLength());
-
-    // Parse the short file idenfiier list, and read the app records for each entry
-    ReadBuffer app_files(data_buffer, app_files_node->getValueLength());
-    while (!app_files.atEnd()) {
-      uint8_t sfi, start, end, num_auth_rec;
-      if (!app_files.getByte(sfi) ||
-          !app_files.getByte(start) ||
-          !app_files.getByte(end) ||
-          !app_files.getByte(num_auth_rec)) {
-            continue;
-      }
-      // extract SFI value
-      sfi = sfi >> 3;
-
-      // Read the App record
-      readAppRecords(sfi, start, end);
-      Serial.println();
-    }
-  }
-}
+// Detect timeout after a recent card. With several heads, a head with
+// no card must not hold up the others.
+#define DETECT_TIMEOUT_MS (NUM_READERS > 1 ? 50 : 1000)
+// Detect timeout once a head has been idle for POLL_BUSY_WINDOW_MS
+#define DETECT_IDLE_TIMEOUT_MS 30
 
-//
-// Dump a binary message to the serial port.
-//
-void printMessage(uint8_t *buffer, uint8_t length)
-{
-  String msgBuf;
+// A card left on a head is read once, not again until it has been
+// away for this long
+#define TAP_DEBOUNCE_MS 1000
 
-  for (int i = 0; i < length; i++)
-  {
+ReaderScheduler scheduler;
 
-    if (buffer[i] < 0x10)
-      msgBuf = msgBuf + "0"; //Adds leading zeros if hex value is smaller than 0x10
+// Uncomment to stop reading records once these tags have been read
+// #define MINIMAL_READ
+#ifdef MINIMAL_READ
+const uint16_t required_tags[] = { 0x5a, 0x5f24, 0x57 };
+#endif
 
-    msgBuf = msgBuf + String(buffer[i], HEX) + " ";
-  }
+// Run the card session in its own task, and send the trace to Serial
+// from a lower priority task through output_queue. Comment out to
+// print from loop() between exchanges.
+#define OUTPUT_TASK
 
-  Serial.print("TX message (");
-  Serial.print(length);
-  Serial.print(" bytes): ");
-  Serial.println(msgBuf);
-}
+#define SESSION_TASK_PRIORITY 2
+#define SESSION_TASK_STACK 8192
+#define OUTPUT_TASK_PRIORITY 1
+#define OUTPUT_TASK_STACK 4096
 
+void runSession();
+void sessionTask(void* param);
+void outputTask(void* param);
 
 //
-// Dump an APDU response to the serial port.
-//
-void printResponse(uint8_t *buffer, uint8_t length)
+// Setup function
+// Mostly borrowed from PN352 example code.
+void setup()
 {
-  Serial.print("RX message (");
-  Serial.print(length);
-  Serial.println(" bytes): ");
-  nfc.PrintHexChar(buffer, length);
-}
+  Serial.begin(115200);
+  while (!Serial) {}
+  delay(2000);
+  TRACE_PROGRESS(Serial.println("-------Read EMV via PN53x--------"));
 
-//
-// Print the value of a TLV and all sub-TLVs to the serial port.
-//
-void printTLV(TLVNode* node, int indent=0)
-{
-    for (int i = 0; i < indent; i++)
-        Serial.print("  ");
+  SPI.begin(SCK, MISO, MOSI, readers[0].ss_pin);
 
-    if (node == NULL) {
-        Serial.println("NULL pointer for TLVNode....");
-        return;
-    }
+  for (int i = 0; i < NUM_READERS; i++) {
+    PN532& nfc = readers[i].nfc;
+    nfc.begin();
 
-    Serial.print("Tag: ");
-    Serial.print(node->getTag(), HEX);
-    const char* tag_name = get_tag_name(node->getTag());
-    if (strlen(tag_name) > 0) {
-      Serial.print(" - ");
-      Serial.print(tag_name);
-    }
-    Serial.print(" (");
-    Serial.print(node->getValueLength());
-    Serial.println(" bytes)");
-    TLVNode *child = node->firstChild();
-    if (child == NULL) {
-        for (int i = 0; i <= indent; i++)
-            Serial.print("    ");
-        TLVS::printValue(node->getValue(), node->getValueLength());
-        Serial.println("");
+    uint32_t versiondata = nfc.getFirmwareVersion();
+    if (!versiondata)
+    {
+      TRACE_ERROR(Serial.print("Didn't find PN53x board "); Serial.println(i));
+      while (1)
+        ; // halt
     }
 
-    while (child != NULL) {
-        printTLV(child, indent + 1);
-        child = node->nextChild(child);
+    // Got ok data, print it out!
+    if constexpr (TRACE_ENABLED(TRACE_LEVEL_PROGRESS)) {
+      Serial.print("Found chip PN5");
+      Serial.println((versiondata >> 24) & 0xFF, HEX);
+      Serial.print("Firmware ver. ");
+      Serial.print((versiondata >> 16) & 0xFF, DEC);
+      Serial.print('.');
+      Serial.println((versiondata >> 8) & 0xFF, DEC);
     }
-}
 
+    // Search for a card until the first detect timeout is set, which
+    // bounds the retry attempts (see PN532Transport::setDetectTimeout)
+    nfc.setPassiveActivationRetries(0xFF);
 
-//
-// Check the status bytes in a Response APDU.
-// Return True if OK
-//
-bool checkApduResponse(const uint8_t *rx_buffer, uint8_t length)
-{
-  if (length < 2) {
-    Serial.print("Short APDU response - ");
-    Serial.print(length);
-    Serial.println(" bytes.");
-    return false;
+    // configure board to read RFID tags
+    nfc.SAMConfig();
   }
 
-  // Check SW1 and SW2
-  if (rx_buffer[length-2] != 0x90 || rx_buffer[length-1] != 0x00) {
-    // Note, real usage needs checks for other values. e.g. 'more data'
-    Serial.println("Error response to APDU");
-    return false;
+#ifdef ASYNC_TRANSPORT
+  // Hand the SPI bus over to the IRQ driven transports
+  SPI.end();
+#endif
+  scheduler.setDetectTimeouts(DETECT_TIMEOUT_MS, DETECT_IDLE_TIMEOUT_MS);
+  for (int i = 0; i < NUM_READERS; i++) {
+#ifdef APDU_RECORD
+    readers[i].recorder.setReader(i);
+#endif
+#ifdef ASYNC_TRANSPORT
+    if (!readers[i].card.begin()) {
+      TRACE_ERROR(Serial.println("Failed to start the PN532 async transport"));
+      while (1)
+        ; // halt
+    }
+#endif
+
+    // Returning cards skip the PPSE exchange
+    CardSession& session = readers[i].session;
+    session.useAidCache(&aid_cache);
+    session.setDebounce(TAP_DEBOUNCE_MS);
+#ifdef MINIMAL_READ
+    session.setRequiredTags(required_tags, sizeof(required_tags) / sizeof(required_tags[0]));
+#endif
+    scheduler.addReader(session);
+  }
+
+#ifdef RESULTS_PARTITION
+  if (results_storage.begin(RESULTS_PARTITION) && results_log.begin(results_storage)) {
+    scheduler.useResultsLog(&results_log);
+  } else {
+    TRACE_ERROR(Serial.println("No results partition, taps are not logged"));
   }
-  return true;
+#endif
+
+#ifdef OUTPUT_TASK
+  setOutputPort(output_queue);
+  xTaskCreate(outputTask, "output", OUTPUT_TASK_STACK, NULL, OUTPUT_TASK_PRIORITY, NULL);
+  xTaskCreate(sessionTask, "session", SESSION_TASK_STACK, NULL, SESSION_TASK_PRIORITY, NULL);
+#else
+  // loop() runs the sessions, in this task
+  mem_stats.track();
+#endif
 }
- 
-/*** Step 1: read 2pay.sys.ddf01 and return an Application ID ***/
 
-//
-// Get the preferred App Identifier from the card
-//
-TLVNode* getPreferredAID()
+#ifdef RESULTS_PARTITION
+// Read a number that follows a command, if there is one
+static bool readNumber(unsigned long* value)
 {
-  Serial.println("*** GetPreferredAID");
-
-  // Build the Request APDU
-  uint8_t apdu[] ={ 0x00,   /* CLA */
-                    0xA4,   /* INS */   // SELECT
-                    0x04,   /* P1 */
-                    0x00,   /* P2 */
-                    0x0e,   /* Length of filename */
-                    /* 2pay.sys.ddf01 */
-                    0x32, 0x50, 0x41, 0x59, 0x2e, 0x53, 0x59, 
-                    0x53, 0x2e, 0x44, 0x44, 0x46, 0x30, 0x31, 
-                    0x00 /* LE */ };
-
-  // Send the request
-  uint8_t length = sizeof(rx_buffer);
-  printMessage(apdu, (uint8_t) sizeof(apdu));
-  bool success = nfc.inDataExchange(apdu, sizeof(apdu), rx_buffer, &length);
-
-  // Check the response
-  if (!success) {
-    Serial.print("No AID found");
-    return NULL;
+  bool found = false;
+  *value = 0;
+  unsigned long start = millis();
+  while (millis() - start < 20) {
+    int c = Serial.peek();
+    if (c < 0) {
+      delay(1);
+      continue;
+    }
+    if (c < '0' || c > '9') {
+      break;
+    }
+    Serial.read();
+    *value = *value * 10 + (c - '0');
+    found = true;
+    start = millis();
   }
-  printResponse(rx_buffer, length);
+  return found;
+}
 
-  if (!checkApduResponse(rx_buffer, length)) {
-    return NULL;
-  }
-  length -= 2;
-
-  // Parse the result message
-  rx_tlvs.decodeTLVs(rx_buffer, length);
-  printTLV(rx_tlvs.firstTLV());
-
-  TLVNode *node = rx_tlvs.findTLV(0x61);
-  TLVNode *sel_aid_node = NULL;
-  TLVNode *sel_label_node = NULL;
-  uint8_t sel_app_pref = 99;
-
-  while (node != NULL) {
-    TLVNode *pref_node = node->findChild(0x87);
-    TLVNode *label_node = node->findChild(0x50);
-    TLVNode *aid_node = node->findChild(0x4f);
-
-    if (aid_node != NULL) {
-      // Use the App Pref value if present
-      uint8_t app_pref = 98;
-      if (pref_node != NULL) {
-        app_pref = pref_node->getValue()[0];
-      }
-
-      if (app_pref < sel_app_pref) {
-        sel_app_pref = app_pref;
-        sel_aid_node = aid_node;
-        sel_label_node = label_node;
-      }
+static void exportResultsLog()
+{
+  unsigned long first = 0;
+  unsigned long last = LOG_NO_SEQ;
+  if (readNumber(&first) && Serial.peek() == '-') {
+    Serial.read();
+    if (!readNumber(&last)) {
+      last = LOG_NO_SEQ;
     }
-    node = rx_tlvs.findNextTLV(node);
   }
-  Serial.print("Returning app pref: ");
-  Serial.print(sel_app_pref);
-  if (sel_label_node != NULL) {
-    Serial.print(": ");
-    TLVS::printValue(sel_label_node->getValue(), sel_label_node->getValueLength());
-  }
-  Serial.println();
-  return sel_aid_node;
+  // Nothing of the export may be dropped
+  output_queue.setPolicy(QUEUE_WAIT);
+  results_log.exportRecords(first, last);
+  output_queue.setPolicy(QUEUE_DROP);
 }
-
-
-/*** Step 2: Select the Application ID, and return the PD options list ***/
+#endif
 
 //
-// Select the given AID, return the list of processing data options, if any
+// Commands from the serial port:
+//   s - print tap latency statistics, reader throughput and detection,
+//       link errors and retries, cache hit rates, output queue use, and
+//       heap and stack use (MEM_TRACK)
+//   c - clear the statistics and the caches
+//   b - binary trace output (decode with host/tools/trace_decode)
+//   t - text trace output
+//   r - dump the APDU recording (APDU_RECORD) and start a new one
+//   l - print the results log: records kept, sector use and wear
+//   x - export the results log. x100 exports from record 100 on,
+//       x100-200 records 100 to 200.
 //
-bool selectApplicationID(TLVNode* aid_node, TLVNode*& pdol_node)
+void handleSerialCommands()
 {
-  Serial.println("*** Select Application ID");
-
-  uint8_t selectApdu[] = {0x00,  /* CLA */
-                          0xA4,  /* INS */  // SELECT
-                          0x04,  /* P1  */
-                          0x00,  /* P2  */ };
-
-  WriteBuffer tx(tx_buffer, sizeof(tx_buffer));
-  tx.putBytes(selectApdu, sizeof(selectApdu));
-  // Add command data
-  tx.putByte(aid_node->getValueLength());   // AID Length
-  tx.putBytes(aid_node->getValue(), aid_node->getValueLength()); // AID Value
-  tx.putByte(0);  // Le
-  printMessage(tx_buffer, (uint8_t) tx.pos);
-
-  uint8_t rxlength = sizeof(rx_buffer);
-  bool success = nfc.inDataExchange(tx.buffer, tx.pos, rx_buffer, &rxlength);
-
-  if (!success) {
-    Serial.println("Failed");
-    return false;
-  }
-  printResponse(rx_buffer, rxlength);
-
-  if (!checkApduResponse(rx_buffer, rxlength)) {
-    return false;
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case 's':
+        // Nothing of the dump may be dropped
+        output_queue.setPolicy(QUEUE_WAIT);
+        tap_stats.print();
+        scheduler.printStats();
+        link_stats.print();
+        gpo_cache.printStats();
+        aid_cache.printStats();
+        output_queue.printStats();
+#ifdef MEM_TRACK
+        mem_stats.print();
+#endif
+        output_queue.setPolicy(QUEUE_DROP);
+        break;
+      case 'c':
+        tap_stats.clear();
+        scheduler.clearStats();
+        link_stats.clear();
+        gpo_cache.clear();
+        aid_cache.clear();
+        output_queue.clearStats();
+        mem_stats.clear();
+        results_log.clearStats();
+        trace_out.putLine("Statistics cleared");
+        trace_out.flush();
+        break;
+      case 'b':
+        setOutputMode(OUTPUT_BINARY);
+        break;
+      case 't':
+        setOutputMode(OUTPUT_TEXT);
+        break;
+#ifdef APDU_RECORD
+      case 'r':
+        // Nothing of the dump may be dropped
+        output_queue.setPolicy(QUEUE_WAIT);
+        apdu_trace.dump();
+        output_queue.setPolicy(QUEUE_DROP);
+        apdu_trace.clear();
+        break;
+#endif
+#ifdef RESULTS_PARTITION
+      case 'l':
+        results_log.printStats();
+        break;
+      case 'x':
+        exportResultsLog();
+        break;
+#endif
+    }
   }
-  rxlength -= 2; // Remove status bytes
-
-  rx_tlvs.decodeTLVs(rx_buffer, rxlength);
-  printTLV(rx_tlvs.firstTLV());
-
-  // Return the Processing Data Options List
-  pdol_node = rx_tlvs.findTLV(0x9f38);
-  return  true;
 }
 
-/***  Default Data Options: Build Data Options List  ***/
-
-// Pre-defined data for our emulated 'terminal' reading the card
-// The choice of data here is mostly arbitrary
-
-// Terminal transaction qualifiers
-uint16_t dolTagTTQ = 0x9f66;
-uint8_t dolValTTQ[] = { 0x36, 0x80, 0x40, 0x00 };
-
-// Transaction currency code
-uint16_t dolTagTCC = 0x5f2a;
-uint8_t dolValTCC[] = { 0x08, 0x40 };  // USD numeric code
-
-// Terminal Risk Management Data
-uint16_t dolTagTRMD = 0x9f1d;
-uint8_t dolValTRMD[] = { 0x40, 0x40, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-// Terminal Country Code
-uint16_t dolTagTCnC = 0x9f1a;
-uint8_t dolValTCnC[] = { 0x08, 0x40 }; // US
-
-// Terminal Type
-uint16_t dolTagTT = 0x9f35;
-uint8_t dolValTT[] = { 0x14 };
-
-// Acquirer Identifier
-uint16_t dolTagAI = 0x9f01;
-uint8_t dolValAI[] = { 0x01 };
-
-// Application lifecycle data
-uint16_t dolTagALCD = 0x9f7e;
-uint8_t dolValALCD[] = { 0x01 };
-
-// Merchant name and location
-uint16_t dolTagMNL = 0x9f4e;
-uint8_t dolValMNL[] = { 
-    0x41, 0x42, 0x43, 0x32, 0x30, 0x32, 0x34, 0x30, 0x38, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-
-// Transaction amount
-uint16_t dolTagTA = 0x9f02;
-uint8_t dolValTA[] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00 };
-
-// Amount other
-uint16_t dolTagAO = 0x9f03;
-uint8_t dolValAO[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-// Terminal verification results
-uint16_t dolTagTVR = 0x95;
-uint8_t dolValTVR[] = { 0x00, 0x00, 0x00, 0x00, 0x00 };
-
-// Transaction date
-uint16_t dolTagTD = 0x9a;
-uint8_t dolValTD[] = { 0x23, 0x03, 0x01 };
-
-// Transaction type
-uint16_t dolTagTrT = 0x9c;
-uint8_t dolValTrT[] = { 0x00 };
-
-// Unpredictable number
-uint16_t dolTagUN = 0x9f37;
-uint8_t dolValUN[] = { 0x38, 0x39, 0x30, 0x31 };
-
-
-
-  
-// Data Option Lookup Table
-// Use these values to fill out a PDOL list for the Get Processing Options request
-DataOption data_options_list[] = {
-  DataOption(dolTagTTQ, &dolValTTQ[0], (uint8_t) sizeof(dolValTTQ)),
-  DataOption(dolTagTCC, &dolValTCC[0], (uint8_t) sizeof(dolValTCC)),
-  DataOption(dolTagTRMD, &dolValTRMD[0], (uint8_t) sizeof(dolValTRMD)),
-  DataOption(dolTagTCnC, &dolValTCnC[0], (uint8_t) sizeof(dolValTCnC)),
-  DataOption(dolTagTT, &dolValTT[0], (uint8_t) sizeof(dolValTT)),
-  DataOption(dolTagAI, &dolValAI[0], (uint8_t) sizeof(dolValAI)),
-  DataOption(dolTagALCD, &dolValALCD[0], (uint8_t) sizeof(dolValALCD)),
-  DataOption(dolTagMNL, &dolValMNL[0], (uint8_t) sizeof(dolValMNL)),
-  DataOption(dolTagTA, &dolValTA[0], (uint8_t) sizeof(dolValTA)),
-  DataOption(dolTagAO, &dolValAO[0], (uint8_t) sizeof(dolValAO)),
-  DataOption(dolTagTVR, &dolValTVR[0], (uint8_t) sizeof(dolValTVR)),
-  DataOption(dolTagTD, &dolValTD[0], (uint8_t) sizeof(dolValTD)),
-  DataOption(dolTagTrT, &dolValTrT[0], (uint8_t) sizeof(dolValTrT)),
-  DataOption(dolTagUN, &dolValUN[0], (uint8_t) sizeof(dolValUN))
-};
-
-// Seach the table for a matching tag
-// Return NULL if not found
-DataOption* getDataOption(uint16_t tag) 
+void runSession()
 {
-  for (int i = 0; i < sizeof(data_options_list)/sizeof(DataOption); i++) {
-    if (data_options_list[i].tag == tag) {
-      return &data_options_list[i];
-    }
+  // Detect and process a card touch, one step per call, taking turns
+  // between the readers whose card has answered.
+  scheduler.step();
+
+  // Other work is done here between the steps of a tap
+  handleSerialCommands();
+
+  // Between polls of idle readers, write the log and give up the CPU
+  unsigned long wait = scheduler.msUntilNextPoll();
+  if (wait > 0) {
+    results_log.sync();
+    delay(min(wait, (unsigned long) 10));
+  } else if (!scheduler.anyReady()) {
+    // Every reader is waiting for its card
+    delay(1);
   }
-  return NULL;
 }
 
-// Build Processing Data Options
-// In: A TLV node with tag 9f38. The value lists required Data Options. NULL is OK.
-// Out: data_operations filled with expected response
 //
-bool buildDataOptionsList(TLVNode* pdol_node, WriteBuffer& data_options) 
+// Card session task. Only this task touches the sessions, the caches
+// and the statistics. The PN532 driver waits with delay(), and the
+// async transport is polled with a delay between polls, which lets the
+// output task run during exchanges and card detection.
+//
+void sessionTask(void* param)
 {
-  ReadBuffer dol_list;
-
-  if (pdol_node != NULL) {
-      dol_list.buffer = pdol_node->getValue();
-      dol_list.buffer_size = pdol_node->getValueLength();
-  }
-
-  while (!dol_list.atEnd()) {
-    uint16_t tag;
-    uint8_t len;
-    int error_flag;
-
-    tag = TLVNode::parseTag(dol_list, &error_flag);
-    if (error_flag ||
-        !dol_list.getByte(len)) {
-          Serial.println("Failed reading dol_list");
-          return false;
-    }
-
-    DataOption* option = getDataOption(tag);
-    if (option == NULL) {
-      Serial.print("Don't have a requested option tag: ");
-      Serial.print(tag, HEX);
-      // Add with 0 values
-      while (len-- > 0) data_options.putByte(0);
-      continue;
-    }
-
-    // Copy value into PDOL buffer
-    // Truncate if our value is too long
-    int copy_len = min(option->value_length, len);
-    data_options.putBytes(option->value, copy_len);
-
-    // Report any mismatch length, handle need to pad value.
-    if (option->value_length != len) {
-      Serial.println("mismatched expectation on value length");
-      Serial.print(tag, HEX);
-      Serial.print(" requested len: ");
-      Serial.print(len);
-      Serial.print(" actual len: ");
-      Serial.println(option->value_length);
-
-      // Pad with zeros if it was too short
-      if (copy_len < len) {
-        len -= option->value_length;
-        while (len-- > 0) data_options.putByte(0);
-      }
-    }
+  mem_stats.track();
+  for (;;) {
+    runSession();
   }
-  return true;
 }
 
-
-/***  Step 3: Get Processing Options - get AFL  ***/
-
 //
-// Returns the Application Files Locator (ALF) for files used in the transaction
+// Drain the trace to the serial port. Only this task waits on the UART.
 //
-TLVNode* getProcessingOptions(TLVNode* pdol_node)
+void outputTask(void* param)
 {
-  Serial.println("*** GetProcessingOptions");
-  uint8_t selectApdu[] = {0x80,    /* CLA */
-                          0xA8,    /* INS */   // GET PROCESSING OPTIONS
-                          0x00,    /* P1  */
-                          0x00,    /* P2  */ };
-
-  WriteBuffer tx(tx_buffer, sizeof(tx_buffer));
-  tx.putBytes(selectApdu, sizeof(selectApdu));
-
-  WriteBuffer data_options(data_buffer, sizeof(data_buffer));
-  if (!buildDataOptionsList(pdol_node, data_options)) {
-    return NULL;
-  }
-
-  // Add PDOL
-  tx.putByte(data_options.pos + 2);
-  tx.putByte(0x83);
-  tx.putByte(data_options.pos);
-  tx.putBytes(data_options.buffer, data_options.pos);
-  tx.putByte(0);  // Le
-  printMessage(tx_buffer, (uint8_t) tx.pos);
-
-  uint8_t rxlength = sizeof(rx_buffer);
-  bool success = nfc.inDataExchange(tx.buffer, tx.pos, rx_buffer, &rxlength);
-
-  if (!success) {
-    Serial.println("Failed");
-    return NULL;
-  }
-
-  printResponse(rx_buffer, rxlength);
-
-  if (!checkApduResponse(rx_buffer, rxlength)) {
-    return NULL;
+  for (;;) {
+    if (output_queue.drain(Serial) == 0) {
+      delay(1);
+    }
   }
-  rxlength -= 2;
-
-  rx_tlvs.decodeTLVs(rx_buffer, rxlength);
-  printTLV(rx_tlvs.firstTLV());
-  TLVNode *node = rx_tlvs.findTLV(0x94);
-  return node;
 }
 
-
-/***  Step 4: Read Application Records ***/
-
-void readAppRecords(uint8_t sfi, uint8_t start, uint8_t end)
+void loop()
 {
-  Serial.println("*** Read app records");
-  Serial.print("SFI: ");
-  Serial.print(sfi);
-  Serial.print(", start: ");
-  Serial.print(start);
-  Serial.print(", end: ");
-  Serial.print(end);
-  Serial.println();
-
-  uint8_t readApdu[] = { 0x00,                                     /* CLA */
-                         0xB2,                                     /* INS */ };
-
-  for (uint8_t record = start; record <= end; record++) {
-    WriteBuffer tx(tx_buffer, sizeof(tx_buffer));
-    tx.putBytes(readApdu, sizeof(readApdu));
-    tx.putByte(record);
-    uint8_t p2 = sfi <<3 | 0b00000100;
-    tx.putByte(p2);
-    tx.putByte(0);  // Le
-    printMessage(tx_buffer, (uint8_t) tx.pos);
-    uint8_t rxlength = sizeof(rx_buffer);
-    bool success = nfc.inDataExchange(tx.buffer, tx.pos, rx_buffer, &rxlength);
-    if (!success) {
-      Serial.println("Read Application Record: Failed");
-      continue;
-    }
-
-    printResponse(rx_buffer, rxlength);
-
-    if (!checkApduResponse(rx_buffer, rxlength)) {
-      continue;
-    }
-    rxlength -= 2;
-    Serial.println();
-
-    rx_tlvs.decodeTLVs(rx_buffer, rxlength);
-    printTLV(rx_tlvs.firstTLV());
-    Serial.println();
-  }
+#ifdef OUTPUT_TASK
+  // The work is done in the session and output tasks
+  vTaskDelete(NULL);
+#else
+  runSession();
+#endif
 }
-
@@ -0,0 +1,344 @@
+//
+// Heap and stack use of the card sessions
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include <new>
+#include "mem_stats.h"
+#include "emv_format.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_heap_caps.h>
+#else
+#include <malloc.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#endif
+
+MemStats mem_stats;
+
+static uintptr_t currentThread()
+{
+#ifdef ARDUINO_ARCH_ESP32
+  return (uintptr_t) xTaskGetCurrentTaskHandle();
+#else
+  return (uintptr_t) pthread_self();
+#endif
+}
+
+MemStats::MemStats()
+  : owner(0), phase(MEM_OTHER), heap_held(0), step_heap_start(0), step_heap_peak(0),
+    stack_top(0), stack_low(0), strict(false)
+{
+  clear();
+}
+
+void MemStats::track()
+{
+  if (enabled()) {
+    owner = currentThread();
+  }
+}
+
+bool MemStats::isTracked() const
+{
+  return owner != 0 && owner == currentThread();
+}
+
+void MemStats::clear()
+{
+  memset(phases, 0, sizeof(phases));
+  stack_overflow = false;
+  violations = 0;
+  violation_phase = MEM_OTHER;
+  violation_size = 0;
+  violation_caller = NULL;
+}
+
+void MemStats::countAlloc(size_t size, size_t usable, void* caller)
+{
+  MemPhaseStats& stats = phases[phase];
+  stats.allocations++;
+  stats.bytes += size;
+  heap_held += usable;
+  if (heap_held > step_heap_peak) {
+    step_heap_peak = heap_held;
+  }
+
+  if (strict) {
+    if (violations == 0) {
+      violation_phase = phase;
+      violation_size = size;
+      violation_caller = caller;
+    }
+    violations++;
+  }
+}
+
+void MemStats::countFree(size_t usable)
+{
+  heap_held -= usable;
+}
+
+#ifdef MEM_TRACK
+
+//
+// Fill MEM_STACK_PAINT bytes below the caller with the pattern, and
+// return the lowest. Not inlined, so the area lies below the caller.
+//
+static void __attribute__((noinline)) paintStack(uintptr_t* low)
+{
+  volatile uint8_t area[MEM_STACK_PAINT];
+  for (int i = 0; i < MEM_STACK_PAINT; i++) {
+    area[i] = MEM_STACK_PATTERN;
+  }
+  *low = (uintptr_t) area;
+}
+
+void MemStats::beginStep(SessionState state)
+{
+  if (!isTracked()) {
+    return;
+  }
+  phase = state;
+  step_heap_start = heap_held;
+  step_heap_peak = heap_held;
+  stack_top = (uintptr_t) __builtin_frame_address(0);
+  paintStack(&stack_low);
+}
+
+void MemStats::endStep()
+{
+  if (!isTracked() || phase == MEM_OTHER) {
+    return;
+  }
+  MemPhaseStats& stats = phases[phase];
+  stats.steps++;
+  stats.held += heap_held - step_heap_start;
+  stats.peak_heap = max(stats.peak_heap, (size_t) (step_heap_peak - step_heap_start));
+
+  // The stack grows down: find the deepest byte the step changed
+  const volatile uint8_t* painted = (const volatile uint8_t*) stack_low;
+  int untouched = 0;
+  while (untouched < MEM_STACK_PAINT && painted[untouched] == MEM_STACK_PATTERN) {
+    untouched++;
+  }
+  if (untouched == 0) {
+    stack_overflow = true;
+  }
+  stats.peak_stack = max(stats.peak_stack, (size_t) (stack_top - (stack_low + untouched)));
+  phase = MEM_OTHER;
+}
+
+/*** Allocation hooks ***/
+
+static size_t usableSize(void* p)
+{
+#ifdef ARDUINO_ARCH_ESP32
+  return heap_caps_get_allocated_size(p);
+#else
+  return malloc_usable_size(p);
+#endif
+}
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+void __real_free(void* p);
+
+void* __wrap_malloc(size_t size)
+{
+  void* p = __real_malloc(size);
+  if (p != NULL && mem_stats.isTracked()) {
+    mem_stats.countAlloc(size, usableSize(p), __builtin_return_address(0));
+  }
+  return p;
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+  void* p = __real_calloc(count, size);
+  if (p != NULL && mem_stats.isTracked()) {
+    mem_stats.countAlloc(count * size, usableSize(p), __builtin_return_address(0));
+  }
+  return p;
+}
+
+void* __wrap_realloc(void* old, size_t size)
+{
+  bool tracked = mem_stats.isTracked();
+  size_t old_usable = old != NULL && tracked ? usableSize(old) : 0;
+  void* p = __real_realloc(old, size);
+  if (!tracked || (p == NULL && size != 0)) {
+    // Failed, the old block is kept
+    return p;
+  }
+  mem_stats.countFree(old_usable);
+  if (p != NULL) {
+    mem_stats.countAlloc(size, usableSize(p), __builtin_return_address(0));
+  }
+  return p;
+}
+
+void __wrap_free(void* p)
+{
+  if (p != NULL && mem_stats.isTracked()) {
+    mem_stats.countFree(usableSize(p));
+  }
+  __real_free(p);
+}
+
+}
+
+// operator new charged to its caller, not to operator new
+static void* allocate(size_t size, void* caller)
+{
+  void* p = __real_malloc(size != 0 ? size : 1);
+  if (p != NULL && mem_stats.isTracked()) {
+    mem_stats.countAlloc(size, usableSize(p), caller);
+  }
+  return p;
+}
+
+static void* allocateOrFail(size_t size, void* caller)
+{
+  void* p = allocate(size, caller);
+  if (p == NULL) {
+#if __cpp_exceptions
+    throw std::bad_alloc();
+#else
+    abort();
+#endif
+  }
+  return p;
+}
+
+void* operator new(size_t size)
+{
+  return allocateOrFail(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size)
+{
+  return allocateOrFail(size, __builtin_return_address(0));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size, __builtin_return_address(0));
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+  free(p);
+}
+
+#endif /* MEM_TRACK */
+
+static const char* phaseName(int phase)
+{
+  return phase == MEM_OTHER ? "other" : CardSession::stateName((SessionState) phase);
+}
+
+// Signed, right aligned in width
+static void putSigned(long value, int width)
+{
+  if (value >= 0) {
+    trace_out.putDec(value, width);
+    return;
+  }
+  unsigned long magnitude = -value;
+  int digits = 1;
+  for (unsigned long rest = magnitude; rest >= 10; rest /= 10) {
+    digits++;
+  }
+  trace_out.putSpaces(width - digits - 1);
+  trace_out.putChar('-');
+  trace_out.putDec(magnitude);
+}
+
+void MemStats::print()
+{
+  trace_out.putStr("Memory: heap held by the session thread ");
+  putSigned(heap_held, 0);
+  trace_out.putLine(" bytes");
+#ifdef ARDUINO_ARCH_ESP32
+  trace_out.putStr("Heap free ");
+  trace_out.putDec(heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+  trace_out.putStr(", lowest ");
+  trace_out.putDec(heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+  trace_out.putStr(", largest block ");
+  trace_out.putDec(heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+  trace_out.putStr(", task stack never used ");
+  trace_out.putDec(uxTaskGetStackHighWaterMark(NULL));
+  trace_out.putLine();
+#endif
+
+  trace_out.putLine("state           steps    allocs     bytes      held peak heap peak stack");
+  for (int i = 0; i <= MEM_OTHER; i++) {
+    const MemPhaseStats& stats = phases[i];
+    const char* name = phaseName(i);
+    trace_out.putStr(name);
+    trace_out.putSpaces(12 - strlen(name));
+    trace_out.putDec(stats.steps, 9);
+    trace_out.putDec(stats.allocations, 10);
+    trace_out.putDec(stats.bytes, 10);
+    putSigned(stats.held, 10);
+    trace_out.putDec(stats.peak_heap, 10);
+    trace_out.putDec(stats.peak_stack, 11);
+    trace_out.putLine();
+  }
+  if (stack_overflow) {
+    trace_out.putStr("A step used more than the ");
+    trace_out.putDec(MEM_STACK_PAINT);
+    trace_out.putLine(" bytes of stack painted, raise MEM_STACK_PAINT");
+  }
+
+  if (strict || violations > 0) {
+    trace_out.putStr("Strict: ");
+    trace_out.putDec(violations);
+    trace_out.putStr(" allocations");
+    if (violations > 0) {
+      trace_out.putStr(", the first of ");
+      trace_out.putDec(violation_size);
+      trace_out.putStr(" bytes in ");
+      trace_out.putStr(phaseName(violation_phase));
+      trace_out.putStr(" from 0x");
+      uintptr_t address = (uintptr_t) violation_caller;
+#ifndef ARDUINO_ARCH_ESP32
+      // Relative to the program, for addr2line
+      Dl_info info;
+      if (dladdr(violation_caller, &info) != 0) {
+        address -= (uintptr_t) info.dli_fbase;
+      }
+#endif
+      trace_out.putHex(address);
+    }
+    trace_out.putLine();
+  }
+  trace_out.flush();
+}
@@ -0,0 +1,117 @@
+#ifndef __MEM_STATS_H__
+#define __MEM_STATS_H__
+#include <stdint.h>
+#include <stddef.h>
+#include "card_session.h"
+
+//
+// Heap and stack use of the card sessions
+//
+// Built with MEM_TRACK, malloc, calloc, realloc, free and the global
+// operator new and delete are hooked. The hooks count the calls made
+// by one thread or task, the one that called track() and runs the
+// sessions, and charge them to the session state of the step in
+// progress. Allocations made outside a step go to "other".
+//
+// The hooks need the linker to send malloc and friends to them:
+//   -DMEM_TRACK -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free
+// The lolin_s2_mini_memcheck and native_sim_memcheck environments in
+// platformio.ini set both. Calls made inside the C library or ROM are
+// not seen.
+//
+// For each state the stats keep the allocations and bytes asked for,
+// the most heap a step held above what it started with, what steps
+// left held when they ended, and the stack high water. The stack is
+// measured by filling MEM_STACK_PAINT bytes below the caller of the
+// step with a pattern, and finding the deepest byte the step changed.
+//
+// In strict mode any allocation by the tracked thread is a violation.
+// Once the first taps have warmed up, the tap loop must not allocate.
+//
+// Without MEM_TRACK the step calls are empty and nothing is counted.
+//
+
+// Bytes of stack painted below each step
+#ifndef MEM_STACK_PAINT
+#define MEM_STACK_PAINT 4096
+#endif
+
+#define MEM_STACK_PATTERN 0xA5
+
+// Index for allocations outside a step
+#define MEM_OTHER NUM_SESSION_STATES
+
+struct MemPhaseStats {
+  unsigned long steps;
+  unsigned long allocations;  // malloc, calloc, realloc and new calls
+  unsigned long bytes;        // Bytes asked for
+  long held;                  // Heap still held at the end of the steps
+  size_t peak_heap;           // Most heap a step held above its start
+  size_t peak_stack;          // Deepest stack use of a step
+};
+
+class MemStats {
+public:
+  MemStats();
+
+  // Count the allocations of the calling thread or task
+  void track();
+
+  // True if built with MEM_TRACK
+  static constexpr bool enabled()
+  {
+#ifdef MEM_TRACK
+    return true;
+#else
+    return false;
+#endif
+  }
+
+#ifdef MEM_TRACK
+  // Around each session step, in the tracked thread
+  void beginStep(SessionState state);
+  void endStep();
+#else
+  void beginStep(SessionState /* state */) {}
+  void endStep() {}
+#endif
+
+  // Heap held by the tracked thread, since track()
+  long getHeapHeld() const { return heap_held; }
+
+  // Count every allocation from now on as a violation
+  void setStrict(bool on) { strict = on; }
+  unsigned long getViolations() const { return violations; }
+
+  void clear();
+
+  // Print the table of states, and the violations in strict mode
+  void print();
+
+  // From the allocation hooks
+  void countAlloc(size_t size, size_t usable, void* caller);
+  void countFree(size_t usable);
+  bool isTracked() const;
+
+  MemPhaseStats phases[NUM_SESSION_STATES + 1];
+
+private:
+  uintptr_t owner;            // Tracked thread or task, 0 for none
+  int phase;                  // State of the step in progress, or MEM_OTHER
+  long heap_held;             // Heap held by the tracked thread
+  long step_heap_start;
+  long step_heap_peak;
+  uintptr_t stack_top;        // Frame the step was started from
+  uintptr_t stack_low;        // Lowest painted byte
+  bool stack_overflow;        // A step went below the painted bytes
+
+  bool strict;
+  unsigned long violations;
+  int violation_phase;        // Where the first violation was
+  size_t violation_size;
+  void* violation_caller;
+};
+
+extern MemStats mem_stats;
+
+#endif /* __MEM_STATS_H__ */
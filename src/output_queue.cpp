@@ -0,0 +1,77 @@
+//
+// Queue between the card session and the serial port
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include "output_queue.h"
+#include "emv_format.h"
+
+OutputQueue output_queue;
+
+OutputQueue::OutputQueue(QueuePolicy policy)
+  : policy(policy)
+{
+  clearStats();
+}
+
+void OutputQueue::clearStats()
+{
+  writes = 0;
+  dropped_writes = 0;
+  dropped_bytes = 0;
+  high_water = 0;
+}
+
+size_t OutputQueue::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t OutputQueue::write(const uint8_t* buffer, size_t size)
+{
+  writes++;
+  while (!ring.push(buffer, size)) {
+    // Waiting can't help a write bigger than the whole queue
+    if (policy == QUEUE_DROP || size > ring.capacity()) {
+      dropped_writes++;
+      dropped_bytes += size;
+      return 0;
+    }
+    delay(1);
+  }
+
+  size_t used = ring.used();
+  if (used > high_water) {
+    high_water = used;
+  }
+  return size;
+}
+
+size_t OutputQueue::drain(Print& out)
+{
+  uint8_t chunk[64];
+  size_t total = 0;
+  size_t length;
+  while ((length = ring.pop(chunk, sizeof(chunk))) > 0) {
+    out.write(chunk, length);
+    total += length;
+  }
+  return total;
+}
+
+void OutputQueue::printStats()
+{
+  trace_out.putStr("Output queue: writes ");
+  trace_out.putDec(writes);
+  trace_out.putStr(", dropped ");
+  trace_out.putDec(dropped_writes);
+  trace_out.putStr(" (");
+  trace_out.putDec(dropped_bytes);
+  trace_out.putStr(" bytes), high water ");
+  trace_out.putDec(high_water);
+  trace_out.putStr(" of ");
+  trace_out.putDec(ring.capacity());
+  trace_out.putLine(" bytes");
+  trace_out.flush();
+}
@@ -0,0 +1,67 @@
+#ifndef __OUTPUT_QUEUE_H__
+#define __OUTPUT_QUEUE_H__
+#include <Arduino.h>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+//
+// Queue between the card session and the serial port
+//
+// The session writes its trace here instead of to Serial, and another
+// task drains the queue to the port. A full UART then delays only the
+// output task, never an exchange with the card in the field.
+//
+// Each write is queued whole or not at all. With QUEUE_DROP (the
+// default) a write that doesn't fit is dropped and counted, so the
+// writer never waits. QUEUE_WAIT waits for room instead, for output
+// that must not be lost, such as a host run compared with a reference.
+//
+// Binary trace frames are written in one piece, so a dropped frame
+// shows up as a gap in the sequence numbers, and trace_decode reports it.
+//
+
+#ifndef OUTPUT_QUEUE_SIZE
+#define OUTPUT_QUEUE_SIZE 8192
+#endif
+
+enum QueuePolicy {
+  QUEUE_DROP,     // Drop what doesn't fit
+  QUEUE_WAIT      // Wait for the consumer to make room
+};
+
+class OutputQueue : public Print {
+public:
+  OutputQueue(QueuePolicy policy = QUEUE_DROP);
+
+  // Producer side
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  // Consumer side: move everything waiting to out. Return the bytes moved.
+  size_t drain(Print& out);
+  bool isEmpty() const { return ring.used() == 0; }
+
+  void setPolicy(QueuePolicy policy) { this->policy = policy; }
+
+  // Counters are kept by the producer, print and clear them from there
+  void clearStats();
+  void printStats();
+  unsigned long getWrites() const { return writes; }
+  unsigned long getDroppedWrites() const { return dropped_writes; }
+  unsigned long getDroppedBytes() const { return dropped_bytes; }
+  size_t getHighWater() const { return high_water; }
+
+private:
+  SpscRing<OUTPUT_QUEUE_SIZE> ring;
+  QueuePolicy policy;
+
+  unsigned long writes;
+  unsigned long dropped_writes;
+  unsigned long dropped_bytes;
+  size_t high_water;          // Most bytes waiting after a write
+};
+
+extern OutputQueue output_queue;
+
+#endif /* __OUTPUT_QUEUE_H__ */
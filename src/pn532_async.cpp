@@ -0,0 +1,388 @@
+//
+// PN532 transport driven by the IRQ line, with SPI DMA transfers
+//
+// Copyright (c) 2025 James Wanderer
+//
+// Frame format, from the PN532 user manual:
+//   00 00 FF LEN LCS TFI command data... DCS 00
+// LCS makes LEN + LCS zero, DCS makes TFI + command + data + DCS zero.
+// Over SPI each transfer starts with a byte saying what it is, and the
+// bits go least significant first.
+//
+// DMA moves whole words. A transfer from a buffer that isn't word
+// aligned, or of a length that isn't a multiple of 4, is copied through
+// a bounce buffer ESP-IDF allocates for it. So the frames are kept in
+// aligned buffers with room to spare, and transfers are padded to a
+// multiple of 4 bytes: zeros after a command frame are read by the
+// PN532 as the preamble of the next, and bytes read past the end of a
+// response are ignored.
+//
+
+#include "pn532_async.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+
+// SPI transfer types
+#define SPI_DATA_WRITE 0x01
+#define SPI_DATA_READ 0x03
+
+// Frame identifiers
+#define TFI_HOST_TO_PN532 0xD4
+#define TFI_PN532_TO_HOST 0xD5
+
+// Commands
+#define CMD_IN_DATA_EXCHANGE 0x40
+#define CMD_IN_LIST_PASSIVE_TARGET 0x4A
+
+static const uint8_t ack_frame[] = { 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00 };
+
+// Transfer length rounded up to whole words
+#define DMA_LENGTH(length) (((length) + 3) & ~3)
+
+PN532AsyncTransport::PN532AsyncTransport(spi_host_device_t host, int sck, int miso, int mosi,
+                                         int ss, int irq)
+  : host(host), sck(sck), miso(miso), mosi(mosi), ss(ss), irq(irq),
+    spi(NULL), irq_semaphore(NULL), detect_timeout_ms(1000), state(IDLE), command(0),
+    command_start(0), command_timeout_ms(PN532_EXCHANGE_TIMEOUT_MS), irq_released(true),
+    rx(NULL), rx_size(0), received(0), last_error(LINK_OK), uid_length(0)
+{
+}
+
+bool PN532AsyncTransport::begin()
+{
+  irq_semaphore = xSemaphoreCreateBinary();
+  if (irq_semaphore == NULL) {
+    return false;
+  }
+
+  // Chip select is driven by hand, to hold it across the transfers of a frame
+  pinMode(ss, OUTPUT);
+  digitalWrite(ss, HIGH);
+  pinMode(irq, INPUT_PULLUP);
+  attachInterruptArg(irq, onIrq, this, FALLING);
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = mosi;
+  bus.miso_io_num = miso;
+  bus.sclk_io_num = sck;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = sizeof(rx_frame);
+  // The bus is shared by all the heads, the first one sets it up
+  esp_err_t err = spi_bus_initialize(host, &bus, SPI_DMA_CH_AUTO);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    return false;
+  }
+
+  spi_device_interface_config_t device = {};
+  device.mode = 0;
+  device.clock_speed_hz = PN532_SPI_CLOCK_HZ;
+  device.spics_io_num = -1;
+  device.queue_size = 1;
+  device.flags = SPI_DEVICE_BIT_LSBFIRST;
+  return spi_bus_add_device(host, &device, &spi) == ESP_OK;
+}
+
+void IRAM_ATTR PN532AsyncTransport::onIrq(void* arg)
+{
+  PN532AsyncTransport* transport = (PN532AsyncTransport*) arg;
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(transport->irq_semaphore, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+//
+// Move length bytes, padded to a whole word. tx and rx are word aligned,
+// with room for the padding.
+//
+bool PN532AsyncTransport::spiTransfer(const uint8_t* tx, uint8_t* rx, size_t length)
+{
+  spi_transaction_t transaction = {};
+  transaction.length = DMA_LENGTH(length) * 8;
+  transaction.tx_buffer = tx;
+  transaction.rx_buffer = rx;
+  // Blocks this task, not the CPU, until the DMA transfer is done
+  return spi_device_transmit(spi, &transaction) == ESP_OK;
+}
+
+//
+// Check whether the PN532 has a frame ready. IRQ can still be low from
+// the ACK for a while after reading it, so once the ACK is in, low only
+// counts after IRQ has been seen high or a new falling edge has come in.
+//
+bool PN532AsyncTransport::irqReady()
+{
+  if (!irq_released) {
+    if (digitalRead(irq) != HIGH && xSemaphoreTake(irq_semaphore, 0) != pdTRUE) {
+      return false;
+    }
+    irq_released = true;
+  }
+  return digitalRead(irq) == LOW;
+}
+
+//
+// Wait for the PN532 to pull IRQ low. Return false on timeout.
+//
+bool PN532AsyncTransport::waitReady(unsigned long timeout_ms)
+{
+  unsigned long start = millis();
+  while (!irqReady()) {
+    unsigned long elapsed = millis() - start;
+    if (elapsed >= timeout_ms) {
+      return false;
+    }
+    if (xSemaphoreTake(irq_semaphore, pdMS_TO_TICKS(timeout_ms - elapsed)) == pdTRUE) {
+      irq_released = true;
+    }
+  }
+  return true;
+}
+
+//
+// Send a command frame: command, params, then data
+//
+bool PN532AsyncTransport::startCommand(uint8_t command, const uint8_t* params, uint8_t params_length,
+                                       const uint8_t* data, uint8_t data_length)
+{
+  int length = 2 + params_length + data_length;
+  last_error = LINK_PROTOCOL;
+  if (state != IDLE || spi == NULL || length > 255) {
+    return false;
+  }
+
+  int n = 0;
+  tx_frame[n++] = SPI_DATA_WRITE;
+  tx_frame[n++] = 0x00;
+  tx_frame[n++] = 0x00;
+  tx_frame[n++] = 0xFF;
+  tx_frame[n++] = length;
+  tx_frame[n++] = ~length + 1;
+  int body = n;
+  tx_frame[n++] = TFI_HOST_TO_PN532;
+  tx_frame[n++] = command;
+  memcpy(&tx_frame[n], params, params_length);
+  n += params_length;
+  memcpy(&tx_frame[n], data, data_length);
+  n += data_length;
+  uint8_t sum = 0;
+  for (int i = body; i < n; i++) {
+    sum += tx_frame[i];
+  }
+  tx_frame[n++] = ~sum + 1;
+  tx_frame[n++] = 0x00;
+  memset(&tx_frame[n], 0x00, DMA_LENGTH(n) - n);
+
+  // Forget interrupts from before this command
+  xSemaphoreTake(irq_semaphore, 0);
+  irq_released = true;
+
+  digitalWrite(ss, LOW);
+  delay(1);   // Wake up time, as the blocking driver allows
+  bool sent = spiTransfer(tx_frame, NULL, n);
+  digitalWrite(ss, HIGH);
+  if (!sent) {
+    return false;
+  }
+
+  this->command = command;
+  command_start = millis();
+  received = 0;
+  last_error = LINK_OK;
+  state = WAIT_ACK;
+  return true;
+}
+
+bool PN532AsyncTransport::readAck()
+{
+  memset(tx_frame, 0, DMA_LENGTH(1 + sizeof(ack_frame)));
+  tx_frame[0] = SPI_DATA_READ;
+  digitalWrite(ss, LOW);
+  bool ok = spiTransfer(tx_frame, rx_frame, 1 + sizeof(ack_frame));
+  digitalWrite(ss, HIGH);
+  return ok && memcmp(&rx_frame[1], ack_frame, sizeof(ack_frame)) == 0;
+}
+
+bool PN532AsyncTransport::readResponse()
+{
+  // Preamble, start code, LEN, LCS, TFI and command, then the rest of
+  // the body with DCS and postamble. Both transfers are whole words.
+  memset(tx_frame, 0, sizeof(tx_frame));
+  tx_frame[0] = SPI_DATA_READ;
+  digitalWrite(ss, LOW);
+  bool ok = spiTransfer(tx_frame, rx_frame, 8);
+  uint8_t length = rx_frame[4];
+  ok = ok && rx_frame[1] == 0x00 && rx_frame[2] == 0x00 && rx_frame[3] == 0xFF &&
+       (uint8_t) (length + rx_frame[5]) == 0 && length >= 3;
+  uint8_t* body = &rx_frame[6];
+  ok = ok && spiTransfer(tx_frame + 8, rx_frame + 8, length);
+  digitalWrite(ss, HIGH);
+  last_error = LINK_PROTOCOL;
+  if (!ok) {
+    return false;
+  }
+
+  uint8_t sum = 0;
+  for (int i = 0; i <= length; i++) {
+    sum += body[i];
+  }
+  if (sum != 0 || body[0] != TFI_PN532_TO_HOST || body[1] != command + 1) {
+    return false;
+  }
+
+  if (command == CMD_IN_DATA_EXCHANGE) {
+    // Status, then the response APDU
+    int data_length = length - 3;
+    if ((body[2] & 0x3F) != 0) {
+      last_error = statusError(body[2] & 0x3F);
+      return false;
+    }
+    if (data_length > rx_size) {
+      return false;
+    }
+    memcpy(rx, &body[3], data_length);
+    received = data_length;
+    last_error = LINK_OK;
+    return true;
+  }
+
+  if (command == CMD_IN_LIST_PASSIVE_TARGET) {
+    // Targets found, target number, SENS_RES, SEL_RES, NFCID length, NFCID
+    if (body[2] == 0 || length < 8 || body[7] > sizeof(uid) || 8 + body[7] > length) {
+      return false;
+    }
+    uid_length = body[7];
+    memcpy(uid, &body[8], uid_length);
+    last_error = LINK_OK;
+    return true;
+  }
+  return false;
+}
+
+//
+// Error class for an InDataExchange status code, from the PN532 user manual
+//
+LinkError PN532AsyncTransport::statusError(uint8_t status)
+{
+  switch (status) {
+    case 0x01:    // The target didn't answer
+      return LINK_TIMEOUT;
+    case 0x29:    // Target released
+    case 0x2A:    // A different card answered
+    case 0x2B:    // The card activated before has gone
+      return LINK_CARD_REMOVED;
+    default:      // CRC, parity, framing, ISO-DEP format...
+      return LINK_PROTOCOL;
+  }
+}
+
+//
+// Stop the PN532 waiting on the card. An ACK frame from the host aborts
+// the command in progress.
+//
+void PN532AsyncTransport::abort()
+{
+  memset(tx_frame, 0, DMA_LENGTH(1 + sizeof(ack_frame)));
+  tx_frame[0] = SPI_DATA_WRITE;
+  memcpy(&tx_frame[1], ack_frame, sizeof(ack_frame));
+  digitalWrite(ss, LOW);
+  spiTransfer(tx_frame, NULL, 1 + sizeof(ack_frame));
+  digitalWrite(ss, HIGH);
+}
+
+//
+// Read the ACK or the response if the PN532 has one ready
+//
+void PN532AsyncTransport::advance()
+{
+  if ((state != WAIT_ACK && state != WAIT_RESPONSE) || !irqReady()) {
+    return;
+  }
+  if (state == WAIT_ACK) {
+    // Drop the ACK's edge, so only the response's edge is left to see
+    xSemaphoreTake(irq_semaphore, 0);
+    state = readAck() ? WAIT_RESPONSE : FAILED;
+    irq_released = false;
+    if (state == FAILED) {
+      last_error = LINK_PROTOCOL;
+    }
+  } else {
+    state = readResponse() ? DONE : FAILED;
+  }
+}
+
+bool PN532AsyncTransport::submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size)
+{
+  static const uint8_t target = 1;
+  this->rx = rx;
+  this->rx_size = rx_size;
+  command_timeout_ms = PN532_EXCHANGE_TIMEOUT_MS;
+  return startCommand(CMD_IN_DATA_EXCHANGE, &target, 1, tx, tx_length);
+}
+
+bool PN532AsyncTransport::submitDetect()
+{
+  // One type A target at 106 kbps. The PN532 keeps trying until a
+  // card answers or the command is aborted.
+  static const uint8_t params[] = { 0x01, 0x00 };
+  uid_length = 0;
+  rx = NULL;
+  rx_size = 0;
+  command_timeout_ms = detect_timeout_ms;
+  return startCommand(CMD_IN_LIST_PASSIVE_TARGET, params, sizeof(params), NULL, 0);
+}
+
+bool PN532AsyncTransport::poll()
+{
+  advance();
+  return (state != WAIT_ACK && state != WAIT_RESPONSE) ||
+         millis() - command_start >= command_timeout_ms;
+}
+
+bool PN532AsyncTransport::complete(uint8_t* rx_length)
+{
+  for (;;) {
+    advance();
+    if (state != WAIT_ACK && state != WAIT_RESPONSE) {
+      break;
+    }
+    unsigned long elapsed = millis() - command_start;
+    if (elapsed >= command_timeout_ms || !waitReady(command_timeout_ms - elapsed)) {
+      abort();
+      state = FAILED;
+      last_error = LINK_TIMEOUT;
+      break;
+    }
+  }
+
+  bool result = state == DONE;
+  *rx_length = result ? received : 0;
+  state = IDLE;
+  return result;
+}
+
+bool PN532AsyncTransport::transceive(const uint8_t* tx, uint8_t tx_length,
+                                     uint8_t* rx, uint8_t* rx_length)
+{
+  return submit(tx, tx_length, rx, *rx_length) && complete(rx_length);
+}
+
+bool PN532AsyncTransport::detectCard()
+{
+  uint8_t length;
+  return submitDetect() && complete(&length);
+}
+
+bool PN532AsyncTransport::getCardUID(uint8_t* uid, uint8_t* uid_length)
+{
+  if (this->uid_length == 0 || this->uid_length > *uid_length) {
+    return false;
+  }
+  memcpy(uid, this->uid, this->uid_length);
+  *uid_length = this->uid_length;
+  return true;
+}
+
+#endif /* ARDUINO_ARCH_ESP32 */
@@ -0,0 +1,106 @@
+#ifndef __PN532_ASYNC_H__
+#define __PN532_ASYNC_H__
+#include <Arduino.h>
+#include <stdint.h>
+#include "card_transport.h"
+
+//
+// PN532 transport driven by the IRQ line, with SPI DMA transfers
+//
+// The PN532 pulls IRQ low when it has an ACK or a response ready. The
+// blocking driver polls the status byte over SPI until then. This
+// transport sleeps on a semaphore given by the IRQ interrupt instead,
+// so the CPU is free to run other tasks for the tens of ms a card
+// takes. Frames are moved with ESP-IDF SPI master transactions, which
+// use DMA.
+//
+// submit() and submitDetect() send the command and return. poll()
+// reads whatever is ready without waiting, so one task can keep
+// exchanges going on several readers, and complete() waits for the ACK
+// and the response. An exchange is given PN532_EXCHANGE_TIMEOUT_MS,
+// detection the detect timeout; then poll() says it is finished and
+// complete() aborts it. transceive() and detectCard() are a submit
+// followed by complete().
+//
+// The PN532 is set up (SAMConfig, retries) with the blocking driver
+// first. begin() then takes over the SPI bus. Needs the PN532 IRQ pin
+// wired to a GPIO. ESP32 only.
+//
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <driver/spi_master.h>
+#include <freertos/semphr.h>
+
+#define PN532_SPI_CLOCK_HZ 5000000
+#define PN532_MAX_FRAME 262             // Preamble to postamble, normal frame
+#define PN532_EXCHANGE_TIMEOUT_MS 1000
+
+class PN532AsyncTransport : public CardTransport {
+public:
+  PN532AsyncTransport(spi_host_device_t host, int sck, int miso, int mosi, int ss, int irq);
+
+  // Claim the SPI bus and the IRQ pin. Return false if that failed.
+  bool begin();
+
+  // Time to wait for a card in detectCard()
+  void setDetectTimeout(uint16_t timeout_ms) { detect_timeout_ms = timeout_ms; }
+
+  bool detectCard();
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length);
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length);
+  LinkError getLastError() { return last_error; }
+
+  bool submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size);
+  bool submitDetect();
+  bool poll();
+  bool complete(uint8_t* rx_length);
+
+private:
+  enum State {
+    IDLE,
+    WAIT_ACK,         // Command sent
+    WAIT_RESPONSE,    // ACK received
+    DONE,
+    FAILED
+  };
+
+  bool startCommand(uint8_t command, const uint8_t* params, uint8_t params_length,
+                    const uint8_t* data, uint8_t data_length);
+  void advance();
+  bool irqReady();
+  bool readAck();
+  bool readResponse();
+  bool waitReady(unsigned long timeout_ms);
+  void abort();
+  bool spiTransfer(const uint8_t* tx, uint8_t* rx, size_t length);
+  static LinkError statusError(uint8_t status);
+  static void IRAM_ATTR onIrq(void* arg);
+
+  spi_host_device_t host;
+  int sck, miso, mosi, ss, irq;
+  spi_device_handle_t spi;
+  SemaphoreHandle_t irq_semaphore;
+  unsigned long detect_timeout_ms;
+
+  State state;
+  uint8_t command;          // PN532 command in progress
+  unsigned long command_start;
+  unsigned long command_timeout_ms;
+  bool irq_released;        // IRQ has risen or fallen again since the ACK
+  uint8_t* rx;              // Caller's buffer for the exchange data
+  uint8_t rx_size;
+  uint8_t received;          // Bytes copied to rx
+  LinkError last_error;
+
+  uint8_t uid[10];
+  uint8_t uid_length;
+
+  // DMA buffers, word aligned, with room for a frame padded to whole
+  // words. The transport must be in internal RAM (a global, not PSRAM)
+  // for them to be DMA capable.
+  uint8_t tx_frame[PN532_MAX_FRAME + 8] __attribute__((aligned(4)));
+  uint8_t rx_frame[PN532_MAX_FRAME + 8] __attribute__((aligned(4)));
+};
+
+#endif /* ARDUINO_ARCH_ESP32 */
+#endif /* __PN532_ASYNC_H__ */
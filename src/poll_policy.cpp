@@ -0,0 +1,64 @@
+//
+// Adaptive card detection polling for one reader
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "poll_policy.h"
+
+// Backoff steps from the min to the max interval
+static uint8_t maxBackoff()
+{
+  uint8_t steps = 1;
+  while (((unsigned long) POLL_MIN_INTERVAL_MS << (steps - 1)) < POLL_MAX_INTERVAL_MS) {
+    steps++;
+  }
+  return steps;
+}
+
+PollPolicy::PollPolicy()
+  : busy_timeout(POLL_BUSY_TIMEOUT_MS), idle_timeout(POLL_IDLE_TIMEOUT_MS)
+{
+  reset();
+}
+
+void PollPolicy::setTimeouts(uint16_t busy_ms, uint16_t idle_ms)
+{
+  busy_timeout = busy_ms;
+  idle_timeout = min(idle_ms, busy_ms);
+}
+
+void PollPolicy::reset()
+{
+  // Start busy, a card may be waiting at power on
+  backoff = 0;
+  last_card = millis();
+}
+
+unsigned long PollPolicy::getInterval() const
+{
+  if (backoff == 0) {
+    return 0;
+  }
+  return min((unsigned long) POLL_MIN_INTERVAL_MS << (backoff - 1),
+             (unsigned long) POLL_MAX_INTERVAL_MS);
+}
+
+uint16_t PollPolicy::getTimeout() const
+{
+  return backoff == 0 ? busy_timeout : idle_timeout;
+}
+
+void PollPolicy::cardFound(unsigned long now_ms)
+{
+  backoff = 0;
+  last_card = now_ms;
+}
+
+void PollPolicy::nothingFound(unsigned long now_ms)
+{
+  if (now_ms - last_card >= POLL_BUSY_WINDOW_MS && backoff < maxBackoff()) {
+    backoff++;
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef __POLL_POLICY_H__
+#define __POLL_POLICY_H__
+#include <stdint.h>
+
+//
+// Adaptive card detection polling for one reader
+//
+// Looking for a card costs power, since the RF field is on while the
+// PN532 searches, and time, since detectCard() blocks for its timeout
+// when no card is there. How often and how long to look depends on
+// how recently the reader was used.
+//
+// For POLL_BUSY_WINDOW_MS after a new card the reader is busy: it
+// polls again at once, with the long timeout, so the next card is
+// found as soon as it arrives. After that each poll that finds no new
+// card doubles the wait before the next, from POLL_MIN_INTERVAL_MS up
+// to POLL_MAX_INTERVAL_MS, and the timeout drops to the short one.
+// The wait bounds the time to detect a card when idle.
+//
+// The transport bounds the PN532's own search by the timeout too: the
+// blocking one sets the activation retries from it, the IRQ driven one
+// aborts the command when it runs out.
+//
+
+#ifndef POLL_BUSY_WINDOW_MS
+#define POLL_BUSY_WINDOW_MS 10000
+#endif
+#ifndef POLL_MIN_INTERVAL_MS
+#define POLL_MIN_INTERVAL_MS 20
+#endif
+#ifndef POLL_MAX_INTERVAL_MS
+#define POLL_MAX_INTERVAL_MS 320
+#endif
+#ifndef POLL_BUSY_TIMEOUT_MS
+#define POLL_BUSY_TIMEOUT_MS 1000
+#endif
+#ifndef POLL_IDLE_TIMEOUT_MS
+#define POLL_IDLE_TIMEOUT_MS 30
+#endif
+
+class PollPolicy {
+public:
+  PollPolicy();
+
+  // Detect timeouts when busy and when idle
+  void setTimeouts(uint16_t busy_ms, uint16_t idle_ms);
+
+  // Time to wait after a poll before the next, in ms
+  unsigned long getInterval() const;
+
+  // Detect timeout for the next poll, in ms
+  uint16_t getTimeout() const;
+
+  bool isBusy() const { return backoff == 0; }
+
+  // Result of a poll: a new card, or nothing new (no card, or one
+  // already read)
+  void cardFound(unsigned long now_ms);
+  void nothingFound(unsigned long now_ms);
+
+  // Start over as idle
+  void reset();
+
+private:
+  uint8_t backoff;          // 0 when busy, else the interval is MIN << (backoff - 1)
+  unsigned long last_card;
+  uint16_t busy_timeout;
+  uint16_t idle_timeout;
+};
+
+#endif /* __POLL_POLICY_H__ */
@@ -0,0 +1,251 @@
+//
+// Round-robin scheduler for several card readers
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "reader_scheduler.h"
+#include "emv_format.h"
+#include "trace_level.h"
+
+ReaderScheduler::ReaderScheduler()
+  : num_readers(0), next(0), last_stepped(-1), results_log(NULL)
+{
+  clearStats();
+}
+
+int ReaderScheduler::addReader(CardSession& session)
+{
+  if (num_readers == MAX_READERS) {
+    return -1;
+  }
+  sessions[num_readers] = &session;
+  memset(&stats[num_readers], 0, sizeof(ReaderStats));
+  tap_detect_ms[num_readers] = 0;
+  tap_exchanges[num_readers] = 0;
+  polls[num_readers].reset();
+  last_detect[num_readers] = millis() - SCHEDULER_DETECT_INTERVAL_MS;
+  last_miss[num_readers] = millis();
+  return num_readers++;
+}
+
+void ReaderScheduler::setDetectTimeouts(uint16_t busy_ms, uint16_t idle_ms)
+{
+  for (int i = 0; i < MAX_READERS; i++) {
+    polls[i].setTimeouts(busy_ms, idle_ms);
+  }
+}
+
+void ReaderScheduler::clearStats()
+{
+  memset(stats, 0, sizeof(stats));
+  memset(tap_exchanges, 0, sizeof(tap_exchanges));
+  stats_start = millis();
+}
+
+bool ReaderScheduler::anyActive() const
+{
+  for (int i = 0; i < num_readers; i++) {
+    if (sessions[i]->isActive()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReaderScheduler::anyWaiting() const
+{
+  for (int i = 0; i < num_readers; i++) {
+    if (sessions[i]->isWaiting()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//
+// Time a reader waits after looking for a card before looking again
+//
+unsigned long ReaderScheduler::detectInterval(int reader, bool busy) const
+{
+  unsigned long interval = polls[reader].getInterval();
+  if (busy && interval < SCHEDULER_DETECT_INTERVAL_MS) {
+    interval = SCHEDULER_DETECT_INTERVAL_MS;
+  }
+  return interval;
+}
+
+//
+// True if a reader's card has answered, or it has a command to send or
+// is due to look for a card. A reader waiting for its card is polled.
+//
+bool ReaderScheduler::isReady(int reader, bool busy, unsigned long now)
+{
+  CardSession& session = *sessions[reader];
+  if (session.isWaiting()) {
+    return session.poll();
+  }
+  return session.isActive() || now - last_detect[reader] >= detectInterval(reader, busy);
+}
+
+//
+// Next reader in turn that is ready. -1 if none is.
+//
+int ReaderScheduler::pickNext()
+{
+  bool busy = anyActive();
+  unsigned long now = millis();
+  for (int k = 0; k < num_readers; k++) {
+    int i = (next + k) % num_readers;
+    if (isReady(i, busy, now)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool ReaderScheduler::anyReady()
+{
+  bool busy = anyActive();
+  unsigned long now = millis();
+  for (int i = 0; i < num_readers; i++) {
+    if (isReady(i, busy, now)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+unsigned long ReaderScheduler::msUntilNextPoll() const
+{
+  if (num_readers == 0 || anyActive() || anyWaiting()) {
+    return 0;
+  }
+  unsigned long now = millis();
+  unsigned long wait = POLL_MAX_INTERVAL_MS;
+  for (int i = 0; i < num_readers; i++) {
+    unsigned long since = now - last_detect[i];
+    unsigned long interval = detectInterval(i, false);
+    if (since >= interval) {
+      return 0;
+    }
+    wait = min(wait, interval - since);
+  }
+  return wait;
+}
+
+bool ReaderScheduler::step()
+{
+  if (num_readers == 0) {
+    return false;
+  }
+
+  int i = pickNext();
+  if (i < 0) {
+    return anyActive() || anyWaiting();
+  }
+  next = (i + 1) % num_readers;
+  CardSession& session = *sessions[i];
+  ReaderStats& s = stats[i];
+
+  // Label the output when it switches to another reader
+  if constexpr (TRACE_ENABLED(TRACE_LEVEL_RESULT)) {
+    if (num_readers > 1 && i != last_stepped) {
+      trace_out.putStr("[reader ");
+      trace_out.putDec(i);
+      trace_out.putLine("]");
+    }
+  }
+  last_stepped = i;
+
+  bool was_active = session.isActive();
+  bool was_waiting = session.isWaiting();
+  unsigned long suppressed = session.getSuppressed();
+  unsigned long exchanges = session.getExchanges();
+  if (!was_active && !was_waiting) {
+    session.getTransport().setDetectTimeout(polls[i].getTimeout());
+  }
+  unsigned long start = micros();
+  session.step();
+  unsigned long elapsed = micros() - start;
+
+  if (was_active) {
+    s.exchanges += session.getExchanges() - exchanges;
+    s.busy_us += elapsed;
+  } else if (!was_waiting) {
+    s.detect_us += elapsed;
+  } else {
+    // Detection finished
+    s.detects++;
+    s.detect_us += elapsed;
+    last_detect[i] = millis();
+    if (session.isActive()) {
+      unsigned long detect_ms = last_detect[i] - last_miss[i];
+      tap_detect_ms[i] = detect_ms;
+      s.cards++;
+      s.detect_ms_total += detect_ms;
+      s.detect_ms_max = max(s.detect_ms_max, detect_ms);
+      polls[i].cardFound(last_detect[i]);
+    } else {
+      s.suppressed += session.getSuppressed() - suppressed;
+      polls[i].nothingFound(last_detect[i]);
+      last_miss[i] = last_detect[i];
+    }
+  }
+
+  // Tap started or ended
+  if (!was_active && session.isActive()) {
+    tap_start[i] = millis();
+    tap_exchanges[i] = s.exchanges;
+  } else if (was_active && !session.isActive()) {
+    // The next card can't have been waiting while this one was read
+    last_miss[i] = millis();
+    unsigned long tap_ms = millis() - tap_start[i];
+    if (session.getState() == SESSION_DONE) {
+      s.taps++;
+      s.tap_ms_total += tap_ms;
+      s.tap_ms_max = max(s.tap_ms_max, tap_ms);
+    } else {
+      s.failed++;
+    }
+    s.tags_dropped += session.tags().dropped();
+    if (results_log != NULL) {
+      results_log->addTap(session, i, tap_ms, tap_detect_ms[i], s.exchanges - tap_exchanges[i]);
+    }
+  }
+  return anyActive() || anyWaiting();
+}
+
+void ReaderScheduler::printStats()
+{
+  unsigned long elapsed_ms = millis() - stats_start;
+  trace_out.putLine("reader   taps  failed  exchanges  avg ms  max ms  busy ms  taps/min  tags dropped");
+  for (int i = 0; i < num_readers; i++) {
+    const ReaderStats& s = stats[i];
+    trace_out.putDec(i, 6);
+    trace_out.putDec(s.taps, 7);
+    trace_out.putDec(s.failed, 8);
+    trace_out.putDec(s.exchanges, 11);
+    trace_out.putDec(s.taps > 0 ? s.tap_ms_total / s.taps : 0, 8);
+    trace_out.putDec(s.tap_ms_max, 8);
+    trace_out.putDec((s.busy_us + s.detect_us) / 1000, 9);
+    trace_out.putDec(elapsed_ms > 0 ? (unsigned long) (s.taps * 60000.0 / elapsed_ms) : 0, 10);
+    trace_out.putDec(s.tags_dropped, 14);
+    trace_out.putLine();
+  }
+  trace_out.putLine("reader  cards  suppressed  polls  detect avg ms  max ms  interval ms  timeout ms");
+  for (int i = 0; i < num_readers; i++) {
+    const ReaderStats& s = stats[i];
+    trace_out.putDec(i, 6);
+    trace_out.putDec(s.cards, 7);
+    trace_out.putDec(s.suppressed, 12);
+    trace_out.putDec(s.detects, 7);
+    trace_out.putDec(s.cards > 0 ? s.detect_ms_total / s.cards : 0, 15);
+    trace_out.putDec(s.detect_ms_max, 8);
+    trace_out.putDec(polls[i].getInterval(), 13);
+    trace_out.putDec(polls[i].getTimeout(), 12);
+    trace_out.putLine();
+  }
+  trace_out.flush();
+}
@@ -0,0 +1,116 @@
+#ifndef __READER_SCHEDULER_H__
+#define __READER_SCHEDULER_H__
+#include <stdint.h>
+#include "card_session.h"
+#include "poll_policy.h"
+#include "results_log.h"
+
+//
+// Round-robin scheduler for several card readers
+//
+// Each reader has its own CardSession, which owns the buffers and the
+// decoded TLVs of its tap, so taps on different readers don't share
+// state. The caches and tap_stats are shared. step() runs one step of
+// one reader: it takes the answer to the reader's last command or card
+// detection and sends the next one.
+//
+// A reader waiting for its card is only polled. It is stepped once the
+// card has answered, so a slow exchange, a retry backoff or a
+// reactivation on one reader doesn't hold up the others. With a
+// transport that can only block, the wait is in sending instead.
+//
+// Readers take turns. Each reader's PollPolicy sets how long to wait
+// between looks for a card, and the detect timeout, from how recently
+// it had a card. While any reader has a tap in progress, an idle reader
+// also waits at least SCHEDULER_DETECT_INTERVAL_MS, since detection
+// waits for the transport's timeout when no card is there.
+//
+// Time to detect is measured from the end of the last poll that found
+// no new card, so it is the longest a card could have waited.
+//
+// With more than one reader the trace is marked with the reader number
+// whenever output switches to another reader.
+//
+// With a ResultsLog, each tap that ends, done or failed, adds a record.
+//
+
+#define MAX_READERS 4
+
+#ifndef SCHEDULER_DETECT_INTERVAL_MS
+#define SCHEDULER_DETECT_INTERVAL_MS 100
+#endif
+
+struct ReaderStats {
+  unsigned long taps;           // Taps completed
+  unsigned long failed;         // Taps ended early
+  unsigned long exchanges;      // Exchanges completed during a tap
+  unsigned long detects;        // Card detections completed
+  unsigned long busy_us;        // Time in steps during a tap
+  unsigned long detect_us;      // Time in steps looking for a card
+  unsigned long tap_ms_total;   // Detection to done, for completed taps
+  unsigned long tap_ms_max;
+  unsigned long cards;          // New cards detected
+  unsigned long suppressed;     // Detections of a card already read
+  unsigned long detect_ms_total;  // Time to detect, for new cards
+  unsigned long detect_ms_max;
+  unsigned long tags_dropped;   // Tags left out of the index, table full
+};
+
+class ReaderScheduler {
+public:
+  ReaderScheduler();
+
+  // Add a reader. Return its number, or -1 if there are MAX_READERS already.
+  int addReader(CardSession& session);
+
+  // Run one step of the next reader that is ready, if any.
+  // Return true while any reader has a tap or card detection in progress.
+  bool step();
+
+  // True if a reader can be stepped without waiting for its card
+  bool anyReady();
+
+  // Time until a reader is due to look for a card. 0 during a tap, or
+  // while a reader waits for its card.
+  unsigned long msUntilNextPoll() const;
+
+  // Detect timeouts for all readers, when busy and when idle
+  void setDetectTimeouts(uint16_t busy_ms, uint16_t idle_ms);
+
+  // Log every tap. NULL (the default) logs nothing.
+  void useResultsLog(ResultsLog* log) { results_log = log; }
+
+  int getReaderCount() const { return num_readers; }
+  CardSession& getSession(int reader) { return *sessions[reader]; }
+  const ReaderStats& getStats(int reader) const { return stats[reader]; }
+  const PollPolicy& getPollPolicy(int reader) const { return polls[reader]; }
+
+  void clearStats();
+
+  // Print taps, exchanges, tap times, throughput, dropped tags and detection
+  // for each reader
+  void printStats();
+
+private:
+  int pickNext();
+  bool anyActive() const;
+  bool anyWaiting() const;
+  bool isReady(int reader, bool busy, unsigned long now);
+  unsigned long detectInterval(int reader, bool busy) const;
+
+  CardSession* sessions[MAX_READERS];
+  ReaderStats stats[MAX_READERS];
+  unsigned long tap_start[MAX_READERS];
+  unsigned long tap_detect_ms[MAX_READERS];  // Time to detect the card of the tap
+  unsigned long tap_exchanges[MAX_READERS];  // Exchanges when the tap started
+  unsigned long last_detect[MAX_READERS];
+  unsigned long last_miss[MAX_READERS];    // End of the last poll with no new card
+  PollPolicy polls[MAX_READERS];
+  int num_readers;
+  int next;
+  int last_stepped;
+  unsigned long stats_start;
+  ResultsLog* results_log;
+};
+
+#endif /* __READER_SCHEDULER_H__ */
@@ -0,0 +1,83 @@
+//
+// Records that held wanted tags, remembered per AID
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "record_history.h"
+
+RecordHistory record_history;
+
+RecordHistory::RecordHistory()
+{
+  clear();
+}
+
+void RecordHistory::clear()
+{
+  for (int i = 0; i < RECORD_HISTORY_AIDS; i++) {
+    entries[i].aid_length = 0;
+    entries[i].count = 0;
+    entries[i].last_used = 0;
+  }
+  use_counter = 0;
+}
+
+RecordHistory::Entry* RecordHistory::find(const uint8_t* aid, uint8_t aid_length)
+{
+  for (int i = 0; i < RECORD_HISTORY_AIDS; i++) {
+    Entry& entry = entries[i];
+    if (entry.aid_length == aid_length && aid_length > 0 &&
+        memcmp(entry.aid, aid, aid_length) == 0) {
+      entry.last_used = ++use_counter;
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+void RecordHistory::add(const uint8_t* aid, uint8_t aid_length, RecordRef record)
+{
+  if (aid_length == 0 || aid_length > RECORD_HISTORY_MAX_AID) {
+    return;
+  }
+
+  Entry* entry = find(aid, aid_length);
+  if (entry == NULL) {
+    // Replace the least recently used AID
+    entry = &entries[0];
+    for (int i = 1; i < RECORD_HISTORY_AIDS; i++) {
+      if (entries[i].last_used < entry->last_used) {
+        entry = &entries[i];
+      }
+    }
+    entry->aid_length = aid_length;
+    memcpy(entry->aid, aid, aid_length);
+    entry->count = 0;
+    entry->last_used = ++use_counter;
+  }
+
+  for (int i = 0; i < entry->count; i++) {
+    if (entry->records[i].sfi == record.sfi && entry->records[i].record == record.record) {
+      return;
+    }
+  }
+  if (entry->count < RECORD_HISTORY_RECORDS) {
+    entry->records[entry->count++] = record;
+  }
+}
+
+bool RecordHistory::contains(const uint8_t* aid, uint8_t aid_length, RecordRef record)
+{
+  Entry* entry = find(aid, aid_length);
+  if (entry == NULL) {
+    return false;
+  }
+  for (int i = 0; i < entry->count; i++) {
+    if (entry->records[i].sfi == record.sfi && entry->records[i].record == record.record) {
+      return true;
+    }
+  }
+  return false;
+}
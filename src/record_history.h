@@ -0,0 +1,52 @@
+#ifndef __RECORD_HISTORY_H__
+#define __RECORD_HISTORY_H__
+#include <stdint.h>
+
+//
+// Records that held wanted tags, remembered per AID
+//
+// In minimal read mode the session reads these records first, so it
+// can stop sooner on cards of a type it has seen before.
+//
+
+#ifndef RECORD_HISTORY_AIDS
+#define RECORD_HISTORY_AIDS 4
+#endif
+#define RECORD_HISTORY_RECORDS 8
+#define RECORD_HISTORY_MAX_AID 16
+
+struct RecordRef {
+  uint8_t sfi;
+  uint8_t record;
+};
+
+class RecordHistory {
+public:
+  RecordHistory();
+
+  // Note that a record of this AID held wanted tags
+  void add(const uint8_t* aid, uint8_t aid_length, RecordRef record);
+
+  // Return true if the record held wanted tags before
+  bool contains(const uint8_t* aid, uint8_t aid_length, RecordRef record);
+
+  void clear();
+
+private:
+  struct Entry {
+    uint8_t aid_length;
+    uint8_t aid[RECORD_HISTORY_MAX_AID];
+    uint8_t count;
+    RecordRef records[RECORD_HISTORY_RECORDS];
+    uint32_t last_used;
+  };
+
+  Entry* find(const uint8_t* aid, uint8_t aid_length);
+
+  Entry entries[RECORD_HISTORY_AIDS];
+  uint32_t use_counter;
+};
+
+extern RecordHistory record_history;
+
+#endif /* __RECORD_HISTORY_H__ */
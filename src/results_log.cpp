@@ -0,0 +1,571 @@
+//
+// Log of the taps read, kept in flash
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "results_log.h"
+#include "emv_format.h"
+#include "trace_level.h"
+
+ResultsLog results_log;
+
+// Tags kept by default: AIP, ATC, CID, issuer country, usage control.
+// No PAN or track data, the UID is only kept as a hash.
+static const uint16_t default_tags[] = { 0x82, 0x9f36, 0x9f27, 0x5f28, 0x9f07 };
+
+static void putLE16(uint8_t* p, uint16_t value)
+{
+  p[0] = value & 0xff;
+  p[1] = value >> 8;
+}
+
+static void putLE32(uint8_t* p, uint32_t value)
+{
+  for (int i = 0; i < 4; i++) {
+    p[i] = (value >> (8 * i)) & 0xff;
+  }
+}
+
+static uint16_t getLE16(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t getLE32(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// CRC-8, polynomial 0x07, seeded with the payload length
+static uint8_t crc8(uint8_t length, const uint8_t* data)
+{
+  uint8_t crc = length;
+  for (int i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+static uint32_t fnv1a(const uint8_t* data, uint8_t length)
+{
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static uint16_t clip16(unsigned long value)
+{
+  return value > 0xffff ? 0xffff : value;
+}
+
+// Payload of a record, without the length and CRC. Return its length.
+static uint8_t encodeRecord(const LogRecord& record, uint8_t* p)
+{
+  p[0] = (record.reader & 0x0f) | (record.failed ? 0x10 : 0);
+  putLE16(&p[1], record.boot);
+  putLE32(&p[3], record.time_ms);
+  putLE32(&p[7], record.uid_hash);
+  putLE16(&p[11], record.tap_ms);
+  putLE16(&p[13], record.detect_ms);
+  p[15] = record.exchanges;
+  p[16] = record.aid_length;
+  uint8_t length = LOG_FIXED_SIZE;
+  memcpy(&p[length], record.aid, record.aid_length);
+  length += record.aid_length;
+  memcpy(&p[length], record.tags, record.tags_length);
+  return length + record.tags_length;
+}
+
+static bool decodeRecord(const uint8_t* p, uint8_t length, LogRecord* record)
+{
+  if (length < LOG_FIXED_SIZE || p[16] > LOG_MAX_AID || LOG_FIXED_SIZE + p[16] > length ||
+      length - LOG_FIXED_SIZE - p[16] > LOG_MAX_TAG_DATA) {
+    return false;
+  }
+  record->reader = p[0] & 0x0f;
+  record->failed = (p[0] & 0x10) != 0;
+  record->boot = getLE16(&p[1]);
+  record->time_ms = getLE32(&p[3]);
+  record->uid_hash = getLE32(&p[7]);
+  record->tap_ms = getLE16(&p[11]);
+  record->detect_ms = getLE16(&p[13]);
+  record->exchanges = p[15];
+  record->aid_length = p[16];
+  memcpy(record->aid, &p[LOG_FIXED_SIZE], record->aid_length);
+  record->tags_length = length - LOG_FIXED_SIZE - record->aid_length;
+  memcpy(record->tags, &p[LOG_FIXED_SIZE + record->aid_length], record->tags_length);
+  return true;
+}
+
+ResultsLog::ResultsLog()
+  : storage(NULL), num_sectors(0), head(-1), tail(-1), write_offset(0), next_seq(0),
+    boot(0), staged(0)
+{
+  setTags(default_tags, sizeof(default_tags) / sizeof(default_tags[0]));
+  clearStats();
+}
+
+void ResultsLog::setTags(const uint16_t* tags, uint8_t count)
+{
+  num_tags = min(count, (uint8_t) LOG_MAX_TAGS);
+  memcpy(this->tags, tags, num_tags * sizeof(uint16_t));
+}
+
+void ResultsLog::clearStats()
+{
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool ResultsLog::readHeader(int sector, uint32_t* first_seq, uint32_t* erases, uint16_t* sector_boot)
+{
+  uint8_t header[LOG_HEADER_SIZE];
+  if (!storage->read(sector * LOG_SECTOR_SIZE, header, sizeof(header))) {
+    return false;
+  }
+  *erases = 0;
+  *first_seq = LOG_NO_SEQ;
+  *sector_boot = 0;
+  if (getLE32(&header[0]) != LOG_MAGIC) {
+    return true;
+  }
+  // The erase count carries over a change of version, the records don't
+  *erases = getLE32(&header[8]);
+  if (header[4] == LOG_VERSION) {
+    *sector_boot = getLE16(&header[6]);
+    *first_seq = getLE32(&header[12]);
+  }
+  return true;
+}
+
+//
+// Read the record at offset into buffer. False at the end of the
+// sector's records, or at a record that was cut short.
+//
+bool ResultsLog::readRecord(int sector, uint32_t offset, uint8_t* buffer, uint8_t* length)
+{
+  uint8_t head_bytes[2];
+  if (offset + 2 > LOG_SECTOR_SIZE ||
+      !storage->read(sector * LOG_SECTOR_SIZE + offset, head_bytes, 2)) {
+    return false;
+  }
+  // 0xFF is erased flash: no more records
+  if (head_bytes[0] == 0xff || head_bytes[0] == 0 || offset + 2 + head_bytes[0] > LOG_SECTOR_SIZE) {
+    return false;
+  }
+  if (!storage->read(sector * LOG_SECTOR_SIZE + offset + 2, buffer, head_bytes[0])) {
+    return false;
+  }
+  if (crc8(head_bytes[0], buffer) != head_bytes[1]) {
+    return false;
+  }
+  *length = head_bytes[0];
+  return true;
+}
+
+//
+// Count the records of a sector, and set offset to where the next one
+// goes. A sector that ends in a damaged record is full. last_boot is
+// raised to the latest boot number of the records.
+//
+int ResultsLog::scanRecords(int sector, uint32_t* offset, uint16_t* last_boot)
+{
+  uint8_t buffer[255];
+  uint8_t length;
+  int count = 0;
+  uint32_t pos = LOG_HEADER_SIZE;
+  while (readRecord(sector, pos, buffer, &length)) {
+    if (length >= 3) {
+      *last_boot = max(*last_boot, getLE16(&buffer[1]));
+    }
+    pos += 2 + length;
+    count++;
+  }
+  // Anything but erased flash after the last good record
+  uint8_t next = 0xff;
+  if (pos < LOG_SECTOR_SIZE) {
+    storage->read(sector * LOG_SECTOR_SIZE + pos, &next, 1);
+  }
+  *offset = next == 0xff ? pos : LOG_SECTOR_SIZE;
+  return count;
+}
+
+bool ResultsLog::begin(LogStorage& storage)
+{
+  this->storage = &storage;
+  num_sectors = min(storage.size() / LOG_SECTOR_SIZE, (uint32_t) RESULTS_LOG_MAX_SECTORS);
+  head = -1;
+  tail = -1;
+  staged = 0;
+  next_seq = 0;
+  uint16_t last_boot = 0;
+  uint32_t max_erases = 0;
+  if (num_sectors < 2) {
+    // Nowhere to go when the only sector is full
+    this->storage = NULL;
+    return false;
+  }
+
+  for (int i = 0; i < num_sectors; i++) {
+    uint16_t sector_boot;
+    if (!readHeader(i, &sectors[i].first_seq, &sectors[i].erases, &sector_boot)) {
+      this->storage = NULL;
+      return false;
+    }
+    max_erases = max(max_erases, sectors[i].erases);
+    if (sectors[i].first_seq == LOG_NO_SEQ) {
+      continue;
+    }
+    last_boot = max(last_boot, sector_boot);
+    if (head < 0 || sectors[i].first_seq > sectors[head].first_seq) {
+      head = i;
+    }
+  }
+  // A sector without a header may have lost it to a reset between the
+  // erase and the header write. Count it as worn as the most worn one,
+  // rather than as new.
+  for (int i = 0; i < num_sectors; i++) {
+    if (sectors[i].erases == 0) {
+      sectors[i].erases = max_erases;
+    }
+  }
+  if (head < 0) {
+    boot = last_boot + 1;
+    return true;
+  }
+
+  // The ring runs back from the newest sector while the numbers go down
+  tail = head;
+  for (int k = 1; k < num_sectors; k++) {
+    int prev = (head - k + num_sectors) % num_sectors;
+    if (sectors[prev].first_seq == LOG_NO_SEQ ||
+        sectors[prev].first_seq >= sectors[tail].first_seq) {
+      break;
+    }
+    tail = prev;
+  }
+  // Boots that only appended to the head sector are in its records, not
+  // in any header
+  next_seq = sectors[head].first_seq + scanRecords(head, &write_offset, &last_boot);
+  boot = last_boot + 1;
+  return true;
+}
+
+int ResultsLog::usedSectors() const
+{
+  return head < 0 ? 0 : (head - tail + num_sectors) % num_sectors + 1;
+}
+
+uint32_t ResultsLog::firstSeq() const
+{
+  return head < 0 ? next_seq : sectors[tail].first_seq;
+}
+
+//
+// Erase the sector after the head and start writing there. When the
+// ring is full that is the oldest sector, and its records are lost.
+//
+bool ResultsLog::openSector()
+{
+  int sector = head < 0 ? 0 : (head + 1) % num_sectors;
+  if (head >= 0 && sector == tail) {
+    tail = (tail + 1) % num_sectors;
+  }
+
+  uint32_t erases = sectors[sector].erases + 1;
+  uint8_t header[LOG_HEADER_SIZE];
+  putLE32(&header[0], LOG_MAGIC);
+  header[4] = LOG_VERSION;
+  header[5] = 0xff;
+  putLE16(&header[6], boot);
+  putLE32(&header[8], erases);
+  putLE32(&header[12], next_seq);
+
+  sectors[sector].first_seq = LOG_NO_SEQ;
+  sectors[sector].erases = erases;
+  stats.erased++;
+  bool ok = storage->eraseSector(sector * LOG_SECTOR_SIZE) &&
+            storage->write(sector * LOG_SECTOR_SIZE, header, sizeof(header));
+  if (!ok) {
+    stats.errors++;
+    TRACE_ERROR(trace_out.putStr("Results log: can't erase sector "); trace_out.putDec(sector);
+                trace_out.putLine());
+    if (head < 0) {
+      tail = -1;
+    }
+    return false;
+  }
+  stats.written += sizeof(header);
+  sectors[sector].first_seq = next_seq;
+  if (head < 0) {
+    tail = sector;
+  }
+  head = sector;
+  write_offset = LOG_HEADER_SIZE;
+  return true;
+}
+
+bool ResultsLog::append(LogRecord& record)
+{
+  if (storage == NULL) {
+    return false;
+  }
+  record.boot = boot;
+  uint8_t buffer[LOG_RECORD_MAX];
+  uint8_t length = encodeRecord(record, &buffer[2]);
+  buffer[0] = length;
+  buffer[1] = crc8(length, &buffer[2]);
+  uint32_t size = 2 + length;
+
+  // Records don't cross sectors
+  if (head < 0 || write_offset + staged + size > LOG_SECTOR_SIZE) {
+    sync();
+    if ((head < 0 || write_offset + size > LOG_SECTOR_SIZE) && !openSector()) {
+      return false;
+    }
+  }
+  if (staged + size > RESULTS_LOG_STAGE) {
+    sync();
+  }
+  memcpy(&stage[staged], buffer, size);
+  staged += size;
+  record.seq = next_seq++;
+  stats.appended++;
+  return true;
+}
+
+void ResultsLog::sync()
+{
+  if (storage == NULL) {
+    return;
+  }
+  if (staged > 0) {
+    if (storage->write(head * LOG_SECTOR_SIZE + write_offset, stage, staged)) {
+      write_offset += staged;
+      stats.written += staged;
+    } else {
+      // Leave what may be half written, carry on in the next sector
+      stats.errors++;
+      write_offset = LOG_SECTOR_SIZE;
+      TRACE_ERROR(trace_out.putLine("Results log: write failed, records lost"));
+    }
+    staged = 0;
+  }
+
+  // Erase ahead, so the next tap's record doesn't wait for it
+  if (head >= 0 && write_offset + LOG_RECORD_MAX > LOG_SECTOR_SIZE) {
+    openSector();
+  }
+}
+
+void ResultsLog::makeRecord(const CardSession& session, uint8_t reader, unsigned long tap_ms,
+                            unsigned long detect_ms, unsigned long exchanges, LogRecord* record) const
+{
+  record->seq = LOG_NO_SEQ;
+  record->boot = boot;
+  record->time_ms = millis();
+  uint8_t uid_length;
+  const uint8_t* uid = session.getUID(&uid_length);
+  record->uid_hash = fnv1a(uid, uid_length);
+  record->reader = reader;
+  record->failed = session.getState() != SESSION_DONE;
+  record->tap_ms = clip16(tap_ms);
+  record->detect_ms = clip16(detect_ms);
+  record->exchanges = min(exchanges, 255ul);
+
+  const uint8_t* aid = session.getAID(&record->aid_length);
+  if (aid == NULL || record->aid_length > LOG_MAX_AID) {
+    record->aid_length = 0;
+  } else {
+    memcpy(record->aid, aid, record->aid_length);
+  }
+
+  record->tags_length = 0;
+  for (int i = 0; i < num_tags; i++) {
+    const TagValue* value = session.tags().find(tags[i]);
+    if (value == NULL || value->length > LOG_MAX_TAG_VALUE ||
+        record->tags_length + 3 + value->length > LOG_MAX_TAG_DATA) {
+      continue;
+    }
+    uint8_t* p = &record->tags[record->tags_length];
+    p[0] = tags[i] >> 8;
+    p[1] = tags[i] & 0xff;
+    p[2] = value->length;
+    memcpy(&p[3], value->value, value->length);
+    record->tags_length += 3 + value->length;
+  }
+}
+
+void ResultsLog::addTap(const CardSession& session, uint8_t reader, unsigned long tap_ms,
+                        unsigned long detect_ms, unsigned long exchanges)
+{
+  if (storage == NULL) {
+    return;
+  }
+  LogRecord record;
+  makeRecord(session, reader, tap_ms, detect_ms, exchanges, &record);
+  append(record);
+}
+
+bool ResultsLog::seek(uint32_t seq, LogCursor* cursor)
+{
+  sync();
+  if (head < 0 || seq >= next_seq) {
+    return false;
+  }
+
+  // Last sector of the ring that starts at or before seq
+  int low = 0;
+  int high = usedSectors() - 1;
+  while (low < high) {
+    int mid = (low + high + 1) / 2;
+    if (sectors[(tail + mid) % num_sectors].first_seq <= seq) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  cursor->sector = (tail + low) % num_sectors;
+  cursor->seq = sectors[cursor->sector].first_seq;
+  cursor->offset = LOG_HEADER_SIZE;
+
+  // Skip the records before it in the sector
+  uint8_t buffer[255];
+  uint8_t length;
+  while (cursor->seq < seq && readRecord(cursor->sector, cursor->offset, buffer, &length)) {
+    cursor->offset += 2 + length;
+    cursor->seq++;
+  }
+  return true;
+}
+
+bool ResultsLog::next(LogCursor* cursor, LogRecord* record)
+{
+  uint8_t buffer[255];
+  uint8_t length;
+  while (head >= 0 && cursor->seq < next_seq) {
+    if (readRecord(cursor->sector, cursor->offset, buffer, &length)) {
+      cursor->offset += 2 + length;
+      record->seq = cursor->seq++;
+      if (decodeRecord(buffer, length, record)) {
+        return true;
+      }
+      continue;
+    }
+    // End of this sector's records
+    if (cursor->sector == head) {
+      return false;
+    }
+    cursor->sector = (cursor->sector + 1) % num_sectors;
+    cursor->seq = sectors[cursor->sector].first_seq;
+    cursor->offset = LOG_HEADER_SIZE;
+  }
+  return false;
+}
+
+void ResultsLog::exportRecords(uint32_t first, uint32_t last)
+{
+  trace_out.putLine("-----BEGIN RESULTS LOG-----");
+  trace_out.putLine("seq,boot,time_ms,reader,result,uid_hash,aid,tap_ms,detect_ms,exchanges,tags");
+  LogCursor cursor;
+  LogRecord record;
+  if (seek(first, &cursor)) {
+    while (next(&cursor, &record) && record.seq <= last) {
+      trace_out.putDec(record.seq);
+      trace_out.putChar(',');
+      trace_out.putDec(record.boot);
+      trace_out.putChar(',');
+      trace_out.putDec(record.time_ms);
+      trace_out.putChar(',');
+      trace_out.putDec(record.reader);
+      trace_out.putStr(record.failed ? ",failed," : ",done,");
+      for (int shift = 24; shift >= 0; shift -= 8) {
+        trace_out.putHexByte(record.uid_hash >> shift);
+      }
+      trace_out.putChar(',');
+      for (int i = 0; i < record.aid_length; i++) {
+        trace_out.putHexByte(record.aid[i]);
+      }
+      trace_out.putChar(',');
+      trace_out.putDec(record.tap_ms);
+      trace_out.putChar(',');
+      trace_out.putDec(record.detect_ms);
+      trace_out.putChar(',');
+      trace_out.putDec(record.exchanges);
+      trace_out.putChar(',');
+      // TAG=value, space separated
+      for (int pos = 0; pos + 3 <= record.tags_length;) {
+        const uint8_t* p = &record.tags[pos];
+        if (pos > 0) {
+          trace_out.putChar(' ');
+        }
+        trace_out.putHex((p[0] << 8) | p[1]);
+        trace_out.putChar('=');
+        for (int i = 0; i < p[2] && pos + 3 + i < record.tags_length; i++) {
+          trace_out.putHexByte(p[3 + i]);
+        }
+        pos += 3 + p[2];
+      }
+      trace_out.putLine();
+    }
+  }
+  trace_out.putLine("-----END RESULTS LOG-----");
+  trace_out.flush();
+}
+
+void ResultsLog::printStats()
+{
+  if (storage == NULL) {
+    trace_out.putLine("Results log: no storage");
+    trace_out.flush();
+    return;
+  }
+  sync();
+  trace_out.putStr("Results log: ");
+  trace_out.putDec(next_seq - firstSeq());
+  trace_out.putStr(" records");
+  if (next_seq > firstSeq()) {
+    trace_out.putStr(", ");
+    trace_out.putDec(firstSeq());
+    trace_out.putStr(" to ");
+    trace_out.putDec(next_seq - 1);
+  }
+  trace_out.putStr(", boot ");
+  trace_out.putDec(boot);
+  trace_out.putLine();
+
+  uint32_t min_erases = sectors[0].erases;
+  uint32_t max_erases = sectors[0].erases;
+  for (int i = 1; i < num_sectors; i++) {
+    min_erases = min(min_erases, sectors[i].erases);
+    max_erases = max(max_erases, sectors[i].erases);
+  }
+  trace_out.putStr("Sectors: ");
+  trace_out.putDec(usedSectors());
+  trace_out.putStr(" of ");
+  trace_out.putDec(num_sectors);
+  trace_out.putStr(" in use, erased ");
+  trace_out.putDec(min_erases);
+  trace_out.putStr(" to ");
+  trace_out.putDec(max_erases);
+  trace_out.putStr(" times, ");
+  trace_out.putDec(head < 0 ? 0 : LOG_SECTOR_SIZE - write_offset);
+  trace_out.putLine(" bytes free in the current one");
+
+  trace_out.putStr("Since cleared: ");
+  trace_out.putDec(stats.appended);
+  trace_out.putStr(" appended, ");
+  trace_out.putDec(stats.written);
+  trace_out.putStr(" bytes written, ");
+  trace_out.putDec(stats.erased);
+  trace_out.putStr(" sectors erased, ");
+  trace_out.putDec(stats.errors);
+  trace_out.putLine(" errors");
+  trace_out.flush();
+}
@@ -0,0 +1,184 @@
+#ifndef __RESULTS_LOG_H__
+#define __RESULTS_LOG_H__
+#include <stdint.h>
+#include "log_storage.h"
+#include "card_session.h"
+
+//
+// Log of the taps read, kept in flash
+//
+// Each tap, done or failed, adds a short record: a hash of the UID,
+// the AID, a few tags (AIP, ATC, CID, issuer country and usage control
+// by default) and the times. The taps are kept when no host is reading
+// the serial port, and can be exported later.
+//
+// The flash is used as a ring of sectors. Records are only ever
+// appended, and when the ring is full the oldest sector is erased and
+// reused, so the sectors wear evenly. Each sector starts with a header:
+//
+//   0-3    LOG_MAGIC
+//   4      LOG_VERSION
+//   5      reserved, 0xFF
+//   6-7    boot number
+//   8-11   times this sector has been erased
+//   12-15  sequence number of its first record
+//
+// then records, until the erased bytes:
+//
+//   0      payload length
+//   1      CRC-8 of the length and payload
+//   2..    payload, multi-byte values little endian:
+//            0      reader in the low 4 bits, 0x10 if the tap failed
+//            1-2    boot number
+//            3-6    millis() at the end of the tap
+//            7-10   FNV-1a hash of the UID
+//            11-12  tap time in ms, detection to done
+//            13-14  time to detect in ms
+//            15     exchanges
+//            16     AID length, then the AID
+//            ..     tags to the end: tag (2 bytes, big endian), length, value
+//
+// A record's sequence number is its sector's first one plus its place
+// in the sector, so it is not stored. The index is the first sequence
+// number of each sector, read from the headers by begin(), so finding
+// a record reads one sector at most.
+//
+// append() only encodes the record into RAM. sync() writes what is
+// staged, and erases the next sector when the current one is nearly
+// full, so the flash is written between taps rather than during them.
+// A record cut short by a reset fails its CRC, and the rest of its
+// sector is skipped.
+//
+
+#define LOG_MAGIC 0x474F4C54      // "TLOG"
+#define LOG_VERSION 1
+#define LOG_HEADER_SIZE 16
+#define LOG_NO_SEQ 0xFFFFFFFFul
+
+// Sectors of the ring, at most
+#ifndef RESULTS_LOG_MAX_SECTORS
+#define RESULTS_LOG_MAX_SECTORS 512
+#endif
+// Bytes of records staged in RAM before sync()
+#ifndef RESULTS_LOG_STAGE
+#define RESULTS_LOG_STAGE 512
+#endif
+
+#define LOG_MAX_AID 16
+#define LOG_MAX_TAGS 8
+#define LOG_MAX_TAG_VALUE 16
+#define LOG_MAX_TAG_DATA 64
+#define LOG_FIXED_SIZE 17
+#define LOG_RECORD_MAX (2 + LOG_FIXED_SIZE + LOG_MAX_AID + LOG_MAX_TAG_DATA)
+
+struct LogRecord {
+  uint32_t seq;               // Set by append()
+  uint16_t boot;              // Set by append()
+  uint32_t time_ms;
+  uint32_t uid_hash;
+  uint8_t reader;
+  bool failed;
+  uint16_t tap_ms;
+  uint16_t detect_ms;
+  uint8_t exchanges;
+  uint8_t aid_length;
+  uint8_t aid[LOG_MAX_AID];
+  uint8_t tags_length;
+  uint8_t tags[LOG_MAX_TAG_DATA];   // Tag (2 bytes), length, value...
+};
+
+// Position in the log while reading it
+struct LogCursor {
+  uint32_t seq;
+  int sector;
+  uint32_t offset;
+};
+
+struct LogStats {
+  unsigned long appended;     // Records added
+  unsigned long written;      // Bytes written to the flash
+  unsigned long erased;       // Sectors erased
+  unsigned long errors;       // Failed writes and erases
+};
+
+class ResultsLog {
+public:
+  ResultsLog();
+
+  // Read the sector headers and find where the log ends.
+  // Return false if the storage is too small or can't be read.
+  bool begin(LogStorage& storage);
+  bool isOpen() const { return storage != NULL; }
+
+  // Tags kept in each record, in place of the defaults
+  void setTags(const uint16_t* tags, uint8_t count);
+
+  // Fill a record from the session of a tap that just ended
+  void makeRecord(const CardSession& session, uint8_t reader, unsigned long tap_ms,
+                  unsigned long detect_ms, unsigned long exchanges, LogRecord* record) const;
+
+  // Stage a record, and give it the next sequence number.
+  // Return false if the log is not open.
+  bool append(LogRecord& record);
+
+  // makeRecord() and append()
+  void addTap(const CardSession& session, uint8_t reader, unsigned long tap_ms,
+              unsigned long detect_ms, unsigned long exchanges);
+
+  // Write the staged records to the flash. Call between taps.
+  void sync();
+
+  // Oldest record kept, and the number the next one will have
+  uint32_t firstSeq() const;
+  uint32_t nextSeq() const { return next_seq; }
+  uint16_t getBoot() const { return boot; }
+
+  // Point the cursor at the first record numbered seq or later.
+  // Return false if there is none.
+  bool seek(uint32_t seq, LogCursor* cursor);
+
+  // Read the record at the cursor and move past it
+  bool next(LogCursor* cursor, LogRecord* record);
+
+  // Print records first to last as comma separated lines
+  void exportRecords(uint32_t first, uint32_t last);
+
+  const LogStats& getStats() const { return stats; }
+  void clearStats();
+
+  // Print the records kept, sector use and wear, and this boot's writes
+  void printStats();
+
+private:
+  struct SectorInfo {
+    uint32_t first_seq;       // LOG_NO_SEQ if the sector is not in use
+    uint32_t erases;
+  };
+
+  bool openSector();
+  bool readHeader(int sector, uint32_t* first_seq, uint32_t* erases, uint16_t* sector_boot);
+  int scanRecords(int sector, uint32_t* offset, uint16_t* last_boot);
+  bool readRecord(int sector, uint32_t offset, uint8_t* buffer, uint8_t* length);
+  int usedSectors() const;
+
+  LogStorage* storage;
+  SectorInfo sectors[RESULTS_LOG_MAX_SECTORS];
+  int num_sectors;
+  int head;                   // Sector written to, -1 if the log is empty
+  int tail;                   // Oldest sector
+  uint32_t write_offset;      // In the head sector
+  uint32_t next_seq;
+  uint16_t boot;
+
+  uint8_t stage[RESULTS_LOG_STAGE];
+  uint32_t staged;
+
+  uint16_t tags[LOG_MAX_TAGS];
+  uint8_t num_tags;
+
+  LogStats stats;
+};
+
+extern ResultsLog results_log;
+
+#endif /* __RESULTS_LOG_H__ */
@@ -0,0 +1,320 @@
+//
+// Retries for failed exchanges
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "retry_transport.h"
+#include "emv_format.h"
+
+LinkStats link_stats;
+
+LinkStats::LinkStats()
+{
+  clear();
+}
+
+void LinkStats::clear()
+{
+  exchanges = 0;
+  retries = 0;
+  recovered = 0;
+  failed = 0;
+  reactivations = 0;
+  resumes = 0;
+  memset(errors, 0, sizeof(errors));
+  memset(status_words, 0, sizeof(status_words));
+  other_status_words = 0;
+}
+
+const char* LinkStats::errorName(LinkError error)
+{
+  switch (error) {
+    case LINK_OK:
+      return "ok";
+    case LINK_TIMEOUT:
+      return "timeout";
+    case LINK_PROTOCOL:
+      return "protocol";
+    case LINK_CARD_REMOVED:
+      return "card removed";
+    case LINK_STATUS:
+      return "status word";
+    default:
+      return "?";
+  }
+}
+
+void LinkStats::countStatus(uint16_t sw)
+{
+  errors[LINK_STATUS]++;
+  for (int i = 0; i < LINK_SW_SLOTS; i++) {
+    if (status_words[i].count == 0) {
+      status_words[i].sw = sw;
+    }
+    if (status_words[i].sw == sw) {
+      status_words[i].count++;
+      return;
+    }
+  }
+  other_status_words++;
+}
+
+void LinkStats::print()
+{
+  trace_out.putStr("Link: exchanges ");
+  trace_out.putDec(exchanges);
+  trace_out.putStr(", retries ");
+  trace_out.putDec(retries);
+  trace_out.putStr(", recovered ");
+  trace_out.putDec(recovered);
+  trace_out.putStr(", failed ");
+  trace_out.putDec(failed);
+  trace_out.putStr(", reactivations ");
+  trace_out.putDec(reactivations);
+  trace_out.putStr(", resumes ");
+  trace_out.putDec(resumes);
+  trace_out.putLine();
+
+  trace_out.putLine("error            count");
+  for (int i = LINK_TIMEOUT; i < NUM_LINK_ERRORS; i++) {
+    const char* name = errorName((LinkError) i);
+    trace_out.putStr(name);
+    trace_out.putDec(errors[i], 21 - strlen(name));
+    trace_out.putLine();
+  }
+  for (int i = 0; i < LINK_SW_SLOTS && status_words[i].count > 0; i++) {
+    trace_out.putStr("  ");
+    trace_out.putHexByte(status_words[i].sw >> 8);
+    trace_out.putHexByte(status_words[i].sw & 0xFF);
+    trace_out.putDec(status_words[i].count, 15);
+    trace_out.putLine();
+  }
+  if (other_status_words > 0) {
+    trace_out.putStr("  other");
+    trace_out.putDec(other_status_words, 14);
+    trace_out.putLine();
+  }
+  trace_out.flush();
+}
+
+RetryTransport::RetryTransport(CardTransport& card)
+  : card(card), last_error(LINK_OK), reactivated(false), detect_timeout_ms(1000),
+    state(IDLE), tx(NULL), tx_length(0), rx(NULL), rx_size(0), select(false), sent(false),
+    attempt(0), backoff_ms(0), backoff_start(0), result(false), result_length(0),
+    uid_length(0)
+{
+}
+
+bool RetryTransport::detectCard()
+{
+  uint8_t length;
+  return submitDetect() && complete(&length);
+}
+
+bool RetryTransport::submitDetect()
+{
+  reactivated = false;
+  uid_length = 0;
+  state = DETECT;
+  return card.submitDetect();
+}
+
+void RetryTransport::setDetectTimeout(uint16_t timeout_ms)
+{
+  detect_timeout_ms = timeout_ms;
+  card.setDetectTimeout(timeout_ms);
+}
+
+bool RetryTransport::getCardUID(uint8_t* uid, uint8_t* uid_length)
+{
+  return card.getCardUID(uid, uid_length);
+}
+
+bool RetryTransport::takeReactivated()
+{
+  bool result = reactivated;
+  reactivated = false;
+  return result;
+}
+
+bool RetryTransport::transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length)
+{
+  return submit(tx, tx_length, rx, *rx_length) && complete(rx_length);
+}
+
+bool RetryTransport::submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size)
+{
+  this->tx = tx;
+  this->tx_length = tx_length;
+  this->rx = rx;
+  this->rx_size = rx_size;
+  select = tx_length >= 2 && tx[1] == 0xA4;
+  attempt = 0;
+  backoff_ms = LINK_BACKOFF_MS;
+  link_stats.exchanges++;
+  send();
+  return true;
+}
+
+void RetryTransport::send()
+{
+  state = SENT;
+  sent = card.submit(tx, tx_length, rx, rx_size);
+}
+
+bool RetryTransport::poll()
+{
+  if (state == DETECT) {
+    return card.poll();
+  }
+  advance(false);
+  return state == IDLE || state == DONE;
+}
+
+bool RetryTransport::complete(uint8_t* rx_length)
+{
+  if (state == DETECT) {
+    state = IDLE;
+    uint8_t length;
+    if (!card.complete(&length)) {
+      *rx_length = 0;
+      return false;
+    }
+    uid_length = sizeof(uid);
+    if (!card.getCardUID(uid, &uid_length)) {
+      uid_length = 0;
+    }
+    *rx_length = 0;
+    return true;
+  }
+
+  advance(true);
+  bool success = state == DONE && result;
+  *rx_length = success ? result_length : 0;
+  state = IDLE;
+  return success;
+}
+
+//
+// Move the exchange on as far as it goes. With wait, until it is done,
+// else only as far as it can without waiting for the card or the backoff.
+//
+void RetryTransport::advance(bool wait)
+{
+  for (;;) {
+    if (state == SENT) {
+      if (sent && !wait && !card.poll()) {
+        return;
+      }
+      uint8_t length = 0;
+      bool success = sent && card.complete(&length);
+      tried(success, length);
+    } else if (state == BACKOFF) {
+      // Give the field a moment, a little longer each time
+      unsigned long elapsed = millis() - backoff_start;
+      if (elapsed < backoff_ms) {
+        if (!wait) {
+          return;
+        }
+        delay(backoff_ms - elapsed);
+      }
+      backoff_ms *= 2;
+      link_stats.retries++;
+      attempt++;
+      send();
+    } else if (state == REACTIVATE) {
+      if (!wait && !card.poll()) {
+        return;
+      }
+      checkReactivated();
+    } else {
+      return;
+    }
+  }
+}
+
+//
+// Deal with the result of one try: done, or what to do next
+//
+void RetryTransport::tried(bool success, uint8_t length)
+{
+  if (success && length >= 2) {
+    last_error = LINK_OK;
+    uint8_t sw1 = rx[length - 2];
+    if (!(sw1 == 0x90 && rx[length - 1] == 0x00) && sw1 != 0x61 && sw1 != 0x6C) {
+      last_error = LINK_STATUS;
+      link_stats.countStatus((sw1 << 8) | rx[length - 1]);
+    }
+    if (attempt > 0) {
+      link_stats.recovered++;
+    }
+    finish(true, length);
+    return;
+  }
+
+  last_error = success ? LINK_PROTOCOL : card.getLastError();
+  link_stats.errors[last_error]++;
+  if (last_error == LINK_CARD_REMOVED) {
+    finish(false, 0);
+  } else if (attempt < LINK_RETRY_MAX) {
+    state = BACKOFF;
+    backoff_start = millis();
+  } else if (attempt == LINK_RETRY_MAX) {
+    // Retries didn't help: is the card still there?
+    card.setDetectTimeout(LINK_REACTIVATE_TIMEOUT_MS);
+    bool started = card.submitDetect();
+    card.setDetectTimeout(detect_timeout_ms);
+    state = REACTIVATE;
+    if (!started) {
+      checkReactivated();
+    }
+  } else {
+    finish(false, 0);
+  }
+}
+
+//
+// The card was looked for again. Fail unless it is the same card.
+//
+void RetryTransport::checkReactivated()
+{
+  uint8_t length;
+  if (!card.complete(&length) || !sameCard()) {
+    last_error = LINK_CARD_REMOVED;
+    link_stats.errors[last_error]++;
+    finish(false, 0);
+    return;
+  }
+  link_stats.reactivations++;
+  reactivated = true;
+  if (!select) {
+    finish(false, 0);
+    return;
+  }
+  // A SELECT works the same on a freshly activated card
+  reactivated = false;
+  link_stats.retries++;
+  attempt++;
+  send();
+}
+
+bool RetryTransport::sameCard()
+{
+  uint8_t found_uid[sizeof(uid)];
+  uint8_t found_length = sizeof(found_uid);
+  return uid_length == 0 ||
+         (card.getCardUID(found_uid, &found_length) && found_length == uid_length &&
+          memcmp(found_uid, uid, uid_length) == 0);
+}
+
+void RetryTransport::finish(bool success, uint8_t length)
+{
+  if (!success) {
+    link_stats.failed++;
+  }
+  state = DONE;
+  result = success;
+  result_length = length;
+}
@@ -0,0 +1,136 @@
+#ifndef __RETRY_TRANSPORT_H__
+#define __RETRY_TRANSPORT_H__
+#include <stdint.h>
+#include "card_transport.h"
+
+//
+// Retries for failed exchanges
+//
+// RetryTransport sits between a card session and its transport. A
+// failed exchange is classified (LinkError) and only that APDU is sent
+// again, up to LINK_RETRY_MAX times, waiting LINK_BACKOFF_MS and then
+// twice as long each time before the next try. A card at the edge of
+// the field gets another chance without the tap starting over.
+//
+// When the retries don't help, the card is activated again. If no card
+// answers, or a different one does, the exchange fails with
+// LINK_CARD_REMOVED so the tap can end at once instead of timing out on
+// every record left. If the card is still there, a SELECT is sent again
+// right away. Any other command depends on the application the card had
+// selected, which activation resets, so the exchange fails and
+// takeReactivated() tells the session to SELECT again before resuming.
+//
+// Error status words (not 9000, 61xx or 6Cxx) are counted but not
+// retried: the card would answer the same.
+//
+// The retries work with submit(), poll() and complete() too: poll()
+// waits out the backoff, sends the APDU again and activates the card
+// again without blocking, so other readers are served meanwhile.
+// Only complete() waits.
+//
+
+#ifndef LINK_RETRY_MAX
+#define LINK_RETRY_MAX 2
+#endif
+#ifndef LINK_BACKOFF_MS
+#define LINK_BACKOFF_MS 5
+#endif
+#ifndef LINK_REACTIVATE_TIMEOUT_MS
+#define LINK_REACTIVATE_TIMEOUT_MS 100
+#endif
+
+// Status words counted one by one, the rest as other
+#define LINK_SW_SLOTS 8
+
+class LinkStats {
+public:
+  LinkStats();
+
+  void clear();
+
+  // Print the counts for each error class and status word
+  void print();
+
+  static const char* errorName(LinkError error);
+
+  unsigned long exchanges;
+  unsigned long retries;          // Exchanges sent again
+  unsigned long recovered;        // Exchanges that worked after a retry
+  unsigned long failed;           // Exchanges that failed after all retries
+  unsigned long reactivations;    // Card activated again, still there
+  unsigned long resumes;          // Taps carried on after a reactivation
+  unsigned long errors[NUM_LINK_ERRORS];   // Failed tries by class
+
+  void countStatus(uint16_t sw);
+
+  struct StatusCount {
+    uint16_t sw;
+    unsigned long count;
+  };
+  StatusCount status_words[LINK_SW_SLOTS];
+  unsigned long other_status_words;
+};
+
+extern LinkStats link_stats;
+
+class RetryTransport : public CardTransport {
+public:
+  RetryTransport(CardTransport& card);
+
+  bool detectCard();
+  void setDetectTimeout(uint16_t timeout_ms);
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length);
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length);
+  LinkError getLastError() { return last_error; }
+
+  bool submit(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t rx_size);
+  bool submitDetect();
+  bool poll();
+  bool complete(uint8_t* rx_length);
+
+  // True once if the card was activated again since the last call,
+  // and needs its application selected again
+  bool takeReactivated();
+
+private:
+  enum State {
+    IDLE,
+    DETECT,           // Looking for a card for detectCard()
+    SENT,             // Waiting for the card's answer
+    BACKOFF,          // Waiting to send again
+    REACTIVATE,       // Looking for the card again
+    DONE
+  };
+
+  void send();
+  void advance(bool wait);
+  void tried(bool success, uint8_t length);
+  void checkReactivated();
+  bool sameCard();
+  void finish(bool success, uint8_t length);
+
+  CardTransport& card;
+  LinkError last_error;
+  bool reactivated;
+  uint16_t detect_timeout_ms;
+
+  // The exchange in progress, sent again on a retry
+  State state;
+  const uint8_t* tx;
+  uint8_t tx_length;
+  uint8_t* rx;
+  uint8_t rx_size;
+  bool select;
+  bool sent;
+  int attempt;
+  unsigned long backoff_ms;
+  unsigned long backoff_start;
+  bool result;
+  uint8_t result_length;
+
+  // The card found by the last detectCard()
+  uint8_t uid[10];
+  uint8_t uid_length;
+};
+
+#endif /* __RETRY_TRANSPORT_H__ */
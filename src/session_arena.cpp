@@ -0,0 +1,164 @@
+//
+// Memory for the commands and responses of one tap
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include <new>
+#include <type_traits>
+#include "session_arena.h"
+#include "emv_format.h"
+#include "trace_level.h"
+
+SessionArena::SessionArena()
+  : used(0), peak_used(0), response_mark(0), response_size(0), num_responses(0),
+    last_decoded(NULL), warned_full(false)
+{
+  scratch.data = scratch_data;
+  scratch.length = 0;
+  scratch.tlvs = NULL;
+  scratch.kept = false;
+}
+
+SessionArena::~SessionArena()
+{
+  reset();
+}
+
+void* SessionArena::alloc(size_t size)
+{
+  // Keep everything 8 byte aligned
+  size = (size + 7) & ~(size_t) 7;
+  if (size > sizeof(memory) - used) {
+    return NULL;
+  }
+  void* p = (uint8_t*) memory + used;
+  used += size;
+  if (used > peak_used) {
+    peak_used = used;
+  }
+  return p;
+}
+
+uint8_t* SessionArena::copy(const uint8_t* data, size_t length)
+{
+  uint8_t* p = (uint8_t*) alloc(length);
+  if (p != NULL) {
+    memcpy(p, data, length);
+  }
+  return p;
+}
+
+Response* SessionArena::beginResponse()
+{
+  response_mark = used;
+  Response* response = NULL;
+  if (num_responses < SESSION_MAX_RESPONSES) {
+    response = (Response*) alloc(sizeof(Response));
+  }
+  uint8_t* data = response != NULL ? (uint8_t*) alloc(RESPONSE_BUFFER_SIZE) : NULL;
+
+  if (data == NULL) {
+    used = response_mark;
+    if (!warned_full) {
+      TRACE_ERROR(trace_out.putLine("Session arena full, later responses are not kept"));
+      warned_full = true;
+    }
+    scratch.length = 0;
+    scratch.tlvs = NULL;
+    return &scratch;
+  }
+
+  response_size = RESPONSE_BUFFER_SIZE;
+  response->data = data;
+  response->length = 0;
+  response->tlvs = NULL;
+  response->kept = true;
+  return response;
+}
+
+void SessionArena::endResponse(Response* response, uint16_t length)
+{
+  response->length = length;
+  if (response == &scratch) {
+    return;
+  }
+
+  // Give back the unused end of the buffer
+  used = (response->data - (uint8_t*) memory) + ((length + 7) & ~7);
+  responses[num_responses++] = response;
+}
+
+void SessionArena::cancelResponse(Response* response)
+{
+  if (response != &scratch) {
+    used = response_mark;
+  }
+}
+
+bool SessionArena::growResponse(Response* response, uint16_t size)
+{
+  if (response == &scratch || size > RESPONSE_MAX_SIZE) {
+    return false;
+  }
+  if (size <= response_size) {
+    return true;
+  }
+
+  // Nothing is allocated after the open response, extend it
+  size_t start = response->data - (uint8_t*) memory;
+  size_t aligned = (size + 7) & ~(size_t) 7;
+  if (aligned > sizeof(memory) - start) {
+    return false;
+  }
+  response_size = size;
+  used = start + aligned;
+  if (used > peak_used) {
+    peak_used = used;
+  }
+  return true;
+}
+
+TLVS* SessionArena::decode(Response* response, uint16_t length)
+{
+  void* p = response->kept ? alloc(sizeof(TLVS)) : NULL;
+  TLVS* tlvs = p != NULL ? new (p) TLVS() : &scratch_tlvs;
+  if (response->kept && p == NULL) {
+    // The next decode overwrites scratch TLVs: don't index them, and
+    // don't list the response with the kept ones
+    response->kept = false;
+    if (num_responses > 0 && responses[num_responses - 1] == response) {
+      num_responses--;
+    }
+    if (!warned_full) {
+      TRACE_ERROR(trace_out.putLine("Session arena full, later responses are not kept"));
+      warned_full = true;
+    }
+  }
+
+  tlvs->decodeTLVs(response->data, length);
+  response->tlvs = tlvs;
+  if (response->kept) {
+    index.addTree(tlvs->firstTLV(), num_responses - 1);
+  }
+  last_decoded = response;
+  return tlvs;
+}
+
+void SessionArena::reset()
+{
+  // Nothing to run unless the TLV decoder needs its destructor
+  if (!std::is_trivially_destructible<TLVS>::value) {
+    for (int i = 0; i < num_responses; i++) {
+      if (responses[i]->tlvs != NULL) {
+        responses[i]->tlvs->~TLVS();
+      }
+    }
+  }
+  used = 0;
+  num_responses = 0;
+  index.clear();
+  last_decoded = NULL;
+  warned_full = false;
+}
@@ -0,0 +1,127 @@
+#ifndef __SESSION_ARENA_H__
+#define __SESSION_ARENA_H__
+#include <stdint.h>
+#include <stddef.h>
+#include "tlv.h"
+#include "tag_index.h"
+
+//
+// Memory for the commands and responses of one tap
+//
+// Every response buffer and its decoded TLVs are bump allocated from a
+// fixed block, so TLV nodes from PPSE or SELECT are still valid after
+// GPO and the records have been read. Nothing is copied between steps.
+// Everything is released at once by reset() when the next tap starts.
+//
+// Kept responses are added to a tag index as they are decoded, so a
+// tag from any response of the tap can be found without a tree walk.
+//
+// If the arena fills up, further responses use a scratch buffer that
+// is overwritten by the next exchange, as before the arena existed.
+// Those are not indexed. Nor is a response whose TLVs didn't fit: it
+// is decoded into scratch TLVs, and no longer counts as kept.
+//
+// A response sent in parts (61xx and GET RESPONSE) is received into
+// one buffer: the open response is the last allocation, so it can
+// grow in place as each part arrives.
+//
+
+// Bytes of response data (status included) a response buffer can hold
+#define RESPONSE_BUFFER_SIZE 255
+
+// Largest response, all parts joined
+#ifndef RESPONSE_MAX_SIZE
+#define RESPONSE_MAX_SIZE 1024
+#endif
+
+// Bytes in the buffer commands are built in
+#define COMMAND_BUFFER_SIZE 255
+
+// Responses kept per tap, and the arena size to hold them
+#ifndef SESSION_ARENA_RESPONSES
+#define SESSION_ARENA_RESPONSES 8
+#endif
+#ifndef SESSION_ARENA_SIZE
+#define SESSION_ARENA_SIZE (SESSION_ARENA_RESPONSES * (RESPONSE_BUFFER_SIZE + sizeof(TLVS) + 32))
+#endif
+
+// Limit on the number of responses tracked, kept or scratch
+#define SESSION_MAX_RESPONSES 40
+
+struct Response {
+  uint8_t* data;      // Response APDU, including the status bytes
+  uint16_t length;
+  TLVS* tlvs;         // Decoded response, NULL until decoded
+  bool kept;          // Held in the arena for the rest of the tap, and indexed
+};
+
+class SessionArena {
+public:
+  SessionArena();
+  ~SessionArena();
+
+  // Allocate memory for the rest of the tap. Return NULL if full.
+  void* alloc(size_t size);
+
+  // Copy data into the arena. Return NULL if full.
+  uint8_t* copy(const uint8_t* data, size_t length);
+
+  // Get a response with a RESPONSE_BUFFER_SIZE buffer to receive into.
+  // Finish it with endResponse, or cancelResponse if the exchange failed.
+  Response* beginResponse();
+  void endResponse(Response* response, uint16_t length);
+  void cancelResponse(Response* response);
+
+  // Make the buffer of the open response hold size bytes, keeping what
+  // was received. Return false if it can't, or size is over RESPONSE_MAX_SIZE.
+  bool growResponse(Response* response, uint16_t size);
+
+  // Decode the first length bytes of a response into TLVs, and index them
+  TLVS* decode(Response* response, uint16_t length);
+
+  // Tags from all the kept responses of the tap
+  const TagIndex& tags() const { return index; }
+  TagIndex& tags() { return index; }
+
+  // The last response decoded, or NULL
+  Response* lastDecoded() { return last_decoded; }
+
+  // False for a response in the scratch buffer, which is not kept or indexed
+  bool isKept(const Response* response) const { return response->kept; }
+
+  // Responses received so far in this tap, oldest first
+  int responseCount() const { return num_responses; }
+  Response* response(int i) { return responses[i]; }
+
+  // Buffer to build the next command in
+  uint8_t* commandBuffer() { return command; }
+
+  // Release everything
+  void reset();
+
+  size_t bytesUsed() const { return used; }
+  size_t peakBytesUsed() const { return peak_used; }
+  static size_t capacity() { return SESSION_ARENA_SIZE; }
+
+private:
+  size_t used;
+  size_t peak_used;
+  size_t response_mark;     // Arena position before the open response
+  size_t response_size;     // Buffer size of the open response
+  Response* responses[SESSION_MAX_RESPONSES];
+  int num_responses;
+  Response* last_decoded;
+  bool warned_full;
+  TagIndex index;
+  uint8_t command[COMMAND_BUFFER_SIZE];
+
+  // Used when the arena is full
+  Response scratch;
+  uint8_t scratch_data[RESPONSE_BUFFER_SIZE];
+  TLVS scratch_tlvs;
+
+  // Last, so the pointer alignment of the members above carries over
+  uint64_t memory[(SESSION_ARENA_SIZE + 7) / 8];
+};
+
+#endif /* __SESSION_ARENA_H__ */
@@ -0,0 +1,84 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+//
+// Lock-free single producer, single consumer byte ring
+//
+// One task pushes and one other task pops, with no locks: each side
+// only writes its own index, and publishes it with a release store
+// after the bytes are in place. SIZE must be a power of two. The
+// indexes run freely and are masked on use, so all SIZE bytes can be
+// filled.
+//
+// A push is all or nothing, so a record is never split by a full ring.
+//
+
+template <size_t SIZE>
+class SpscRing {
+  static_assert((SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  // Producer: add length bytes. Return false, adding nothing, if they don't fit.
+  bool push(const uint8_t* data, size_t length)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    if (length > SIZE - (h - t)) {
+      return false;
+    }
+    copyIn(h, data, length);
+    head.store(h + length, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: take up to max_length bytes. Return the number taken.
+  size_t pop(uint8_t* data, size_t max_length)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    size_t length = h - t;
+    if (length > max_length) {
+      length = max_length;
+    }
+    copyOut(t, data, length);
+    tail.store(t + length, std::memory_order_release);
+    return length;
+  }
+
+  // Bytes waiting. Exact for the consumer, a lower bound for the producer.
+  size_t used() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  static size_t capacity() { return SIZE; }
+
+private:
+  void copyIn(size_t pos, const uint8_t* data, size_t length)
+  {
+    size_t offset = pos & (SIZE - 1);
+    size_t first = length < SIZE - offset ? length : SIZE - offset;
+    memcpy(&buffer[offset], data, first);
+    memcpy(&buffer[0], data + first, length - first);
+  }
+
+  void copyOut(size_t pos, uint8_t* data, size_t length)
+  {
+    size_t offset = pos & (SIZE - 1);
+    size_t first = length < SIZE - offset ? length : SIZE - offset;
+    memcpy(data, &buffer[offset], first);
+    memcpy(data + first, &buffer[0], length - first);
+  }
+
+  uint8_t buffer[SIZE];
+  std::atomic<size_t> head;     // Written by the producer only
+  std::atomic<size_t> tail;     // Written by the consumer only
+};
+
+#endif /* __SPSC_RING_H__ */
@@ -0,0 +1,103 @@
+//
+// Index of every tag in the responses of a tap
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "tag_index.h"
+
+TagIndex::TagIndex(TagPolicy policy)
+  : policy(policy)
+{
+  clear();
+}
+
+void TagIndex::clear()
+{
+  memset(slots, 0, sizeof(slots));
+  num_tags = 0;
+  num_duplicates = 0;
+  num_conflicts = 0;
+  num_dropped = 0;
+}
+
+//
+// Return the slot holding the tag, or the empty slot where it goes.
+// The table is never full, so there is always an empty slot.
+//
+int TagIndex::slotFor(uint16_t tag) const
+{
+  // Fibonacci hash: multiply and keep the top bits
+  int slot = (uint16_t) (tag * 40503u) >> (16 - TAG_INDEX_BITS);
+  while (slots[slot].tag != 0 && slots[slot].tag != tag) {
+    slot = (slot + 1) & (TAG_INDEX_SLOTS - 1);
+  }
+  return slot;
+}
+
+bool TagIndex::add(uint16_t tag, const uint8_t* value, uint16_t length, uint8_t response)
+{
+  // 00 is padding between TLVs, not a tag
+  if (tag == 0) {
+    return true;
+  }
+
+  TagValue& entry = slots[slotFor(tag)];
+  if (entry.tag == 0) {
+    if (num_tags == TAG_INDEX_MAX_TAGS) {
+      num_dropped++;
+      return false;
+    }
+    entry.tag = tag;
+    entry.value = value;
+    entry.length = length;
+    entry.count = 1;
+    entry.response = response;
+    entry.conflict = false;
+    num_tags++;
+    return true;
+  }
+
+  // Seen before
+  if (entry.count == 1) {
+    num_duplicates++;
+  }
+  if (entry.count < 255) {
+    entry.count++;
+  }
+  if (!entry.conflict &&
+      (length != entry.length || memcmp(value, entry.value, length) != 0)) {
+    entry.conflict = true;
+    num_conflicts++;
+  }
+  if (policy == TAG_KEEP_LAST) {
+    entry.value = value;
+    entry.length = length;
+    entry.response = response;
+  }
+  return true;
+}
+
+void TagIndex::addTree(TLVNode* node, uint8_t response)
+{
+  if (node == NULL) {
+    return;
+  }
+  add(node->getTag(), node->getValue(), node->getValueLength(), response);
+
+  TLVNode* child = node->firstChild();
+  while (child != NULL) {
+    addTree(child, response);
+    child = node->nextChild(child);
+  }
+}
+
+const TagValue* TagIndex::find(uint16_t tag) const
+{
+  if (tag == 0) {
+    return NULL;
+  }
+  const TagValue& entry = slots[slotFor(tag)];
+  return entry.tag != 0 ? &entry : NULL;
+}
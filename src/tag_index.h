@@ -0,0 +1,77 @@
+#ifndef __TAG_INDEX_H__
+#define __TAG_INDEX_H__
+#include <stdint.h>
+#include "tlv.h"
+
+//
+// Index of every tag in the responses of a tap
+//
+// A small open addressing hash table from tag to value span. Each
+// response is added once, when it is decoded, so finding a tag later
+// does not walk the TLV trees again, and covers all responses, not
+// just the last one.
+//
+// A tag seen again keeps the first value or takes the last one,
+// depending on the policy. Either way the repeat is counted, and a
+// repeat with a different value is flagged as a conflict.
+//
+// The values point into the response buffers, so the index is only
+// valid as long as they are. SessionArena clears it on reset.
+//
+
+// Table size is 1 << TAG_INDEX_BITS. Filled to at most 3/4, so the
+// default takes 96 tags; a typical card has 40 to 50 across its
+// responses. Tags past that are dropped and counted.
+#ifndef TAG_INDEX_BITS
+#define TAG_INDEX_BITS 7
+#endif
+#define TAG_INDEX_SLOTS (1 << TAG_INDEX_BITS)
+#define TAG_INDEX_MAX_TAGS (TAG_INDEX_SLOTS * 3 / 4)
+
+enum TagPolicy {
+  TAG_KEEP_FIRST,     // Keep the value first seen
+  TAG_KEEP_LAST,      // Replace with the latest value
+};
+
+struct TagValue {
+  uint16_t tag;           // 0 for an empty slot
+  const uint8_t* value;
+  uint16_t length;
+  uint8_t count;          // Times seen, up to 255
+  uint8_t response;       // Response number the value came from
+  bool conflict;          // Seen again with a different value
+};
+
+class TagIndex {
+public:
+  TagIndex(TagPolicy policy = TAG_KEEP_FIRST);
+
+  // Add a node and all of its children, found in the given response
+  void addTree(TLVNode* node, uint8_t response);
+
+  // Add one tag. Return false if the table is full.
+  bool add(uint16_t tag, const uint8_t* value, uint16_t length, uint8_t response);
+
+  // Find a tag. NULL if not seen.
+  const TagValue* find(uint16_t tag) const;
+
+  void clear();
+  void setPolicy(TagPolicy policy) { this->policy = policy; }
+
+  int size() const { return num_tags; }
+  int duplicates() const { return num_duplicates; }
+  int conflicts() const { return num_conflicts; }
+  int dropped() const { return num_dropped; }
+
+private:
+  int slotFor(uint16_t tag) const;
+
+  TagPolicy policy;
+  TagValue slots[TAG_INDEX_SLOTS];
+  int num_tags;
+  int num_duplicates;
+  int num_conflicts;
+  int num_dropped;
+};
+
+#endif /* __TAG_INDEX_H__ */
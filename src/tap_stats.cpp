@@ -0,0 +1,127 @@
+//
+// Latency statistics for the phases of a tap
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include <Arduino.h>
+#include "tap_stats.h"
+#include "emv_format.h"
+
+TapStats tap_stats;
+
+LatencyHistogram::LatencyHistogram()
+{
+  clear();
+}
+
+void LatencyHistogram::clear()
+{
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  max_value = 0;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    buckets[i] += other.buckets[i];
+  }
+  count += other.count;
+  max_value = max(max_value, other.max_value);
+}
+
+//
+// Values below 4 have their own bucket. Above that, each power of two
+// is split into four buckets using the two bits below the top bit.
+//
+int LatencyHistogram::bucketFor(uint32_t value)
+{
+  if (value < 4) {
+    return value;
+  }
+  int msb = 31 - __builtin_clz(value);
+  int bucket = (msb - 1) * 4 + ((value >> (msb - 2)) & 3);
+  return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+// Largest value that falls in a bucket
+uint32_t LatencyHistogram::bucketLimit(int bucket)
+{
+  if (bucket < 4) {
+    return bucket;
+  }
+  int shift = bucket / 4 - 1;
+  uint32_t low = (uint32_t) (4 + bucket % 4) << shift;
+  return low + (1ul << shift) - 1;
+}
+
+void LatencyHistogram::record(uint32_t micros)
+{
+  buckets[bucketFor(micros)]++;
+  count++;
+  if (micros > max_value) {
+    max_value = micros;
+  }
+}
+
+uint32_t LatencyHistogram::percentile(int percent) const
+{
+  if (count == 0) {
+    return 0;
+  }
+  uint32_t target = (uint32_t) (((uint64_t) count * percent + 99) / 100);
+  uint32_t seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      return min(bucketLimit(i), max_value);
+    }
+  }
+  return max_value;
+}
+
+void TapStats::record(StatPhase phase, unsigned long start_micros)
+{
+  phases[phase].record((uint32_t) (micros() - start_micros));
+}
+
+void TapStats::clear()
+{
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    phases[i].clear();
+  }
+}
+
+void TapStats::merge(const TapStats& other)
+{
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    phases[i].merge(other.phases[i]);
+  }
+}
+
+const char* TapStats::phaseName(StatPhase phase)
+{
+  static const char* names[NUM_STAT_PHASES] = {
+    "ppse", "select", "gpo", "read record", "build dol", "decode", "output"
+  };
+  return phase < NUM_STAT_PHASES ? names[phase] : "unknown";
+}
+
+void TapStats::print()
+{
+  trace_out.putLine("phase           count    p50 us    p95 us    p99 us    max us");
+  for (int i = 0; i < NUM_STAT_PHASES; i++) {
+    const LatencyHistogram& h = phases[i];
+    const char* name = phaseName((StatPhase) i);
+    trace_out.putStr(name);
+    trace_out.putSpaces(12 - strlen(name));
+    trace_out.putDec(h.getCount(), 9);
+    trace_out.putDec(h.percentile(50), 10);
+    trace_out.putDec(h.percentile(95), 10);
+    trace_out.putDec(h.percentile(99), 10);
+    trace_out.putDec(h.getMax(), 10);
+    trace_out.putLine();
+  }
+  trace_out.flush();
+}
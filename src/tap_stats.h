@@ -0,0 +1,71 @@
+#ifndef __TAP_STATS_H__
+#define __TAP_STATS_H__
+#include <stdint.h>
+
+//
+// Latency statistics for the phases of a tap
+//
+// Each phase has a fixed size histogram of micros() timings with
+// logarithmic buckets, four per power of two, so percentiles are
+// accurate to within 25% and recording never allocates.
+//
+
+enum StatPhase {
+  STAT_PPSE,            // PPSE exchange
+  STAT_SELECT,          // SELECT AID exchange
+  STAT_GPO,             // GET PROCESSING OPTIONS exchange
+  STAT_READ_RECORD,     // Each READ RECORD exchange
+  STAT_BUILD_DOL,       // buildDataOptionsList
+  STAT_DECODE,          // decodeTLVs of a response
+  STAT_OUTPUT,          // Trace output of messages and TLVs
+  NUM_STAT_PHASES
+};
+
+#define HISTOGRAM_BUCKETS 96
+
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  void record(uint32_t micros);
+  void clear();
+
+  // Add the samples of another histogram
+  void merge(const LatencyHistogram& other);
+
+  uint32_t getCount() const { return count; }
+  uint32_t getMax() const { return max_value; }
+
+  // Value at or below which the given percent of the samples fall
+  uint32_t percentile(int percent) const;
+
+private:
+  static int bucketFor(uint32_t value);
+  static uint32_t bucketLimit(int bucket);
+
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+  uint32_t count;
+  uint32_t max_value;
+};
+
+class TapStats {
+public:
+  // Record the time since start_micros for a phase
+  void record(StatPhase phase, unsigned long start_micros);
+
+  void clear();
+
+  // Add the samples of another set of statistics
+  void merge(const TapStats& other);
+
+  // Print counts and p50/p95/p99/max for each phase
+  void print();
+
+  static const char* phaseName(StatPhase phase);
+
+  LatencyHistogram phases[NUM_STAT_PHASES];
+};
+
+extern TapStats tap_stats;
+
+#endif /* __TAP_STATS_H__ */
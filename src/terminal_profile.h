@@ -0,0 +1,164 @@
+#ifndef __TERMINAL_PROFILE_H__
+#define __TERMINAL_PROFILE_H__
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Terminal data sent to the card in the PDOL data of GET PROCESSING OPTIONS
+//
+// A profile is a constexpr table of data options sorted by tag, so it
+// is placed in flash and searched with a binary search. The sort order
+// and the value lengths are checked when the table is compiled.
+//
+// Each profile is an instantiation of TerminalProfile with a config
+// struct. A config derives from TerminalDefaults and hides the values
+// it changes, e.g. the TTQ or the currency. TERMINAL_CONFIG picks the
+// profile the reader uses.
+//
+// The date and the unpredictable number change on every tap. Their
+// entries point at RAM, transaction_date and unpredictable_number,
+// where the GPO cache patches copy them from.
+//
+
+// Element of the data option table
+// per_transaction marks values that change on every tap (e.g. the unpredictable number)
+struct DataOption {
+  uint16_t tag;
+  const uint8_t* value;
+  uint8_t value_length;
+  bool per_transaction;
+};
+
+// Make a table entry, the length taken from the value
+template <size_t N>
+constexpr DataOption dataOption(uint16_t tag, const uint8_t (&value)[N], bool per_transaction = false)
+{
+  static_assert(N <= 255, "Data option value longer than 255 bytes");
+  return DataOption{ tag, value, (uint8_t) N, per_transaction };
+}
+
+// Data options sorted by tag
+template <size_t N>
+struct DataOptionTable {
+  DataOption options[N];
+
+  static constexpr size_t size() { return N; }
+
+  // True if the tags are in increasing order, with no repeats
+  constexpr bool isSorted() const
+  {
+    for (size_t i = 1; i < N; i++) {
+      if (options[i - 1].tag >= options[i].tag) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Binary search for a tag. Return NULL if not found.
+  constexpr const DataOption* find(uint16_t tag) const
+  {
+    size_t low = 0;
+    size_t high = N;
+    while (low < high) {
+      size_t mid = (low + high) / 2;
+      if (options[mid].tag < tag) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low < N && options[low].tag == tag ? &options[low] : NULL;
+  }
+};
+
+template <typename... Options>
+constexpr DataOptionTable<sizeof...(Options)> makeDataOptionTable(Options... options)
+{
+  return DataOptionTable<sizeof...(Options)>{ { options... } };
+}
+
+// Values that change on every tap
+extern uint8_t transaction_date[3];         // YYMMDD
+extern uint8_t unpredictable_number[4];
+
+// Draw a new unpredictable number, and take the date from the clock if
+// it has been set. Called for each GET PROCESSING OPTIONS.
+void refreshTransactionData();
+
+//
+// Values for our emulated 'terminal' reading the card
+// The choice of data here is mostly arbitrary
+//
+struct TerminalDefaults {
+  // Terminal transaction qualifiers
+  static constexpr uint8_t ttq[] = { 0x36, 0x80, 0x40, 0x00 };
+  // Transaction currency code
+  static constexpr uint8_t currency_code[] = { 0x08, 0x40 };  // USD numeric code
+  // Terminal Risk Management Data
+  static constexpr uint8_t risk_management_data[] = { 0x40, 0x40, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00 };
+  // Terminal Country Code
+  static constexpr uint8_t country_code[] = { 0x08, 0x40 }; // US
+  // Terminal Type
+  static constexpr uint8_t terminal_type[] = { 0x14 };
+  // Acquirer Identifier
+  static constexpr uint8_t acquirer_id[] = { 0x01 };
+  // Application lifecycle data
+  static constexpr uint8_t lifecycle_data[] = { 0x01 };
+  // Merchant name and location
+  static constexpr uint8_t merchant_name[] = {
+    0x41, 0x42, 0x43, 0x32, 0x30, 0x32, 0x34, 0x30, 0x38, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+  // Transaction amount
+  static constexpr uint8_t amount[] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00 };
+  // Amount other
+  static constexpr uint8_t amount_other[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+  // Terminal verification results
+  static constexpr uint8_t tvr[] = { 0x00, 0x00, 0x00, 0x00, 0x00 };
+  // Transaction type
+  static constexpr uint8_t transaction_type[] = { 0x00 };
+};
+
+// US terminal, the defaults
+struct UsTerminal : TerminalDefaults {
+};
+
+// Euro area terminal, in Germany
+struct EuroTerminal : TerminalDefaults {
+  static constexpr uint8_t currency_code[] = { 0x09, 0x78 };  // EUR
+  static constexpr uint8_t country_code[] = { 0x02, 0x76 };   // DE
+};
+
+//
+// Data option table for a terminal config
+//
+template <typename Config>
+struct TerminalProfile {
+  static constexpr auto options = makeDataOptionTable(
+    dataOption(0x95, Config::tvr),
+    dataOption(0x9a, transaction_date, true),
+    dataOption(0x9c, Config::transaction_type),
+    dataOption(0x5f2a, Config::currency_code),
+    dataOption(0x9f01, Config::acquirer_id),
+    dataOption(0x9f02, Config::amount),
+    dataOption(0x9f03, Config::amount_other),
+    dataOption(0x9f1a, Config::country_code),
+    dataOption(0x9f1d, Config::risk_management_data),
+    dataOption(0x9f35, Config::terminal_type),
+    dataOption(0x9f37, unpredictable_number, true),
+    dataOption(0x9f4e, Config::merchant_name),
+    dataOption(0x9f66, Config::ttq),
+    dataOption(0x9f7e, Config::lifecycle_data));
+
+  static_assert(options.isSorted(), "Terminal profile tags must be sorted, with no repeats");
+};
+
+// Profile used by the reader
+#ifndef TERMINAL_CONFIG
+#define TERMINAL_CONFIG UsTerminal
+#endif
+
+typedef TerminalProfile<TERMINAL_CONFIG> ActiveTerminalProfile;
+
+#endif /* __TERMINAL_PROFILE_H__ */
@@ -0,0 +1,52 @@
+#ifndef __TRACE_LEVEL_H__
+#define __TRACE_LEVEL_H__
+
+//
+// Compile time verbosity of the tap trace
+//
+// Each trace statement is wrapped in the macro for its level, or a block
+// of them in `if constexpr (TRACE_ENABLED(level))`. Below
+// TRACE_LEVEL the statements are discarded by `if constexpr`: no call is
+// made, the arguments aren't evaluated and the string literals are not
+// in the image, even without optimization. The statements are still
+// compiled, so they can't go stale.
+//
+// Levels, each including the ones before:
+//   TRACE_LEVEL_OFF       nothing
+//   TRACE_LEVEL_ERROR     failed steps and exchanges
+//   TRACE_LEVEL_RESULT    the data read from the card, as TLV trees
+//   TRACE_LEVEL_PROGRESS  step headers and progress lines
+//   TRACE_LEVEL_APDU      every command and response in hex, the default
+//
+// Statistics and the output of serial commands are not affected.
+//
+
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_RESULT 2
+#define TRACE_LEVEL_PROGRESS 3
+#define TRACE_LEVEL_APDU 4
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_APDU
+#endif
+
+// True if statements for the level are compiled in, for `if constexpr` blocks
+#define TRACE_ENABLED(level) (TRACE_LEVEL >= (level))
+
+#define TRACE_AT(level, ...) \
+  do { if constexpr (TRACE_ENABLED(level)) { __VA_ARGS__; } } while (0)
+
+#define TRACE_ERROR(...) TRACE_AT(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#define TRACE_RESULT(...) TRACE_AT(TRACE_LEVEL_RESULT, __VA_ARGS__)
+#define TRACE_PROGRESS(...) TRACE_AT(TRACE_LEVEL_PROGRESS, __VA_ARGS__)
+#define TRACE_APDU(...) TRACE_AT(TRACE_LEVEL_APDU, __VA_ARGS__)
+
+// Name of the level built in
+inline const char* traceLevelName()
+{
+  static const char* names[] = { "off", "error", "result", "progress", "apdu" };
+  return names[TRACE_LEVEL];
+}
+
+#endif /* __TRACE_LEVEL_H__ */
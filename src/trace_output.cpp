@@ -0,0 +1,150 @@
+//
+// Trace output of card exchanges, as text or as binary frames
+//
+// Copyright (c) 2025 James Wanderer
+//
+
+#include "trace_output.h"
+#include "emv_format.h"
+
+FrameWriter frame_out(Serial);
+
+static OutputMode output_mode = OUTPUT_TEXT;
+static Print* output_port = &Serial;
+
+FrameWriter::FrameWriter(Print& out)
+  : out(&out), sequence(0)
+{
+}
+
+//
+// Put the header at the start of the frame buffer. Return its size.
+//
+int FrameWriter::putHeader(uint8_t type, uint16_t length)
+{
+  uint32_t timestamp = micros();
+  uint8_t header[FRAME_HEADER_SIZE] = {
+    FRAME_SYNC,
+    type,
+    (uint8_t) sequence, (uint8_t) (sequence >> 8),
+    (uint8_t) timestamp, (uint8_t) (timestamp >> 8),
+    (uint8_t) (timestamp >> 16), (uint8_t) (timestamp >> 24),
+    (uint8_t) length, (uint8_t) (length >> 8)
+  };
+  sequence++;
+  memcpy(frame, header, sizeof(header));
+  return sizeof(header);
+}
+
+void FrameWriter::writeFrame(uint8_t type, const uint8_t* payload, uint16_t length)
+{
+  if (length > FRAME_MAX_PAYLOAD) {
+    // Never sent in parts: a queue that drops writes could keep half
+    return;
+  }
+  int n = putHeader(type, length);
+  memcpy(frame + n, payload, length);
+  out->write(frame, n + length);
+}
+
+void FrameWriter::writeTLVFrame(TLVNode* node)
+{
+  uint16_t tag = node->getTag();
+  uint16_t value_length = node->getValueLength();
+
+  // BER tag and length
+  uint8_t head[5];
+  int n = 0;
+  if (tag > 0xff) {
+    head[n++] = tag >> 8;
+  }
+  head[n++] = (uint8_t) tag;
+  if (value_length > 0xff) {
+    head[n++] = 0x82;
+    head[n++] = value_length >> 8;
+  } else if (value_length > 0x7f) {
+    head[n++] = 0x81;
+  }
+  head[n++] = (uint8_t) value_length;
+
+  if (n + value_length > FRAME_MAX_PAYLOAD) {
+    return;
+  }
+  int header_length = putHeader(FRAME_TLV, n + value_length);
+  memcpy(frame + header_length, head, n);
+  memcpy(frame + header_length + n, node->getValue(), value_length);
+  out->write(frame, header_length + n + value_length);
+}
+
+size_t FrameWriter::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t FrameWriter::write(const uint8_t* buffer, size_t size)
+{
+  // Long text goes out as several whole frames
+  for (size_t done = 0; done < size; done += FRAME_MAX_PAYLOAD) {
+    writeFrame(FRAME_TEXT, buffer + done, (uint16_t) min(size - done, (size_t) FRAME_MAX_PAYLOAD));
+  }
+  return size;
+}
+
+void setOutputMode(OutputMode mode)
+{
+  trace_out.flush();
+  output_mode = mode;
+  if (mode == OUTPUT_BINARY) {
+    trace_out.setOutput(frame_out);
+  } else {
+    trace_out.setOutput(*output_port);
+  }
+}
+
+void setOutputPort(Print& port)
+{
+  trace_out.flush();
+  output_port = &port;
+  frame_out.setOutput(port);
+  if (output_mode == OUTPUT_TEXT) {
+    trace_out.setOutput(port);
+  }
+}
+
+OutputMode getOutputMode()
+{
+  return output_mode;
+}
+
+void traceCommand(const uint8_t* buffer, uint8_t length)
+{
+  if (output_mode == OUTPUT_BINARY) {
+    trace_out.flush();
+    frame_out.writeFrame(FRAME_COMMAND, buffer, length);
+    return;
+  }
+  trace_out.putCommand(buffer, length);
+  trace_out.flush();
+}
+
+void traceResponse(const uint8_t* buffer, uint16_t length)
+{
+  if (output_mode == OUTPUT_BINARY) {
+    trace_out.flush();
+    frame_out.writeFrame(FRAME_RESPONSE, buffer, length);
+    return;
+  }
+  trace_out.putResponse(buffer, length);
+  trace_out.flush();
+}
+
+void traceTLV(TLVNode* node)
+{
+  if (output_mode == OUTPUT_BINARY && node != NULL) {
+    trace_out.flush();
+    frame_out.writeTLVFrame(node);
+    return;
+  }
+  trace_out.putTLV(node);
+  trace_out.flush();
+}
@@ -0,0 +1,88 @@
+#ifndef __TRACE_OUTPUT_H__
+#define __TRACE_OUTPUT_H__
+#include <Arduino.h>
+#include <stdint.h>
+#include "tlv.h"
+#include "session_arena.h"
+
+//
+// Trace output of card exchanges, as text or as binary frames
+//
+// Text mode is the readable dump. Binary mode sends each command,
+// response, decoded TLV and line of text as a frame, which is a small
+// fraction of the bytes on a slow serial link. host/tools/trace_decode
+// turns the frames back into the text dump.
+//
+// Frame layout, multi-byte values little endian:
+//
+//   0      FRAME_SYNC (0xE5)
+//   1      frame type
+//   2-3    sequence number, to detect lost frames
+//   4-7    timestamp, micros()
+//   8-9    payload length
+//   10..   payload
+//
+// FRAME_TLV payloads are BER encoded: tag, length, value.
+//
+// Each frame is passed to the output in a single write, so a queue
+// that drops writes drops whole frames.
+//
+
+enum OutputMode {
+  OUTPUT_TEXT,
+  OUTPUT_BINARY
+};
+
+enum FrameType {
+  FRAME_TEXT = 1,       // Text, as it would be printed
+  FRAME_COMMAND = 2,    // Command APDU
+  FRAME_RESPONSE = 3,   // Response APDU
+  FRAME_TLV = 4         // Decoded TLV to print as a tree
+};
+
+#define FRAME_SYNC 0xE5
+#define FRAME_HEADER_SIZE 10
+
+// Largest payload written in one piece: a BER TLV head and the longest
+// response, with its GET RESPONSE parts joined
+#define FRAME_MAX_PAYLOAD (5 + RESPONSE_MAX_SIZE)
+
+//
+// Writes frames. Text written through Print goes out as FRAME_TEXT.
+//
+class FrameWriter : public Print {
+public:
+  FrameWriter(Print& out);
+
+  void writeFrame(uint8_t type, const uint8_t* payload, uint16_t length);
+  void writeTLVFrame(TLVNode* node);
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  using Print::write;
+
+  void setOutput(Print& out) { this->out = &out; }
+
+private:
+  int putHeader(uint8_t type, uint16_t length);
+
+  Print* out;
+  uint16_t sequence;
+  uint8_t frame[FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD];
+};
+
+extern FrameWriter frame_out;
+
+// Select how the trace is written. Text is the default.
+void setOutputMode(OutputMode mode);
+OutputMode getOutputMode();
+
+// Select where the trace is written, Serial by default
+void setOutputPort(Print& port);
+
+// Trace a command APDU, a response APDU, or a decoded TLV tree
+void traceCommand(const uint8_t* buffer, uint8_t length);
+void traceResponse(const uint8_t* buffer, uint16_t length);
+void traceTLV(TLVNode* node);
+
+#endif /* __TRACE_OUTPUT_H__ */
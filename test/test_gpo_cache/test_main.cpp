@@ -0,0 +1,99 @@
+//
+// GPO cache: a command taken from the cache carries the values of its
+// own tap
+//
+// Copyright (c) 2025 James Wanderer
+//
+// pio test -e native_test
+//
+
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+#include "virtual_card.h"
+#include "card_session.h"
+#include "gpo_cache.h"
+#include "terminal_profile.h"
+
+// Passes exchanges to the card, and keeps the GET PROCESSING OPTIONS commands
+class GpoRecorder : public CardTransport {
+public:
+  GpoRecorder(CardTransport& card) : card(card) {}
+
+  bool detectCard() { return card.detectCard(); }
+  bool getCardUID(uint8_t* uid, uint8_t* uid_length) { return card.getCardUID(uid, uid_length); }
+  LinkError getLastError() { return card.getLastError(); }
+
+  bool transceive(const uint8_t* tx, uint8_t tx_length, uint8_t* rx, uint8_t* rx_length) {
+    if (tx_length >= 2 && tx[0] == 0x80 && tx[1] == 0xA8) {
+      commands.push_back(std::vector<uint8_t>(tx, tx + tx_length));
+    }
+    return card.transceive(tx, tx_length, rx, rx_length);
+  }
+
+  std::vector<std::vector<uint8_t>> commands;
+
+private:
+  CardTransport& card;
+};
+
+// Offset of value in command, -1 if it isn't there
+static int find(const std::vector<uint8_t>& command, const uint8_t* value, size_t length)
+{
+  for (size_t i = 0; i + length <= command.size(); i++) {
+    if (memcmp(&command[i], value, length) == 0) {
+      return (int) i;
+    }
+  }
+  return -1;
+}
+
+void setUp()
+{
+  gpo_cache.clear();
+  Serial.mute(true);
+}
+
+void tearDown()
+{
+  Serial.mute(false);
+}
+
+static void test_cached_command_is_patched()
+{
+  VirtualCard card;
+  card.loadDefaultCard();
+  GpoRecorder recorder(card);
+
+  readCard(recorder);
+  uint8_t first_number[sizeof(unpredictable_number)];
+  memcpy(first_number, unpredictable_number, sizeof(first_number));
+  readCard(recorder);
+
+  TEST_ASSERT_EQUAL(2, recorder.commands.size());
+  TEST_ASSERT_EQUAL(1, gpo_cache.misses);
+  TEST_ASSERT_EQUAL(1, gpo_cache.hits);
+  const std::vector<uint8_t>& built = recorder.commands[0];
+  const std::vector<uint8_t>& cached = recorder.commands[1];
+  TEST_ASSERT_EQUAL(built.size(), cached.size());
+
+  // Each tap draws a new number, and the cached command has this tap's
+  int offset = find(built, first_number, sizeof(first_number));
+  TEST_ASSERT_TRUE(offset >= 0);
+  TEST_ASSERT_TRUE(memcmp(first_number, unpredictable_number, sizeof(first_number)) != 0);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(unpredictable_number, &cached[offset], sizeof(unpredictable_number));
+
+  // Nothing else changes, the date included on the same day
+  std::vector<uint8_t> expected = built;
+  memcpy(&expected[offset], unpredictable_number, sizeof(unpredictable_number));
+  TEST_ASSERT_TRUE(find(cached, transaction_date, sizeof(transaction_date)) >= 0);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected.data(), cached.data(), cached.size());
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_cached_command_is_patched);
+  return UNITY_END();
+}